@@ -4,6 +4,8 @@
 #include <yaml-cpp/yaml.h>
 
 #include <mapf-adapters/mapf.hpp>
+#include <mapf-adapters/budget.hpp>
+#include <mapf-adapters/portfolio.hpp>
 
 #include <mapf-adapters/cbs.hpp>
 #include <mapf-adapters/ecbs.hpp>
@@ -24,6 +26,14 @@ int main(int argc, char* argv[]) {
   float w;
   int j;
   int e;
+  size_t t;
+  int p;
+  int b;
+  int d;
+  double l;
+  double r;
+  int f;
+  size_t m;
   desc.add_options()("help", "produce help message")(
       "input,i", po::value<std::string>(&inputFile)->required(),
       "input file (YAML)")(
@@ -32,7 +42,23 @@ int main(int argc, char* argv[]) {
       "icts_include,j", po::value<int>(&j)->default_value(1),
       "Include ICTS 0/1")(
       "epea_include,e", po::value<int>(&e)->default_value(1),
-      "Include EPEA 0/1");
+      "Include EPEA 0/1")(
+      "threads,t", po::value<size_t>(&t)->default_value(1),
+      "Threads for the CBS/ECBS low-level searches")(
+      "prioritize,p", po::value<int>(&p)->default_value(0),
+      "Branch on cardinal conflicts first in CBS/ECBS 0/1")(
+      "bypass,b", po::value<int>(&b)->default_value(0),
+      "Bypass conflicts in CBS/ECBS 0/1")(
+      "independence,d", po::value<int>(&d)->default_value(0),
+      "Independence detection for CBS/ECBS/ICTS/EPEA 0/1")(
+      "time_limit,l", po::value<double>(&l)->default_value(0),
+      "Time limit of each solver in seconds, 0 for none")(
+      "report,r", po::value<double>(&r)->default_value(0),
+      "Report the progress of each solver every r seconds, 0 for never")(
+      "portfolio,f", po::value<int>(&f)->default_value(0),
+      "Race all solvers in parallel and keep the first optimal answer 0/1")(
+      "memory,m", po::value<size_t>(&m)->default_value(0),
+      "Memory cap of each solver in the portfolio in MB, 0 for none");
 
   try {
     po::variables_map vm;
@@ -72,8 +98,115 @@ int main(int argc, char* argv[]) {
   }
 
   mapf_adapters::mapf mapf(dimx, dimy, obstacles, goals);
+  // distance tables are shared by all solvers run on this instance
+  mapf.compute_heuristic(t);
+
+  // a fresh budget per solver, started right before it runs
+  auto make_budget = [&](const std::string& name) {
+    std::shared_ptr<mapf_adapters::budget> limits;
+    if (l > 0 || r > 0) {
+      mapf_adapters::budget::progress_callback report;
+      if (r > 0) {
+        report = [name](const mapf_adapters::progress& p) {
+          std::cout << name << " :: " << p.elapsed << "s, " << p.expansions
+                    << " expansions (" << p.expansions_per_second
+                    << "/s), lower bound " << p.lower_bound << ", incumbent "
+                    << p.incumbent << std::endl;
+        };
+      }
+      limits = std::make_shared<mapf_adapters::budget>(l, report, r);
+    }
+    return limits;
+  };
+
+  if (f) {
+    // the solvers that support it run behind independence detection with -d
+    auto plan = [&](mapf_adapters::joint_solver solver,
+                    const mapf_adapters::mapf& map,
+                    const std::vector<std::pair<int, int> >& s,
+                    mapf_adapters::joint_solution* solution) {
+      if (d) {
+        mapf_adapters::independence_detection id(solver, t);
+        return id.solve(map, s, solution);
+      }
+      return solver(map, s, solution, t);
+    };
+    typedef std::shared_ptr<mapf_adapters::budget> budget_ptr;
+    size_t cap = m << 20;
+
+    mapf_adapters::portfolio race;
+    race.add("CBS", [&](const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& s, const budget_ptr& limits, mapf_adapters::joint_solution* solution) {
+      cbs::solver solver(t, 1, p, b);
+      solver.set_budget(limits);
+      return plan([&](const mapf_adapters::mapf& g, const std::vector<std::pair<int, int> >& gs, mapf_adapters::joint_solution* o, size_t threads) {
+        return solver.plan(g, gs, o, threads);
+      }, map, s, solution);
+    }, true, cap);
+    race.add("ECBS", [&](const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& s, const budget_ptr& limits, mapf_adapters::joint_solution* solution) {
+      ecbs::solver solver(t, p, b);
+      solver.set_budget(limits);
+      return plan([&](const mapf_adapters::mapf& g, const std::vector<std::pair<int, int> >& gs, mapf_adapters::joint_solution* o, size_t threads) {
+        return solver.plan(g, gs, w, o, threads);
+      }, map, s, solution);
+    }, w <= 1, cap);
+    race.add("BCP", [&](const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& s, const budget_ptr& limits, mapf_adapters::joint_solution* solution) {
+      bcp::solver solver;
+      solver.set_budget(limits);
+      return solver.plan(map, s, solution);
+    }, true, cap);
+    race.add("SAT", [&](const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& s, const budget_ptr& limits, mapf_adapters::joint_solution* solution) {
+      SAT_solver::solver solver;
+      solver.set_budget(limits);
+      return solver.plan(map, s, solution);
+    }, true, cap);
+    if (j) {
+      race.add("ICTS", [&](const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& s, const budget_ptr& limits, mapf_adapters::joint_solution* solution) {
+        icts::solver solver(false, t);
+        solver.set_budget(limits);
+        return plan([&](const mapf_adapters::mapf& g, const std::vector<std::pair<int, int> >& gs, mapf_adapters::joint_solution* o, size_t threads) {
+          return solver.plan(g, gs, o, threads);
+        }, map, s, solution);
+      }, true, cap);
+    }
+    if (e) {
+      race.add("EPEA", [&](const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& s, const budget_ptr& limits, mapf_adapters::joint_solution* solution) {
+        epea::solver solver;
+        solver.set_budget(limits);
+        return plan([&](const mapf_adapters::mapf& g, const std::vector<std::pair<int, int> >& gs, mapf_adapters::joint_solution* o, size_t) {
+          return solver.plan(g, gs, o);
+        }, map, s, solution);
+      }, true, cap);
+    }
+
+    mapf_adapters::portfolio_result result;
+    if (!race.solve(mapf, starts, l, &result)) {
+      std::cout << "Planning NOT successful!" << std::endl;
+      return 1;
+    }
+    std::cout << std::endl << std::endl << "PORTFOLIO :: " << result.solver
+              << (result.optimal ? "" : " (suboptimal)") << " in "
+              << result.runtime << std::endl;
+
+    std::ofstream out("../example/output_portfolio.yaml");
+    out << "statistics:" << std::endl;
+    out << "  solver: " << result.solver << std::endl;
+    out << "  optimal: " << (result.optimal ? "true" : "false") << std::endl;
+    out << "  cost: " << result.solution.first << std::endl;
+    out << "  runtime: " << result.runtime << std::endl;
+    out << "schedule:" << std::endl;
+    for (size_t a = 0; a < result.solution.second.size(); ++a) {
+      out << "  agent" << a << ":" << std::endl;
+      for (size_t k = 0; k < result.solution.second[a].size(); ++k) {
+        out << "    - x: " << result.solution.second[a][k].first << std::endl
+            << "      y: " << result.solution.second[a][k].second << std::endl
+            << "      t: " << k << std::endl;
+      }
+    }
+    return 0;
+  }
   
-  cbs::solver mapf_cbs;
+  cbs::solver mapf_cbs(t, 1, p, b, d);
+  mapf_cbs.set_budget(make_budget("CBS"));
 
   auto cbs_start = std::chrono::system_clock::now();
   mapf_cbs.solve(mapf, starts);
@@ -82,13 +215,15 @@ int main(int argc, char* argv[]) {
   
 
   bcp::solver mapf_bcp;
+  mapf_bcp.set_budget(make_budget("BCP"));
 
   auto bcp_start = std::chrono::system_clock::now();
   mapf_bcp.solve(mapf, starts);
   auto bcp_end = std::chrono::system_clock::now();
   auto bcp_time = std::chrono::duration<double>(bcp_end - bcp_start).count();
 
-  ecbs::solver mapf_ecbs;
+  ecbs::solver mapf_ecbs(t, p, b, d);
+  mapf_ecbs.set_budget(make_budget("ECBS"));
 
   auto ecbs_start = std::chrono::system_clock::now();
   mapf_ecbs.solve(mapf, starts, w);
@@ -96,6 +231,7 @@ int main(int argc, char* argv[]) {
   auto ecbs_time = std::chrono::duration<double>(ecbs_end - ecbs_start).count();
 
   SAT_solver::solver mapf_sat;
+  mapf_sat.set_budget(make_budget("SAT"));
 
   auto sat_start = std::chrono::system_clock::now();
   mapf_sat.solve(mapf, starts);
@@ -105,7 +241,8 @@ int main(int argc, char* argv[]) {
 
   float icts_time;
   if(j){
-    icts::solver mapf_icts;
+    icts::solver mapf_icts(d, t);
+    mapf_icts.set_budget(make_budget("ICTS"));
     
     auto icts_start = std::chrono::system_clock::now();
     mapf_icts.solve(mapf, starts);
@@ -117,7 +254,8 @@ int main(int argc, char* argv[]) {
 
   float epea_time;
   if(e){
-    epea::solver mapf_epea;
+    epea::solver mapf_epea(d, t);
+    mapf_epea.set_budget(make_budget("EPEA"));
     
     auto epea_start = std::chrono::system_clock::now();
     mapf_epea.solve(mapf, starts);
@@ -3,9 +3,14 @@
 
 #include <iostream>
 #include "mapf.hpp"
+#include "budget.hpp"
+#include "id.hpp"
 
 #include <yaml-cpp/yaml.h>
 #include <chrono>
+#include <cmath>
+#include <memory>
+#include <sstream>
 #include <string.h> 
 
 #include <bcp/Main.cpp>
@@ -18,7 +23,11 @@ namespace bcp{
 		public:
 		solver()	{}
 
-		bool solve(mapf_adapters::mapf map, std::vector<std::pair<int, int> > starts){
+		// limits every later solve; the budget may be shared with other solvers
+		void set_budget(std::shared_ptr<mapf_adapters::budget> limits){	this->limits = limits;	}
+
+		// plans all agents with a fresh SCIP instance; BCP keeps static state, so never from several threads
+		bool plan(const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& starts, mapf_adapters::joint_solution* joint){
 			
 
 			/*
@@ -40,54 +49,80 @@ namespace bcp{
 
 			std::pair<float, std::vector<std::string> > solution;
 
+			bool success;
+			if(limits){
+				std::shared_ptr<mapf_adapters::budget> b = limits;
+				// SCIP stops on its own at the deadline, the callback covers cancellation and progress
+				double time_limit = b->remaining();
+				success = start_solver(x, y, obstacles, starts, goals, &solution, std::isinf(time_limit) ? 0 : std::max(time_limit, 1e-3),
+					[b](size_t lps, int lower_bound, int incumbent){
+						return b->interrupted(lps, lower_bound, incumbent);
+					}) == SCIP_OKAY;
+			}else{
+				success = start_solver(x, y, obstacles, starts, goals, &solution) == SCIP_OKAY;
+			}
+			// only proven optimal solutions are returned
+			if(!success || solution.second.empty()){
+				return false;
+			}
+
+			// paths come as "(x,y),(x,y),..."
+			joint->first = std::lround(solution.first);
+			joint->second.clear();
+			for(auto it=solution.second.begin(); it!=solution.second.end();++it){
+				std::stringstream ss(*it);
+
+				std::string s;
+				std::vector<std::string> output;
+				while (std::getline(ss, s, ',')) {
+					if(s[0] == '('){
+						output.push_back(s.substr(1));
+					}
+					else if(s[s.length()-1] == ')'){
+						output.push_back(s.substr(0, s.length()-1));	
+					}
+				}
+				joint->second.emplace_back();
+				for(int i=0; i+1<output.size(); i+=2){
+					joint->second.back().emplace_back(std::stoi(output[i]), std::stoi(output[i+1]));
+				}
+			}
+			return true;
+		}
+
+		bool solve(mapf_adapters::mapf map, std::vector<std::pair<int, int> > starts){
+			mapf_adapters::joint_solution solution;
+
 			auto bcp_start = std::chrono::system_clock::now();
-			bool success = start_solver(x, y, obstacles, starts, goals, &solution);
+			bool success = plan(map, starts, &solution);
 			auto bcp_end = std::chrono::system_clock::now();
 
-			float cost = solution.first;
-
-			
 			if (success) {
 				std::cout << "Planning successful! " << std::endl;
 
 				std::ofstream out("../example/output_bcp.yaml");
 				out << "statistics:" << std::endl;
-				out << "  cost: " << cost << std::endl;
+				out << "  cost: " << solution.first << std::endl;
 				out << "  runtime: " << std::chrono::duration<double>(bcp_end - bcp_start).count() << std::endl;
 				out << "schedule:" << std::endl;
 
-				int count = 0;
-
-				for(auto it=solution.second.begin(); it!=solution.second.end();++it){
-					out << "  agent" << count << ":" << std::endl;
-					std::stringstream ss(*it);
-
-					std::string s;
-					std::vector<std::string> output;
-					while (std::getline(ss, s, ',')) {
-						if(s[0] == '('){
-							output.push_back(s.substr(1));
-						}
-						else if(s[s.length()-1] == ')'){
-							output.push_back(s.substr(0, s.length()-1));	
-						}
-					}
-					for(int i=0; i<output.size(); i+=2){
-						out << "    - x: " << output[i] << std::endl
-							<< "      y: " << std::stoi(output[i+1]) << std::endl
-							<< "      t: " << i/2 << std::endl;
+				for(size_t a=0; a<solution.second.size(); a++){
+					out << "  agent" << a << ":" << std::endl;
+					for(size_t t=0; t<solution.second[a].size(); t++){
+						out << "    - x: " << solution.second[a][t].first << std::endl
+							<< "      y: " << solution.second[a][t].second << std::endl
+							<< "      t: " << t << std::endl;
 					}
-					count++;
 				}
 				return true;
 			} else {
 				std::cout << "Planning NOT successful!" << std::endl;
 				return false;
 			}
-			
-			return true;
 		}
 
+		private:
+		std::shared_ptr<mapf_adapters::budget> limits;
 	};
 }
 
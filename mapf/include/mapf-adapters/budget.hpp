@@ -0,0 +1,96 @@
+#ifndef MAPFADAPTERS_BUDGET_HPP
+#define MAPFADAPTERS_BUDGET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+
+namespace mapf_adapters{
+	// state of a running search; a bound the solver does not know is -1
+	struct progress{
+		double elapsed;
+		size_t expansions;
+		double expansions_per_second;
+		int lower_bound;
+		int incumbent;
+	};
+
+	/*
+	Wall-clock deadline and cancellation token of a solve, handed by the
+	adapters to their engines. Engines call interrupted() from their main loop,
+	every so many expansions, and stop as soon as it returns true; it also
+	passes their progress to the callback at most once per report interval.
+
+	The clock starts when the budget is created. cancel() and interrupted()
+	may be called from any thread, so one budget can be shared by several
+	searches, e.g. the groups of independence detection. Once interrupted()
+	returned true it keeps doing so.
+	*/
+	class budget{
+	public:
+		typedef std::function<void(const progress&)> progress_callback;
+
+		// time_limit in seconds, 0 for none
+		budget(double time_limit = 0, progress_callback on_progress = nullptr, double report_interval = 1):
+			start(clock::now()),
+			time_limit(time_limit),
+			report_interval(report_interval),
+			on_progress(on_progress),
+			stopped(false),
+			last_report(0)	{}
+
+		void cancel(){	stopped = true;	}
+		bool cancelled() const {	return stopped;	}
+
+		double elapsed() const {	return std::chrono::duration<double>(clock::now() - start).count();	}
+		// seconds left, infinity without a time limit
+		double remaining() const {
+			if(time_limit <= 0){
+				return std::numeric_limits<double>::infinity();
+			}
+			return std::max(0.0, time_limit - elapsed());
+		}
+		// remaining() rounded up for engines that count whole seconds, max_seconds without a time limit
+		int remaining_seconds(int max_seconds = std::numeric_limits<int>::max()) const {
+			double left = remaining();
+			return left < max_seconds ? int(std::ceil(left)) : max_seconds;
+		}
+
+		// true once the search has to stop; expansions and bounds are those of the calling search
+		bool interrupted(size_t expansions, int lower_bound = -1, int incumbent = -1){
+			if(stopped){
+				return true;
+			}
+			double now = elapsed();
+			if(time_limit > 0 && now >= time_limit){
+				stopped = true;
+				return true;
+			}
+			if(on_progress && now - last_report >= report_interval){
+				std::unique_lock<std::mutex> lock(report_mutex, std::try_to_lock);
+				// another search is reporting right now
+				if(lock.owns_lock() && now - last_report >= report_interval){
+					last_report = now;
+					on_progress({now, expansions, now > 0 ? expansions / now : 0, lower_bound, incumbent});
+				}
+			}
+			return false;
+		}
+
+	private:
+		typedef std::chrono::steady_clock clock;
+
+		clock::time_point start;
+		double time_limit, report_interval;
+		progress_callback on_progress;
+		std::atomic<bool> stopped;
+		std::atomic<double> last_report;
+		std::mutex report_mutex;
+	};
+}
+
+#endif
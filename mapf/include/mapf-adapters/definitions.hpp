@@ -3,6 +3,8 @@
 
 using libMultiRobotPlanning::Neighbor;
 using libMultiRobotPlanning::PlanResult;
+using libMultiRobotPlanning::SharedConstraints;
+using libMultiRobotPlanning::SharedSolution;
 
 
 struct State {
@@ -116,19 +118,6 @@ struct VertexConstraint {
   }
 };
 
-namespace std {
-template <>
-struct hash<VertexConstraint> {
-  size_t operator()(const VertexConstraint& s) const {
-    size_t seed = 0;
-    boost::hash_combine(seed, s.time);
-    boost::hash_combine(seed, s.x);
-    boost::hash_combine(seed, s.y);
-    return seed;
-  }
-};
-}  // namespace std
-
 struct EdgeConstraint {
   EdgeConstraint(int time, int x1, int y1, int x2, int y2)
       : time(time), x1(x1), y1(y1), x2(x2), y2(y2) {}
@@ -154,33 +143,17 @@ struct EdgeConstraint {
   }
 };
 
-namespace std {
-template <>
-struct hash<EdgeConstraint> {
-  size_t operator()(const EdgeConstraint& s) const {
-    size_t seed = 0;
-    boost::hash_combine(seed, s.time);
-    boost::hash_combine(seed, s.x1);
-    boost::hash_combine(seed, s.y1);
-    boost::hash_combine(seed, s.x2);
-    boost::hash_combine(seed, s.y2);
-    return seed;
-  }
-};
-}  // namespace std
-
+// Both lists are kept sorted, i.e. ordered by time first
 struct Constraints {
-  std::unordered_set<VertexConstraint> vertexConstraints;
-  std::unordered_set<EdgeConstraint> edgeConstraints;
+  std::vector<VertexConstraint> vertexConstraints;
+  std::vector<EdgeConstraint> edgeConstraints;
 
   void add(const Constraints& other) {
-    vertexConstraints.insert(other.vertexConstraints.begin(),
-                             other.vertexConstraints.end());
-    edgeConstraints.insert(other.edgeConstraints.begin(),
-                           other.edgeConstraints.end());
+    merge(vertexConstraints, other.vertexConstraints);
+    merge(edgeConstraints, other.edgeConstraints);
   }
 
-  bool overlap(const Constraints& other) {
+  bool overlap(const Constraints& other) const {
     std::vector<VertexConstraint> vertexIntersection;
     std::vector<EdgeConstraint> edgeIntersection;
     std::set_intersection(vertexConstraints.begin(), vertexConstraints.end(),
@@ -203,6 +176,174 @@ struct Constraints {
     }
     return os;
   }
+
+ private:
+  template <typename T>
+  static void merge(std::vector<T>& result, const std::vector<T>& other) {
+    size_t mid = result.size();
+    result.insert(result.end(), other.begin(), other.end());
+    std::inplace_merge(result.begin(), result.begin() + mid, result.end());
+  }
+};
+
+// Constraints of one agent bucketed by timestep, so that a lookup only
+// looks at the (usually zero to two) constraints of that timestep.
+class ConstraintTable {
+ public:
+  // rebuilds the table; reuses the memory of the previous one
+  void build(const Constraints& constraints, const mapf_adapters::Graph& g) {
+    m_vertexCells.clear();
+    m_vertexOffsets.clear();
+    for (const auto& vc : constraints.vertexConstraints) {
+      while (m_vertexOffsets.size() <= size_t(vc.time)) {
+        m_vertexOffsets.push_back(m_vertexCells.size());
+      }
+      m_vertexCells.push_back(g.index(vc.x, vc.y));
+    }
+    m_vertexOffsets.push_back(m_vertexCells.size());
+
+    m_edgeCells.clear();
+    m_edgeOffsets.clear();
+    for (const auto& ec : constraints.edgeConstraints) {
+      while (m_edgeOffsets.size() <= size_t(ec.time)) {
+        m_edgeOffsets.push_back(m_edgeCells.size());
+      }
+      m_edgeCells.emplace_back(g.index(ec.x1, ec.y1), g.index(ec.x2, ec.y2));
+    }
+    m_edgeOffsets.push_back(m_edgeCells.size());
+  }
+
+  // true if the agent must not be at cell at the given time
+  bool vertexConstrained(int time, int cell) const {
+    if (size_t(time) + 1 >= m_vertexOffsets.size()) {
+      return false;
+    }
+    for (size_t i = m_vertexOffsets[time]; i < m_vertexOffsets[time + 1]; ++i) {
+      if (m_vertexCells[i] == cell) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // true if the agent must not move from cell1 (at time) to cell2
+  bool edgeConstrained(int time, int cell1, int cell2) const {
+    if (size_t(time) + 1 >= m_edgeOffsets.size()) {
+      return false;
+    }
+    for (size_t i = m_edgeOffsets[time]; i < m_edgeOffsets[time + 1]; ++i) {
+      if (m_edgeCells[i].first == cell1 && m_edgeCells[i].second == cell2) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  // entries of timestep t are [offsets[t], offsets[t + 1])
+  std::vector<size_t> m_vertexOffsets;
+  std::vector<int> m_vertexCells;
+  std::vector<size_t> m_edgeOffsets;
+  std::vector<std::pair<int, int> > m_edgeCells;
+};
+
+// Agents per (cell, timestep) of a solution. An agent stays at the last cell
+// of its path forever. The index remembers which (immutable, shared) path it
+// holds for every agent, so syncing it to a child node of the last synced
+// node only re-indexes the replanned agent.
+class OccupancyIndex {
+ public:
+  explicit OccupancyIndex(const mapf_adapters::Graph& g)
+      : m_graph(g), m_cells(g.num_vertices()) {}
+
+  void sync(const SharedSolution<State, Action, int>& solution) {
+    if (m_paths.size() != solution.size()) {
+      for (auto& cell : m_cells) {
+        for (auto& agents : cell.agentsAt) {
+          agents.clear();
+        }
+        cell.parked.clear();
+      }
+      m_paths.assign(solution.size(), nullptr);
+    }
+    for (size_t i = 0; i < solution.size(); ++i) {
+      const auto& path = solution.share(i);
+      if (path != m_paths[i]) {
+        if (m_paths[i]) {
+          update(i, *m_paths[i], false);
+        }
+        update(i, *path, true);
+        m_paths[i] = path;
+      }
+    }
+  }
+
+  // calls f(agentIdx) for every agent at the given cell and timestep
+  template <typename F>
+  void forEach(int cell, int time, F f) const {
+    const Cell& c = m_cells[cell];
+    if (time < int(c.agentsAt.size())) {
+      for (size_t agentIdx : c.agentsAt[time]) {
+        f(agentIdx);
+      }
+    }
+    for (const auto& p : c.parked) {
+      if (p.first <= time) {
+        f(p.second);
+      }
+    }
+  }
+
+ private:
+  // The agents passing a cell are bucketed by timestep. An agent at the last
+  // cell of its path is kept apart with its arrival time instead.
+  struct Cell {
+    std::vector<std::vector<size_t> > agentsAt;
+    std::vector<std::pair<int, size_t> > parked;
+  };
+
+  template <typename T>
+  static void erase(std::vector<T>& v, const T& value) {
+    for (size_t k = 0; k < v.size(); ++k) {
+      if (v[k] == value) {
+        v[k] = v.back();
+        v.pop_back();
+        return;
+      }
+    }
+  }
+
+  void update(size_t agentIdx, const PlanResult<State, Action, int>& path,
+              bool insert) {
+    if (path.states.empty()) {
+      return;
+    }
+    const size_t last = path.states.size() - 1;
+    for (size_t t = 0; t < last; ++t) {
+      const State& s = path.states[t].first;
+      auto& buckets = m_cells[m_graph.index(s.x, s.y)].agentsAt;
+      if (!insert) {
+        erase(buckets[t], agentIdx);
+        continue;
+      }
+      if (buckets.size() <= t) {
+        buckets.resize(t + 1);
+      }
+      buckets[t].push_back(agentIdx);
+    }
+    const State& goal = path.states[last].first;
+    auto& parked = m_cells[m_graph.index(goal.x, goal.y)].parked;
+    std::pair<int, size_t> p(int(last), agentIdx);
+    if (insert) {
+      parked.push_back(p);
+    } else {
+      erase(parked, p);
+    }
+  }
+
+  const mapf_adapters::Graph& m_graph;
+  std::vector<Cell> m_cells;
+  std::vector<std::shared_ptr<const PlanResult<State, Action, int> > > m_paths;
 };
 
 struct Location {
@@ -239,7 +380,9 @@ struct hash<Location> {
 class Environment {
  public:
   Environment(std::unordered_set<Location> obstacles,
-              std::vector<Location> goals, mapf_adapters::Graph g)
+              std::vector<Location> goals, const mapf_adapters::Graph& g,
+              const mapf_adapters::heuristic_table& h,
+              bool prioritizeConflicts = false)
       : m_obstacles(std::move(obstacles)),
         m_goals(std::move(goals)),
         m_agentIdx(0),
@@ -247,9 +390,14 @@ class Environment {
         m_lastGoalConstraint(-1),
         m_highLevelExpanded(0),
         m_lowLevelExpanded(0),
-        graph(g) {
-    // computeHeuristic();
-  }
+        graph(g),
+        m_heuristic(h),
+        m_occupancy(g),
+        m_occupancySynced(false),
+        m_prioritizeConflicts(prioritizeConflicts),
+        m_mddMark(g.num_vertices(), 0),
+        m_mddStamp(0),
+        m_pairStamp(0) {}
 
   Environment(const Environment&) = delete;
   Environment& operator=(const Environment&) = delete;
@@ -258,58 +406,69 @@ class Environment {
     assert(constraints);  // NOLINT
     m_agentIdx = agentIdx;
     m_constraints = constraints;
+    m_constraintTable.build(*constraints, graph);
+    // the solution seen by the focal heuristics changes between low-level
+    // searches only
+    m_occupancySynced = false;
     m_lastGoalConstraint = -1;
-    for (const auto& vc : constraints->vertexConstraints) {
-      if (vc.x == m_goals[m_agentIdx].x && vc.y == m_goals[m_agentIdx].y) {
-        m_lastGoalConstraint = std::max(m_lastGoalConstraint, vc.time);
+    // constraints are sorted by time, so the first match from the back wins
+    const auto& vcs = constraints->vertexConstraints;
+    for (auto it = vcs.rbegin(); it != vcs.rend(); ++it) {
+      if (it->x == m_goals[m_agentIdx].x && it->y == m_goals[m_agentIdx].y) {
+        m_lastGoalConstraint = it->time;
+        break;
       }
     }
   }
 
   int admissibleHeuristic(const State& s) {
-    // std::cout << "H: " <<  s << " " << m_heuristic[m_agentIdx][s.x + m_dimx *
-    // s.y] << std::endl;
-    // return m_heuristic[m_agentIdx][s.x + m_dimx * s.y];
-    return std::abs(s.x - m_goals[m_agentIdx].x) +
-           std::abs(s.y - m_goals[m_agentIdx].y);
+    return m_heuristic.get(m_agentIdx, s.x, s.y);
+  }
+
+  // dense id of a (time, cell) state; lets the low-level A* use flat arrays
+  size_t denseIndex(const State& s) {
+    return size_t(s.time) * graph.num_vertices() + graph.index(s.x, s.y);
   }
 
   // low-level
   int focalStateHeuristic(
       const State& s, int /*gScore*/,
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
+    syncOccupancy(solution);
     int numConflicts = 0;
-    for (size_t i = 0; i < solution.size(); ++i) {
-      if (i != m_agentIdx && !solution[i].states.empty()) {
-        State state2 = getState(i, solution, s.time);
-        if (s.equalExceptTime(state2)) {
-          ++numConflicts;
-        }
+    m_occupancy.forEach(graph.index(s.x, s.y), s.time, [&](size_t i) {
+      if (i != m_agentIdx) {
+        ++numConflicts;
       }
-    }
+    });
     return numConflicts;
   }
 
   // low-level
   int focalTransitionHeuristic(
       const State& s1a, const State& s1b, int /*gScoreS1a*/, int /*gScoreS1b*/,
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
+    syncOccupancy(solution);
     int numConflicts = 0;
-    for (size_t i = 0; i < solution.size(); ++i) {
-      if (i != m_agentIdx && !solution[i].states.empty()) {
-        State s2a = getState(i, solution, s1a.time);
-        State s2b = getState(i, solution, s1b.time);
-        if (s1a.equalExceptTime(s2b) && s1b.equalExceptTime(s2a)) {
-          ++numConflicts;
-        }
+    m_occupancy.forEach(graph.index(s1b.x, s1b.y), s1a.time, [&](size_t i) {
+      if (i != m_agentIdx &&
+          s1a.equalExceptTime(getState(i, solution, s1b.time))) {
+        ++numConflicts;
       }
-    }
+    });
     return numConflicts;
   }
 
-  // Count all conflicts
   int focalHeuristic(
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
+    return countConflicts(solution);
+  }
+
+  // Count all conflicts
+  int countConflicts(
+      const SharedSolution<State, Action, int>& solution) {
+    m_occupancy.sync(solution);
+    m_occupancySynced = false;
     int numConflicts = 0;
 
     int max_t = 0;
@@ -318,28 +477,24 @@ class Environment {
     }
 
     for (int t = 0; t < max_t; ++t) {
-      // check drive-drive vertex collisions
-      for (size_t i = 0; i < solution.size(); ++i) {
-        State state1 = getState(i, solution, t);
-        for (size_t j = i + 1; j < solution.size(); ++j) {
-          State state2 = getState(j, solution, t);
-          if (state1.equalExceptTime(state2)) {
-            ++numConflicts;
-          }
-        }
-      }
-      // drive-drive edge (swap)
       for (size_t i = 0; i < solution.size(); ++i) {
         State state1a = getState(i, solution, t);
         State state1b = getState(i, solution, t + 1);
-        for (size_t j = i + 1; j < solution.size(); ++j) {
-          State state2a = getState(j, solution, t);
-          State state2b = getState(j, solution, t + 1);
-          if (state1a.equalExceptTime(state2b) &&
-              state1b.equalExceptTime(state2a)) {
-            ++numConflicts;
-          }
-        }
+        // drive-drive vertex collisions
+        m_occupancy.forEach(graph.index(state1a.x, state1a.y), t,
+                            [&](size_t j) {
+                              if (j > i) {
+                                ++numConflicts;
+                              }
+                            });
+        // drive-drive edge (swap)
+        m_occupancy.forEach(
+            graph.index(state1b.x, state1b.y), t, [&](size_t j) {
+              if (j > i &&
+                  state1a.equalExceptTime(getState(j, solution, t + 1))) {
+                ++numConflicts;
+              }
+            });
       }
     }
     return numConflicts;
@@ -358,77 +513,85 @@ class Environment {
     //   std::endl;
     // }
     neighbors.clear();
-    
-    std::vector<std::pair<int, int> > g_neighbor = graph.get_neighbor(s.x, s.y);
-    g_neighbor.emplace_back(std::make_pair(s.x, s.y));
-
-    for(auto it = g_neighbor.begin(); it != g_neighbor.end(); ++it){
-    	State n(s.time + 1, it->first, it->second);
-    	if(stateValid(n) && transitionValid(s, n)){
-    		if(s.x == n.x && s.y == n.y)
-	    		neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Wait, 1));
-	    	else if(s.x == n.x){
-	    		if(s.y + 1 == n.y)
-	    			neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Up, 1));
-	    		else
-	    			neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Down, 1));
-	    	}
-	    	else if(s.y == n.y){
-	    		if(s.x + 1 == n.x)
-	    			neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Right, 1));
-	    		else
-	    			neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Left, 1));
-	    	}
-    	}
+
+    for (int v : graph.neighbors(s.x, s.y)) {
+      State n(s.time + 1, graph.get_x(v), graph.get_y(v));
+      if (stateValid(n) && transitionValid(s, n)) {
+        if (s.x == n.x) {
+          if (s.y + 1 == n.y)
+            neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Up, 1));
+          else
+            neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Down, 1));
+        } else {
+          if (s.x + 1 == n.x)
+            neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Right, 1));
+          else
+            neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Left, 1));
+        }
+      }
+    }
+    {
+      State n(s.time + 1, s.x, s.y);
+      if (stateValid(n) && transitionValid(s, n)) {
+        neighbors.emplace_back(Neighbor<State, Action, int>(n, Action::Wait, 1));
+      }
     }
   }
 
   bool getFirstConflict(
-      const std::vector<PlanResult<State, Action, int> >& solution,
+      const SharedSolution<State, Action, int>& solution,
       Conflict& result) {
+    m_occupancy.sync(solution);
+    m_occupancySynced = false;
     int max_t = 0;
     for (const auto& sol : solution) {
       max_t = std::max<int>(max_t, sol.states.size() - 1);
     }
 
+    const size_t none = solution.size();
     for (int t = 0; t < max_t; ++t) {
       // check drive-drive vertex collisions
       for (size_t i = 0; i < solution.size(); ++i) {
         State state1 = getState(i, solution, t);
-        for (size_t j = i + 1; j < solution.size(); ++j) {
-          State state2 = getState(j, solution, t);
-          if (state1.equalExceptTime(state2)) {
-            result.time = t;
-            result.agent1 = i;
-            result.agent2 = j;
-            result.type = Conflict::Vertex;
-            result.x1 = state1.x;
-            result.y1 = state1.y;
-            // std::cout << "VC " << t << "," << state1.x << "," << state1.y <<
-            // std::endl;
-            return true;
-          }
+        size_t j = none;
+        m_occupancy.forEach(graph.index(state1.x, state1.y), t,
+                            [&](size_t k) {
+                              if (k > i && k < j) {
+                                j = k;
+                              }
+                            });
+        if (j != none) {
+          result.time = t;
+          result.agent1 = i;
+          result.agent2 = j;
+          result.type = Conflict::Vertex;
+          result.x1 = state1.x;
+          result.y1 = state1.y;
+          return true;
         }
       }
       // drive-drive edge (swap)
       for (size_t i = 0; i < solution.size(); ++i) {
         State state1a = getState(i, solution, t);
         State state1b = getState(i, solution, t + 1);
-        for (size_t j = i + 1; j < solution.size(); ++j) {
-          State state2a = getState(j, solution, t);
-          State state2b = getState(j, solution, t + 1);
-          if (state1a.equalExceptTime(state2b) &&
-              state1b.equalExceptTime(state2a)) {
-            result.time = t;
-            result.agent1 = i;
-            result.agent2 = j;
-            result.type = Conflict::Edge;
-            result.x1 = state1a.x;
-            result.y1 = state1a.y;
-            result.x2 = state1b.x;
-            result.y2 = state1b.y;
-            return true;
-          }
+        size_t j = none;
+        m_occupancy.forEach(
+            graph.index(state1b.x, state1b.y), t, [&](size_t k) {
+              if (k > i && k < j &&
+                  state1a.equalExceptTime(getState(k, solution, t + 1))) {
+                j = k;
+              }
+            });
+        if (j != none) {
+          result.time = t;
+          result.agent1 = i;
+          result.agent2 = j;
+          result.type = Conflict::Edge;
+          result.x1 = state1a.x;
+          result.y1 = state1a.y;
+          result.x2 = state1b.x;
+          result.y2 = state1b.y;
+          return true;
         }
       }
     }
@@ -436,21 +599,111 @@ class Environment {
     return false;
   }
 
+  // Prefers cardinal over semi-cardinal over non-cardinal conflicts (earliest
+  // first within each class). A conflict is cardinal for an agent if all paths
+  // of its current cost pass the conflicting vertex or edge, i.e. if its MDD
+  // has width one there.
+  bool getBestConflict(const SharedSolution<State, Action, int>& solution,
+                       const SharedConstraints<Constraints>& constraints,
+                       Conflict& result) {
+    if (!m_prioritizeConflicts) {
+      return getFirstConflict(solution, result);
+    }
+    m_occupancy.sync(solution);
+    m_occupancySynced = false;
+    int max_t = 0;
+    for (const auto& sol : solution) {
+      max_t = std::max<int>(max_t, sol.states.size() - 1);
+    }
+
+    // only the first conflict of every pair of agents is considered
+    const size_t n = solution.size();
+    if (m_pairMark.size() < n * n) {
+      m_pairMark.assign(n * n, 0);
+      m_pairStamp = 0;
+    }
+    ++m_pairStamp;
+    int bestCardinality = -1;
+    auto consider = [&](const Conflict& c) {
+      int& mark = m_pairMark[c.agent1 * n + c.agent2];
+      if (mark == m_pairStamp) {
+        return false;
+      }
+      mark = m_pairStamp;
+      int cardinality =
+          isCardinal(c.agent1, c, solution, constraints) +
+          isCardinal(c.agent2, c, solution, constraints);
+      if (cardinality > bestCardinality) {
+        bestCardinality = cardinality;
+        result = c;
+      }
+      return cardinality == 2;
+    };
+
+    Conflict c;
+    for (int t = 0; t < max_t; ++t) {
+      c.time = t;
+      // drive-drive vertex collisions
+      c.type = Conflict::Vertex;
+      for (size_t i = 0; i < n; ++i) {
+        State state1 = getState(i, solution, t);
+        bool cardinal = false;
+        m_occupancy.forEach(graph.index(state1.x, state1.y), t,
+                            [&](size_t j) {
+                              if (j > i && !cardinal) {
+                                c.agent1 = i;
+                                c.agent2 = j;
+                                c.x1 = state1.x;
+                                c.y1 = state1.y;
+                                cardinal = consider(c);
+                              }
+                            });
+        if (cardinal) {
+          return true;
+        }
+      }
+      // drive-drive edge (swap)
+      c.type = Conflict::Edge;
+      for (size_t i = 0; i < n; ++i) {
+        State state1a = getState(i, solution, t);
+        State state1b = getState(i, solution, t + 1);
+        bool cardinal = false;
+        m_occupancy.forEach(
+            graph.index(state1b.x, state1b.y), t, [&](size_t j) {
+              if (j > i && !cardinal &&
+                  state1a.equalExceptTime(getState(j, solution, t + 1))) {
+                c.agent1 = i;
+                c.agent2 = j;
+                c.x1 = state1a.x;
+                c.y1 = state1a.y;
+                c.x2 = state1b.x;
+                c.y2 = state1b.y;
+                cardinal = consider(c);
+              }
+            });
+        if (cardinal) {
+          return true;
+        }
+      }
+    }
+    return bestCardinality >= 0;
+  }
+
   void createConstraintsFromConflict(
       const Conflict& conflict, std::map<size_t, Constraints>& constraints) {
     if (conflict.type == Conflict::Vertex) {
       Constraints c1;
-      c1.vertexConstraints.emplace(
+      c1.vertexConstraints.emplace_back(
           VertexConstraint(conflict.time, conflict.x1, conflict.y1));
       constraints[conflict.agent1] = c1;
       constraints[conflict.agent2] = c1;
     } else if (conflict.type == Conflict::Edge) {
       Constraints c1;
-      c1.edgeConstraints.emplace(EdgeConstraint(
+      c1.edgeConstraints.emplace_back(EdgeConstraint(
           conflict.time, conflict.x1, conflict.y1, conflict.x2, conflict.y2));
       constraints[conflict.agent1] = c1;
       Constraints c2;
-      c2.edgeConstraints.emplace(EdgeConstraint(
+      c2.edgeConstraints.emplace_back(EdgeConstraint(
           conflict.time, conflict.x2, conflict.y2, conflict.x1, conflict.y1));
       constraints[conflict.agent2] = c2;
     }
@@ -469,7 +722,7 @@ class Environment {
 
  private:
   State getState(size_t agentIdx,
-                 const std::vector<PlanResult<State, Action, int> >& solution,
+                 const SharedSolution<State, Action, int>& solution,
                  size_t t) {
     assert(agentIdx < solution.size());
     if (t < solution[agentIdx].states.size()) {
@@ -479,29 +732,166 @@ class Environment {
     return solution[agentIdx].states.back().first;
   }
 
+  bool isCardinal(size_t agentIdx, const Conflict& c,
+                  const SharedSolution<State, Action, int>& solution,
+                  const SharedConstraints<Constraints>& constraints) {
+    const auto& path = solution[agentIdx];
+    int cost = path.states.size() - 1;
+    if (c.type == Conflict::Vertex) {
+      if (c.time >= cost) {
+        // the agent waits at its goal; it has to arrive later
+        return true;
+      }
+      const auto& mdd = getMDD(agentIdx, cost, path, constraints);
+      return mdd[c.time] == graph.index(c.x1, c.y1);
+    }
+    if (c.time >= cost) {
+      return false;
+    }
+    // agent1 moves from (x1, y1) to (x2, y2), agent2 the other way
+    int from = graph.index(c.x1, c.y1);
+    int to = graph.index(c.x2, c.y2);
+    if (agentIdx == c.agent2) {
+      std::swap(from, to);
+    }
+    const auto& mdd = getMDD(agentIdx, cost, path, constraints);
+    return mdd[c.time] == from && mdd[c.time + 1] == to;
+  }
+
+  // For every timestep of an MDD of the given cost the only vertex of that
+  // layer, or -1 if the layer has several vertices. Cached per agent,
+  // constraint set and cost; the least recently used entry is evicted once
+  // the cache is full.
+  const std::vector<int>& getMDD(
+      size_t agentIdx, int cost, const PlanResult<State, Action, int>& path,
+      const SharedConstraints<Constraints>& constraints) {
+    std::shared_ptr<const void> id = constraints.id(agentIdx);
+    auto key = std::make_tuple(agentIdx, id.get(), cost);
+    auto it = m_mddCache.find(key);
+    if (it != m_mddCache.end()) {
+      m_mddLru.splice(m_mddLru.begin(), m_mddLru, it->second.lru);
+      return it->second.singletons;
+    }
+    if (m_mddCache.size() >= kMDDCacheCapacity) {
+      m_mddCache.erase(m_mddLru.back());
+      m_mddLru.pop_back();
+    }
+    m_mddLru.push_front(key);
+    MDDEntry& entry = m_mddCache[key];
+    entry.constraintsId = std::move(id);
+    entry.lru = m_mddLru.begin();
+
+    Constraints agentConstraints;
+    constraints.collect(agentIdx, agentConstraints);
+    m_mddConstraintTable.build(agentConstraints, graph);
+    const State& start = path.states.front().first;
+    int goal = graph.index(m_goals[agentIdx].x, m_goals[agentIdx].y);
+
+    // forward: all valid states from which the goal is reachable in time
+    std::vector<std::vector<int> > layers(cost + 1);
+    layers[0].push_back(graph.index(start.x, start.y));
+    for (int t = 0; t < cost; ++t) {
+      ++m_mddStamp;
+      for (int u : layers[t]) {
+        forEachMove(u, [&](int v) {
+          if (m_mddMark[v] != m_mddStamp &&
+              t + 1 + m_heuristic.get(agentIdx, v) <= cost &&
+              !m_mddConstraintTable.vertexConstrained(t + 1, v) &&
+              !m_mddConstraintTable.edgeConstrained(t, u, v)) {
+            m_mddMark[v] = m_mddStamp;
+            layers[t + 1].push_back(v);
+          }
+        });
+      }
+    }
+
+    // backward: keep the states that lie on a path to the goal
+    entry.singletons.assign(cost + 1, -1);
+    entry.singletons[cost] = goal;
+    ++m_mddStamp;
+    m_mddMark[goal] = m_mddStamp;
+    std::vector<int> kept;
+    for (int t = cost - 1; t >= 0; --t) {
+      int next = m_mddStamp++;
+      kept.clear();
+      for (int u : layers[t]) {
+        bool onPath = false;
+        forEachMove(u, [&](int v) {
+          onPath = onPath || (m_mddMark[v] == next &&
+                              !m_mddConstraintTable.edgeConstrained(t, u, v));
+        });
+        if (onPath) {
+          kept.push_back(u);
+        }
+      }
+      for (int u : kept) {
+        m_mddMark[u] = m_mddStamp;
+      }
+      if (kept.size() == 1) {
+        entry.singletons[t] = kept[0];
+      }
+    }
+    return entry.singletons;
+  }
+
+  // calls f(v) for every cell v reachable from u in one step (incl. waiting)
+  template <typename F>
+  void forEachMove(int u, F f) const {
+    for (int v : graph.neighbors(u)) {
+      f(v);
+    }
+    f(u);
+  }
+
+  void syncOccupancy(const SharedSolution<State, Action, int>& solution) {
+    if (!m_occupancySynced) {
+      m_occupancy.sync(solution);
+      m_occupancySynced = true;
+    }
+  }
+
   bool stateValid(const State& s) {
     assert(m_constraints);
-    const auto& con = m_constraints->vertexConstraints;
-    return con.find(VertexConstraint(s.time, s.x, s.y)) == con.end();
+    return !m_constraintTable.vertexConstrained(s.time,
+                                                graph.index(s.x, s.y));
   }
 
   bool transitionValid(const State& s1, const State& s2) {
     assert(m_constraints);
-    const auto& con = m_constraints->edgeConstraints;
-    return con.find(EdgeConstraint(s1.time, s1.x, s1.y, s2.x, s2.y)) ==
-           con.end();
+    return !m_constraintTable.edgeConstrained(
+        s1.time, graph.index(s1.x, s1.y), graph.index(s2.x, s2.y));
   }
 
  private:
   std::unordered_set<Location> m_obstacles;
   std::vector<Location> m_goals;
-  // std::vector< std::vector<int> > m_heuristic;
   size_t m_agentIdx;
   const Constraints* m_constraints;
+  ConstraintTable m_constraintTable;
   int m_lastGoalConstraint;
   int m_highLevelExpanded;
   int m_lowLevelExpanded;
-  mapf_adapters::Graph graph;
+  const mapf_adapters::Graph& graph;
+  const mapf_adapters::heuristic_table& m_heuristic;
+  OccupancyIndex m_occupancy;
+  bool m_occupancySynced;
+
+  typedef std::tuple<size_t, const void*, int> MDDKey;
+  struct MDDEntry {
+    // keeps the constraint set alive, so its address is not reused
+    std::shared_ptr<const void> constraintsId;
+    std::vector<int> singletons;
+    std::list<MDDKey>::iterator lru;
+  };
+  static constexpr size_t kMDDCacheCapacity = 4096;
+  bool m_prioritizeConflicts;
+  std::map<MDDKey, MDDEntry> m_mddCache;
+  std::list<MDDKey> m_mddLru;  // most recently used first
+  ConstraintTable m_mddConstraintTable;
+  std::vector<int> m_mddMark;
+  int m_mddStamp;
+  std::vector<int> m_pairMark;  // agent pairs seen by getBestConflict
+  int m_pairStamp;
 };
 
 #endif
\ No newline at end of file
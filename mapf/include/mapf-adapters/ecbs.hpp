@@ -3,6 +3,8 @@
 
 #include <fstream>
 #include <iostream>
+#include <list>
+#include <unordered_set>
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
@@ -12,7 +14,11 @@
 #include <libMultiRobotPlanning/ecbs.hpp>
 #include "mapf.hpp"
 #include "definitions.hpp"
+#include "id.hpp"
+#include "budget.hpp"
+#include <atomic>
 #include <chrono>
+#include <memory>
 
 using libMultiRobotPlanning::ECBS;
 using libMultiRobotPlanning::Neighbor;
@@ -22,12 +28,27 @@ using mapf_adapters::mapf;
 namespace ecbs{
 	class solver{
 	public:
-		solver()	{}
+		solver(size_t num_threads = 1, bool prioritize_conflicts = false, bool bypass = false, bool independence_detection = false):
+			num_threads(num_threads),
+			prioritize_conflicts(prioritize_conflicts),
+			bypass(bypass),
+			independence_detection(independence_detection),
+			high_level_expanded(0),
+			low_level_expanded(0)	{}
+
+		// limits every later solve; the budget may be shared with other solvers
+		void set_budget(std::shared_ptr<mapf_adapters::budget> limits){	this->limits = limits;	}
+
+		// plans all agents jointly and adds to the expansion counters; safe to call from several threads
+		bool plan(const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& starts, float w, mapf_adapters::joint_solution* joint){
+			return plan(map, starts, w, joint, num_threads);
+		}
 
-		bool solve(mapf_adapters::mapf map, std::vector<std::pair<int, int> > starts, float w){
+		// as above, with low-level searches on the given number of threads instead of those of the solver
+		bool plan(const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& starts, float w, mapf_adapters::joint_solution* joint, size_t threads){
 			
-			std::vector<std::pair<int, int> > obs = map.get_obstacles();
-			std::vector<std::pair<int, int> > gl = map.get_goals();
+			const std::vector<std::pair<int, int> >& obs = map.get_obstacles();
+			const std::vector<std::pair<int, int> >& gl = map.get_goals();
 
 			std::unordered_set<Location> obstacles;
 			std::vector<Location> goals;
@@ -45,38 +66,89 @@ namespace ecbs{
 				startStates.emplace_back(State(0, it->first, it->second));
 			}
 
-			Environment mapf(obstacles, goals, map.get_graph());
-			ECBS<State, Action, int, Conflict, Constraints, Environment> cbs(mapf, w);
+			std::shared_ptr<const mapf_adapters::heuristic_table> h = map.get_heuristic();
+			if(!h){
+				h = std::make_shared<const mapf_adapters::heuristic_table>(map.get_graph(), gl, threads);
+			}
+
+			Environment mapf(obstacles, goals, map.get_graph(), *h, prioritize_conflicts);
+			// low-level searches of different threads need separate environments
+			std::vector<std::unique_ptr<Environment> > workers;
+			std::vector<Environment*> low_level_envs(1, &mapf);
+			for(size_t k = 1; k < threads; ++k){
+				workers.emplace_back(new Environment(obstacles, goals, map.get_graph(), *h));
+				low_level_envs.push_back(workers.back().get());
+			}
+			ECBS<State, Action, int, Conflict, Constraints, Environment> cbs(mapf, w, low_level_envs);
+			cbs.setBypass(bypass);
+			if(limits){
+				std::shared_ptr<mapf_adapters::budget> b = limits;
+				cbs.setInterrupt([b](size_t expanded, int){
+					return b->interrupted(expanded, -1);
+				});
+			}
 			std::vector<PlanResult<State, Action, int> > solution;
 
 
-			auto ecbs_start = std::chrono::system_clock::now();
 			bool success = cbs.search(startStates, solution);
+
+			high_level_expanded += mapf.highLevelExpanded();
+			for(const Environment* env : low_level_envs){
+				low_level_expanded += env->lowLevelExpanded();
+			}
+			if(!success){
+				return false;
+			}
+			joint->first = 0;
+			joint->second.clear();
+			for (const auto& s : solution) {
+				joint->first += s.cost;
+				joint->second.emplace_back();
+				for (const auto& state : s.states) {
+					joint->second.back().emplace_back(state.first.x, state.first.y);
+				}
+			}
+			return true;
+		}
+
+		bool solve(const mapf_adapters::mapf& map, const std::vector<std::pair<int, int> >& starts, float w){
+			high_level_expanded = 0;
+			low_level_expanded = 0;
+			mapf_adapters::joint_solution solution;
+
+			auto ecbs_start = std::chrono::system_clock::now();
+			bool success;
+			if(independence_detection){
+				mapf_adapters::independence_detection id([&](const mapf_adapters::mapf& group, const std::vector<std::pair<int, int> >& group_starts, mapf_adapters::joint_solution* joint, size_t group_threads){
+					return plan(group, group_starts, w, joint, group_threads);
+				}, num_threads);
+				success = id.solve(map, starts, &solution);
+			}else{
+				success = plan(map, starts, w, &solution);
+			}
 			auto ecbs_end = std::chrono::system_clock::now();
 
 			if (success) {
 				std::cout << "Planning successful! " << std::endl;
-				int cost = 0;
 				int makespan = 0;
-				for (const auto& s : solution) {
-					cost += s.cost;
-					makespan = std::max<int>(makespan, s.cost);
+				for (const auto& path : solution.second) {
+					makespan = std::max<int>(makespan, path.size() - 1);
 				}
 
 				std::ofstream out("../example/output_ecbs.yaml");
 				out << "statistics:" << std::endl;
-				out << "  cost: " << cost << std::endl;
+				out << "  cost: " << solution.first << std::endl;
 				out << "  makespan: " << makespan << std::endl;
 				out << "  runtime: " << std::chrono::duration<double>(ecbs_end - ecbs_start).count() << std::endl;
-				out << "  highLevelExpanded: " << mapf.highLevelExpanded() << std::endl;
-				out << "  lowLevelExpanded: " << mapf.lowLevelExpanded() << std::endl;
+				out << "  highLevelExpanded: " << high_level_expanded << std::endl;
+				out << "  lowLevelExpanded: " << low_level_expanded << std::endl;
 				out << "schedule:" << std::endl;
-				for (size_t a = 0; a < solution.size(); ++a) {
+				for (size_t a = 0; a < solution.second.size(); ++a) {
 					out << "  agent" << a << ":" << std::endl;
-					for (const auto& state : solution[a].states) {
-						out << "    - x: " << state.first.x << std::endl
-							<< "      y: " << state.first.y << std::endl
-							<< "      t: " << state.second << std::endl;
+					for (size_t t = 0; t < solution.second[a].size(); ++t) {
+						out << "    - x: " << solution.second[a][t].first << std::endl
+							<< "      y: " << solution.second[a][t].second << std::endl
+							<< "      t: " << t << std::endl;
 					}
 				}
 				return true;
@@ -85,6 +157,12 @@ namespace ecbs{
 				return false;
 			}
 		}
+
+	private:
+		size_t num_threads;
+		bool prioritize_conflicts, bypass, independence_detection;
+		std::atomic<int> high_level_expanded, low_level_expanded;
+		std::shared_ptr<mapf_adapters::budget> limits;
 	};
 }
 
@@ -8,26 +8,61 @@
 
 #include <epea/epea.hpp>
 #include "mapf.hpp"
+#include "id.hpp"
+#include "budget.hpp"
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
 
 #include <chrono>
+#include <memory>
 
 using namespace EPEA;
 
 namespace epea{
   class solver{
   public:
-    solver()  {}
+    solver(bool independence_detection = false, size_t num_threads = 1):
+      independence_detection(independence_detection),
+      num_threads(num_threads)  {}
 
-    bool solve(mapf_adapters::mapf map_obj, std::vector<std::pair<int, int> > starts){
+    // limits every later solve; the budget may be shared with other solvers
+    void set_budget(std::shared_ptr<mapf_adapters::budget> limits){ this->limits = limits; }
 
-      std::pair<int, std::vector< std::vector< std::pair<int, int> > > > solution;
+    // plans all agents jointly; safe to call from several threads
+    bool plan(const mapf_adapters::mapf& map_obj, const std::vector<std::pair<int, int> >& starts, mapf_adapters::joint_solution* solution) const {
       EPEA::EPEAStar<mapf_adapters::mapf> mapf_epea;
+      if (map_obj.get_heuristic()) {
+        std::vector<const uint16_t*> tables;
+        for (size_t k = 0; k < map_obj.get_goals().size(); ++k) {
+          tables.push_back(map_obj.get_heuristic()->table(k));
+        }
+        mapf_epea.set_goal_distances(tables);
+      }
+      if (limits) {
+        std::shared_ptr<mapf_adapters::budget> b = limits;
+        mapf_epea.set_interrupt([b](int expanded, int lower_bound){
+          return b->interrupted(expanded, lower_bound);
+        });
+      }
+      return mapf_epea.search(map_obj, starts, solution);
+    }
+
+    bool solve(const mapf_adapters::mapf& map_obj, const std::vector<std::pair<int, int> >& starts){
+
+      mapf_adapters::joint_solution solution;
 
       auto epea_start = std::chrono::system_clock::now();
-      bool success = mapf_epea.search(map_obj, starts, &solution);
+      bool success;
+      if (independence_detection) {
+        // EPEA* is single-threaded; the threads only solve groups in parallel
+        mapf_adapters::independence_detection id([this](const mapf_adapters::mapf& group, const std::vector<std::pair<int, int> >& group_starts, mapf_adapters::joint_solution* joint, size_t){
+          return plan(group, group_starts, joint);
+        }, num_threads);
+        success = id.solve(map_obj, starts, &solution);
+      } else {
+        success = plan(map_obj, starts, &solution);
+      }
       auto epea_end = std::chrono::system_clock::now();
       auto epea_time = std::chrono::duration<double>(epea_end - epea_start).count();
 
@@ -60,6 +95,11 @@ namespace epea{
       }
       return true;
     }
+
+  private:
+    bool independence_detection;
+    size_t num_threads;
+    std::shared_ptr<mapf_adapters::budget> limits;
   };
 }
 
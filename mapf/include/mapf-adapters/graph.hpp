@@ -3,81 +3,94 @@
 
 #include <iostream>
 #include <vector>
-#include <unordered_set>
 
 namespace mapf_adapters{
+	/*
+	4-connected grid graph in compressed sparse row form. The free neighbors of
+	vertex xy = x*y_dim + y are adjacency[offsets[xy]] .. adjacency[offsets[xy+1]-1],
+	ordered left, right, up, down. Obstacles are vertices without neighbors.
+	*/
 	class Graph{
 	public:
-		Graph(int x, int y, std::vector<std::pair<int, int> > obstacles):
+		// contiguous, non-owning view of the neighbors of one vertex
+		class neighbor_range{
+		public:
+			neighbor_range(const int* first, const int* last):
+				first(first),
+				last(last)	{}
+
+			const int* begin() const {	return first;	}
+			const int* end() const {	return last;	}
+			size_t size() const {	return last - first;	}
+			bool empty() const {	return first == last;	}
+
+		private:
+			const int* first;
+			const int* last;
+		};
+
+		Graph(int x, int y, const std::vector<std::pair<int, int> >& obstacles):
 			x_dim(x),
 			y_dim(y)	{
-				adjacency_list.resize(x_dim*y_dim);
 				generate_graph(obstacles);
 		}
 		Graph():
 			x_dim(0),
-			y_dim(0)	{
+			y_dim(0),
+			offsets(1, 0)	{
 
 			}
 
-		void generate_graph(std::vector<std::pair<int, int> > obstacles){
+		void generate_graph(const std::vector<std::pair<int, int> >& obstacles){
 			//i*y_dim + j
-			std::unordered_set<int> processed_obstacles;
+			std::vector<char> blocked(x_dim*y_dim, 0);
 			for(auto it = obstacles.begin(); it != obstacles.end(); ++it){
-				int x = it->first;
-				int y = it->second;
-				int new_xy = x*y_dim + y;
-				processed_obstacles.insert(new_xy);
+				blocked[it->first*y_dim + it->second] = 1;
 			}
 
+			offsets.assign(x_dim*y_dim + 1, 0);
+			adjacency.clear();
+			adjacency.reserve(4*x_dim*y_dim);
 			for(int i = 0; i < x_dim; ++i){
 				for(int j = 0; j < y_dim; ++j){
 					int xy = i*y_dim + j;
-					if(processed_obstacles.find(xy) != processed_obstacles.end()){
-						//Obstacle
-						adjacency_list[xy] = std::vector< int >();
-					} else {
-						//Not an Obstacle
-						std::vector< int > temp;
-						temp.clear();
-						if(j-1 >= 0 && processed_obstacles.find((i*y_dim)+(j-1)) == processed_obstacles.end()){
-							int left = (i*y_dim) + (j-1);
-							temp.push_back(left);
+					if(!blocked[xy]){
+						if(j-1 >= 0 && !blocked[xy-1]){
+							adjacency.push_back(xy-1);
 						}
-						if(j+1 < y_dim && processed_obstacles.find((i*y_dim)+(j+1)) == processed_obstacles.end()){
-							int right = (i*y_dim) + (j+1);
-							temp.push_back(right);	
+						if(j+1 < y_dim && !blocked[xy+1]){
+							adjacency.push_back(xy+1);
 						}
-						if(i-1 >= 0 && processed_obstacles.find(((i-1)*y_dim)+(j)) == processed_obstacles.end()){
-							int up = ((i-1)*y_dim) + j;
-							temp.push_back(up);
+						if(i-1 >= 0 && !blocked[xy-y_dim]){
+							adjacency.push_back(xy-y_dim);
 						}
-						if(i+1 < x_dim && processed_obstacles.find(((i+1)*y_dim)+(j)) == processed_obstacles.end()){
-							int down = ((i+1)*y_dim) + j;
-							temp.push_back(down);
+						if(i+1 < x_dim && !blocked[xy+y_dim]){
+							adjacency.push_back(xy+y_dim);
 						}
-						adjacency_list[xy] = temp;
 					}
+					offsets[xy+1] = adjacency.size();
 				}
 			}
+			adjacency.shrink_to_fit();
 		}
 
-		std::vector<std::pair<int, int> > get_neighbor(int x, int y){
-			int xy = x*y_dim + y;
-			std::vector<std::pair<int, int> > temp = std::vector<std::pair<int, int> >();
-			for(auto it=adjacency_list[xy].begin(); it!=adjacency_list[xy].end(); ++it){
-				int val = *it;
-				int i = val/y_dim;
-				int j = val%y_dim;
-				temp.push_back(std::make_pair(i, j));
-			}
-			return temp;
+		int get_x_dim() const {	return x_dim;	}
+		int get_y_dim() const {	return y_dim;	}
+		int index(int x, int y) const {	return x*y_dim + y;	}
+		int get_x(int xy) const {	return xy/y_dim;	}
+		int get_y(int xy) const {	return xy%y_dim;	}
+		int num_vertices() const {	return offsets.size() - 1;	}
+
+		neighbor_range neighbors(int xy) const {
+			return neighbor_range(adjacency.data() + offsets[xy], adjacency.data() + offsets[xy+1]);
 		}
+		neighbor_range neighbors(int x, int y) const {	return neighbors(index(x, y));	}
 
-		std::vector<std::vector<int> > get_adj(){	return adjacency_list;	}
+		const std::vector<int>& get_offsets() const {	return offsets;	}
+		const std::vector<int>& get_adj() const {	return adjacency;	}
 	private:
-		std::vector< std::vector< int > > adjacency_list;
 		int x_dim, y_dim;
+		std::vector<int> offsets, adjacency;
 	};
 }
 
@@ -0,0 +1,87 @@
+#ifndef MAPFADAPTERS_HEURISTIC_HPP
+#define MAPFADAPTERS_HEURISTIC_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "graph.hpp"
+
+namespace mapf_adapters{
+	const uint16_t unreachable = 0xFFFF;
+
+	/*
+	True shortest-path distances from every vertex to every goal, computed with
+	one backward BFS per goal. The tables are stored back to back in one flat
+	uint16_t array (goal k occupies [k*|V|, (k+1)*|V|)). Distances that do not
+	fit are clamped, which keeps the heuristic admissible; vertices that cannot
+	reach the goal are marked unreachable.
+	*/
+	class heuristic_table{
+	public:
+		heuristic_table(const Graph& g, const std::vector<std::pair<int, int> >& goals, size_t num_threads = 1):
+			y_dim(g.get_y_dim()),
+			num_vertices(g.num_vertices()),
+			distances(goals.size()*g.num_vertices(), unreachable)	{
+				num_threads = std::max<size_t>(1, std::min(num_threads, goals.size()));
+				std::atomic<size_t> next_goal(0);
+				auto worker = [&](){
+					std::vector<int> queue(num_vertices);
+					size_t k;
+					while((k = next_goal.fetch_add(1)) < goals.size()){
+						bfs(g, g.index(goals[k].first, goals[k].second), &distances[k*num_vertices], queue);
+					}
+				};
+				std::vector<std::thread> threads;
+				for(size_t i = 1; i < num_threads; ++i){
+					threads.emplace_back(worker);
+				}
+				worker();
+				for(auto& t : threads){
+					t.join();
+				}
+		}
+
+		// the tables of the given goals of another table, in the given order
+		heuristic_table(const heuristic_table& other, const std::vector<size_t>& goals):
+			y_dim(other.y_dim),
+			num_vertices(other.num_vertices)	{
+				distances.reserve(goals.size()*num_vertices);
+				for(size_t k : goals){
+					distances.insert(distances.end(), other.table(k), other.table(k) + num_vertices);
+				}
+		}
+
+		size_t size() const {	return num_vertices ? distances.size()/num_vertices : 0;	}
+
+		uint16_t get(size_t goal, int xy) const {	return distances[goal*num_vertices + xy];	}
+		uint16_t get(size_t goal, int x, int y) const {	return get(goal, x*y_dim + y);	}
+
+		// distances of all vertices to the given goal
+		const uint16_t* table(size_t goal) const {	return &distances[goal*num_vertices];	}
+
+	private:
+		void bfs(const Graph& graph, int goal, uint16_t* dist, std::vector<int>& queue) const {
+			size_t head = 0, tail = 0;
+			dist[goal] = 0;
+			queue[tail++] = goal;
+			while(head < tail){
+				int v = queue[head++];
+				uint16_t d = std::min<uint16_t>(dist[v] + 1, unreachable - 1);
+				for(int u : graph.neighbors(v)){
+					if(dist[u] == unreachable){
+						dist[u] = d;
+						queue[tail++] = u;
+					}
+				}
+			}
+		}
+
+		int y_dim;
+		size_t num_vertices;
+		std::vector<uint16_t> distances;
+	};
+}
+
+#endif
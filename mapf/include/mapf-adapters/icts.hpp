@@ -8,26 +8,73 @@
 
 #include <icts/ICTS_.hpp>
 #include "mapf.hpp"
+#include "id.hpp"
+#include "budget.hpp"
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <memory>
 
 using namespace ICT_NEW;
 
 namespace icts{
   class solver{
   public:
-    solver()  {}
+    solver(bool independence_detection = false, size_t num_threads = 1):
+      independence_detection(independence_detection),
+      num_threads(num_threads),
+      nodes_generated(0),
+      nodes_pruned(0)  {}
+
+    // limits every later solve; the budget may be shared with other solvers
+    void set_budget(std::shared_ptr<mapf_adapters::budget> limits){ this->limits = limits; }
+
+    // plans all agents jointly, checking pairs of agents on num_threads threads, and adds to the ICT node counters; safe to call from several threads
+    bool plan(const mapf_adapters::mapf& map_obj, const std::vector<std::pair<int, int> >& starts, mapf_adapters::joint_solution* solution){
+      return plan(map_obj, starts, solution, num_threads);
+    }
+
+    // as above, with pairs of agents checked on the given number of threads instead of those of the solver
+    bool plan(const mapf_adapters::mapf& map_obj, const std::vector<std::pair<int, int> >& starts, mapf_adapters::joint_solution* solution, size_t threads){
+      ICT_NEW::ICTS<mapf_adapters::mapf> mapf_icts(threads);
+      if (map_obj.get_heuristic()) {
+        std::vector<const uint16_t*> tables;
+        for (size_t k = 0; k < map_obj.get_goals().size(); ++k) {
+          tables.push_back(map_obj.get_heuristic()->table(k));
+        }
+        mapf_icts.set_goal_distances(tables);
+      }
+      if (limits) {
+        std::shared_ptr<mapf_adapters::budget> b = limits;
+        mapf_icts.set_interrupt([b](size_t expanded, int lower_bound){
+          return b->interrupted(expanded, lower_bound);
+        });
+      }
+      bool success = mapf_icts.search(map_obj, starts, solution);
+      nodes_generated += mapf_icts.get_nodes_generated();
+      nodes_pruned += mapf_icts.get_nodes_pruned();
+      return success;
+    }
 
     bool solve(mapf_adapters::mapf map_obj, std::vector<std::pair<int, int> > starts){
 
-      std::pair<int, std::vector< std::vector< std::pair<int, int> > > > solution;
-      ICT_NEW::ICTS<mapf_adapters::mapf> mapf_icts;
+      nodes_generated = 0;
+      nodes_pruned = 0;
+      mapf_adapters::joint_solution solution;
 
       auto icts_start = std::chrono::system_clock::now();
-      bool success = mapf_icts.search(map_obj, starts, &solution);
+      bool success;
+      if (independence_detection) {
+        mapf_adapters::independence_detection id([this](const mapf_adapters::mapf& group, const std::vector<std::pair<int, int> >& group_starts, mapf_adapters::joint_solution* joint, size_t group_threads){
+          return plan(group, group_starts, joint, group_threads);
+        }, num_threads);
+        success = id.solve(map_obj, starts, &solution);
+      } else {
+        success = plan(map_obj, starts, &solution);
+      }
       auto icts_end = std::chrono::system_clock::now();
       auto icts_time = std::chrono::duration<double>(icts_end - icts_start).count();
 
@@ -38,6 +85,8 @@ namespace icts{
         out << "statistics:" << std::endl;
         out << "  cost: " << solution.first << std::endl;
         out << "  runtime: " << icts_time << std::endl;
+        out << "  ictNodesGenerated: " << nodes_generated << std::endl;
+        out << "  ictNodesPruned: " << nodes_pruned << std::endl;
         out << "schedule:" << std::endl;
 
         int count = 0;
@@ -60,6 +109,12 @@ namespace icts{
       }
       return true;
     }
+
+  private:
+    bool independence_detection;
+    size_t num_threads;
+    std::atomic<size_t> nodes_generated, nodes_pruned;
+    std::shared_ptr<mapf_adapters::budget> limits;
   };
 }
 
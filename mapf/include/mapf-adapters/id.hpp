@@ -0,0 +1,245 @@
+#ifndef MAPFADAPTERS_ID_HPP
+#define MAPFADAPTERS_ID_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <libMultiRobotPlanning/thread_pool.hpp>
+#include "mapf.hpp"
+
+namespace mapf_adapters{
+	// sum of costs and one path per agent; an agent stays at its goal after its path ends
+	typedef std::pair<int, std::vector<std::vector<std::pair<int, int> > > > joint_solution;
+
+	// plans all agents of an instance together on at most the given number of threads; must be callable from several threads at once
+	typedef std::function<bool(const mapf&, const std::vector<std::pair<int, int> >&, joint_solution*, size_t)> joint_solver;
+
+	/*
+	Independence Detection. Every agent is first planned on its own by walking
+	down the shared distance table. Then, as long as paths of different groups
+	collide, all colliding groups are merged and each merged group is replanned
+	with the joint solver on the subproblem of its agents. Merged groups of one
+	round do not depend on each other and are solved in parallel. The threads
+	are split between the groups of a round, so the joint solver of a group
+	only gets several threads when there are fewer groups than threads.
+
+	The joint solver only ever sees groups that could not be planned
+	independently, and the result is optimal if it is optimal for every group.
+	The cost of the returned solution is the sum of the arrival times at the
+	goals, whatever convention the joint solver uses.
+	*/
+	class independence_detection{
+	public:
+		independence_detection(joint_solver solver, size_t num_threads = 1):
+			solver(solver),
+			pool(num_threads),
+			merges(0),
+			largest_group(0)	{}
+
+		bool solve(const mapf& map, const std::vector<std::pair<int, int> >& starts, joint_solution* solution){
+			const Graph& g = map.get_graph();
+			size_t num_agents = starts.size();
+			merges = 0;
+			largest_group = num_agents ? 1 : 0;
+
+			// subproblems copy their tables from the instance, so it needs them too
+			const mapf* instance = &map;
+			mapf with_heuristic;
+			if(!map.get_heuristic()){
+				with_heuristic = map;
+				with_heuristic.compute_heuristic(pool.size());
+				instance = &with_heuristic;
+			}
+			const heuristic_table& h = *instance->get_heuristic();
+
+			paths.assign(num_agents, std::vector<int>());
+			for(size_t a = 0; a < num_agents; ++a){
+				if(!shortest_path(g, h, a, g.index(starts[a].first, starts[a].second), paths[a])){
+					return false;
+				}
+			}
+
+			group_of.resize(num_agents);
+			std::iota(group_of.begin(), group_of.end(), 0);
+			while(true){
+				parent.resize(num_agents);
+				std::iota(parent.begin(), parent.end(), 0);
+				if(!find_conflicts(g)){
+					break;
+				}
+
+				// agents of the groups merged in this round, by new group id
+				std::vector<std::vector<size_t> > merged;
+				std::vector<size_t> new_group(num_agents, num_agents);
+				for(size_t a = 0; a < num_agents; ++a){
+					size_t root = find(group_of[a]);
+					if(new_group[root] == num_agents){
+						new_group[root] = merged.size();
+						merged.emplace_back();
+					}
+					merged[new_group[root]].push_back(a);
+				}
+				std::vector<std::vector<size_t> > groups;
+				for(auto& agents : merged){
+					bool grown = false;
+					for(size_t a : agents){
+						grown |= group_of[a] != group_of[agents.front()];
+					}
+					for(size_t a : agents){
+						group_of[a] = agents.front();
+					}
+					if(grown){
+						groups.push_back(std::move(agents));
+					}
+				}
+
+				merges += groups.size();
+				size_t group_threads = std::max<size_t>(1, pool.size() / groups.size());
+				std::atomic<bool> failed(false);
+				pool.parallelFor(groups.size(), [&](size_t k, size_t){
+					if(!failed && !plan_group(*instance, starts, groups[k], group_threads)){
+						failed = true;
+					}
+				});
+				if(failed){
+					return false;
+				}
+				for(const auto& agents : groups){
+					largest_group = std::max(largest_group, agents.size());
+				}
+			}
+
+			solution->first = 0;
+			solution->second.assign(num_agents, std::vector<std::pair<int, int> >());
+			for(size_t a = 0; a < num_agents; ++a){
+				std::vector<int>& path = paths[a];
+				while(path.size() > 1 && path[path.size()-2] == path.back()){
+					path.pop_back();
+				}
+				solution->first += path.size() - 1;
+				for(int v : path){
+					solution->second[a].emplace_back(g.get_x(v), g.get_y(v));
+				}
+			}
+			return true;
+		}
+
+		// groups replanned with the joint solver during the last solve()
+		size_t get_merges() const {	return merges;	}
+		// agents in the largest group of the last solve()
+		size_t get_largest_group() const {	return largest_group;	}
+
+	private:
+		// follows strictly decreasing distances, so the path is a shortest one
+		static bool shortest_path(const Graph& g, const heuristic_table& h, size_t agent, int start, std::vector<int>& path){
+			const uint16_t* dist = h.table(agent);
+			if(dist[start] == unreachable){
+				return false;
+			}
+			path.assign(1, start);
+			while(dist[path.back()] > 0){
+				for(int u : g.neighbors(path.back())){
+					if(dist[u] + 1 == dist[path.back()]){
+						path.push_back(u);
+						break;
+					}
+				}
+			}
+			return true;
+		}
+
+		static int at(const std::vector<int>& path, size_t t){	return path[std::min(t, path.size() - 1)];	}
+
+		size_t find(size_t group){
+			while(parent[group] != group){
+				group = parent[group] = parent[parent[group]];
+			}
+			return group;
+		}
+
+		void unite(size_t a, size_t b){
+			size_t ra = find(group_of[a]), rb = find(group_of[b]);
+			if(ra != rb){
+				parent[std::max(ra, rb)] = std::min(ra, rb);
+			}
+		}
+
+		// unites the groups of all pairs of agents whose paths collide
+		bool find_conflicts(const Graph& g){
+			size_t makespan = 0;
+			for(const auto& path : paths){
+				makespan = std::max(makespan, path.size());
+			}
+			// occupant[v] is valid at time t if stamp[v] == t + 1
+			occupant.assign(g.num_vertices(), 0);
+			stamp.assign(g.num_vertices(), 0);
+			bool found = false;
+			for(size_t t = 0; t < makespan; ++t){
+				for(size_t a = 0; a < paths.size(); ++a){
+					int v = at(paths[a], t);
+					if(stamp[v] == t + 1){
+						if(group_of[occupant[v]] != group_of[a]){
+							unite(occupant[v], a);
+							found = true;
+						}
+					}else{
+						stamp[v] = t + 1;
+						occupant[v] = a;
+					}
+				}
+				if(t + 1 == makespan){
+					break;
+				}
+				for(size_t a = 0; a < paths.size(); ++a){
+					int from = at(paths[a], t), to = at(paths[a], t + 1);
+					// the agent that was at our destination moved to our origin
+					if(from != to && stamp[to] == t + 1){
+						size_t b = occupant[to];
+						if(group_of[b] != group_of[a] && at(paths[b], t + 1) == from){
+							unite(a, b);
+							found = true;
+						}
+					}
+				}
+			}
+			return found;
+		}
+
+		bool plan_group(const mapf& map, const std::vector<std::pair<int, int> >& starts, const std::vector<size_t>& agents, size_t num_threads){
+			const Graph& g = map.get_graph();
+			std::vector<std::pair<int, int> > group_starts;
+			for(size_t a : agents){
+				group_starts.push_back(starts[a]);
+			}
+			joint_solution group_solution;
+			if(!solver(map.subproblem(agents), group_starts, &group_solution, num_threads) || group_solution.second.size() != agents.size()){
+				return false;
+			}
+			for(size_t k = 0; k < agents.size(); ++k){
+				std::vector<int>& path = paths[agents[k]];
+				path.clear();
+				if(group_solution.second[k].empty()){
+					return false;
+				}
+				for(const auto& p : group_solution.second[k]){
+					path.push_back(g.index(p.first, p.second));
+				}
+			}
+			return true;
+		}
+
+		joint_solver solver;
+		libMultiRobotPlanning::ThreadPool pool;
+		size_t merges, largest_group;
+		std::vector<std::vector<int> > paths;
+		// group_of[a] is the smallest agent of a's group
+		std::vector<size_t> group_of, parent;
+		std::vector<size_t> occupant, stamp;
+	};
+}
+
+#endif
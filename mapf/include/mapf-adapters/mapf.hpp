@@ -2,8 +2,10 @@
 #define MAPFADAPTERS_MAPF_HPP
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "graph.hpp"
+#include "heuristic.hpp"
 
 namespace mapf_adapters{
 	class mapf{
@@ -14,20 +16,40 @@ namespace mapf_adapters{
 			x_dim(x_dim),
 			y_dim(y_dim),
 			obstacles(obstacles),
-			goals(goals)	{
-				g = mapf_adapters::Graph(x_dim, y_dim, obstacles);
-			}
+			goals(goals),
+			g(x_dim, y_dim, this->obstacles)	{}
+
+		int get_x() const {	return x_dim;	}
+		int get_y() const {	return y_dim;	}
+		const std::vector<std::pair<int, int> >& get_obstacles() const {	return obstacles;	}
+		const std::vector<std::pair<int, int> >& get_goals() const {	return goals;	}
+		const mapf_adapters::Graph& get_graph() const {	return g;	}
+
+		// builds the distance tables of all goals; copies of this object share them
+		void compute_heuristic(size_t num_threads = 1){
+			h = std::make_shared<const mapf_adapters::heuristic_table>(g, goals, num_threads);
+		}
+		// nullptr until compute_heuristic() was called
+		std::shared_ptr<const mapf_adapters::heuristic_table> get_heuristic() const {	return h;	}
 
-		int get_x(){	return x_dim;	}
-		int get_y(){	return y_dim;	}
-		std::vector<std::pair<int, int> > get_obstacles(){	return obstacles;	}
-		std::vector<std::pair<int, int> > get_goals(){	return goals;	}
-		mapf_adapters::Graph get_graph(){	return g;	}
+		// the same map with only the given agents; their distance tables are copied, not recomputed
+		mapf subproblem(const std::vector<size_t>& agents) const {
+			mapf sub(*this);
+			sub.goals.clear();
+			for(size_t a : agents){
+				sub.goals.push_back(goals[a]);
+			}
+			if(h){
+				sub.h = std::make_shared<const mapf_adapters::heuristic_table>(*h, agents);
+			}
+			return sub;
+		}
 
 	private:
 		int x_dim, y_dim;
 		std::vector<std::pair<int, int> > obstacles, goals;
 		mapf_adapters::Graph g;
+		std::shared_ptr<const mapf_adapters::heuristic_table> h;
 	};
 }
 
@@ -0,0 +1,249 @@
+#ifndef MAPFADAPTERS_PORTFOLIO_HPP
+#define MAPFADAPTERS_PORTFOLIO_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mapf.hpp"
+#include "id.hpp"
+#include "budget.hpp"
+
+namespace mapf_adapters{
+	struct portfolio_result{
+		std::string solver;
+		// false for the best bounded-suboptimal solution found by the deadline
+		bool optimal;
+		double runtime;
+		joint_solution solution;
+	};
+
+	/*
+	Races several solvers on one instance and returns the first solution
+	proven optimal, or the cheapest bounded-suboptimal one once the time limit
+	is reached; the others are cancelled.
+
+	Every solver runs in its own child process. BCP, reLOC and Glucose keep
+	global and static state, so they cannot share a process with each other
+	or with a second instance of themselves, and a process is also what lets
+	the portfolio cap the memory of each solver and stop a solver that does
+	not check its budget. The children are forked from the caller, so they
+	start with its distance tables and everything else it has built; the
+	solution comes back through a pipe.
+
+	The caller must not run other threads while solve() forks.
+	*/
+	class portfolio{
+	public:
+		/*
+		solver is run in a child process with a budget that expires at the time
+		limit; optimal tells whether its solutions are proven optimal.
+		memory_limit caps the address space of the child in bytes, including
+		what it inherits from the caller; 0 for no cap.
+		*/
+		typedef std::function<bool(const mapf&, const std::vector<std::pair<int, int> >&, const std::shared_ptr<budget>&, joint_solution*)> solver;
+
+		void add(const std::string& name, solver s, bool optimal = true, size_t memory_limit = 0){
+			entries.push_back({name, s, optimal, memory_limit});
+		}
+
+		size_t size() const {	return entries.size();	}
+
+		// time_limit in seconds, 0 for none; false if no solver found a solution in time
+		bool solve(const mapf& map, const std::vector<std::pair<int, int> >& starts, double time_limit, portfolio_result* result){
+			auto start = std::chrono::steady_clock::now();
+			// buffered output would otherwise be written by every child again
+			std::cout.flush();
+			std::cerr.flush();
+			fflush(NULL);
+
+			std::vector<worker> workers;
+			for(size_t k = 0; k < entries.size(); ++k){
+				int fds[2];
+				if(pipe(fds) != 0){
+					continue;
+				}
+				pid_t pid = fork();
+				if(pid == 0){
+					close(fds[0]);
+					run(entries[k], map, starts, time_limit, fds[1]);
+				}
+				close(fds[1]);
+				if(pid < 0){
+					close(fds[0]);
+					continue;
+				}
+				workers.push_back({k, pid, fds[0], std::vector<char>()});
+			}
+
+			bool found = false;
+			std::vector<pollfd> fds;
+			while(!workers.empty()){
+				int timeout = -1;
+				if(time_limit > 0){
+					double left = time_limit - elapsed(start);
+					if(left <= 0){
+						break;
+					}
+					timeout = int(std::ceil(left * 1000));
+				}
+				fds.clear();
+				for(const worker& w : workers){
+					fds.push_back({w.fd, POLLIN, 0});
+				}
+				if(poll(fds.data(), fds.size(), timeout) < 0){
+					if(errno == EINTR)	continue;
+					break;
+				}
+
+				bool optimal_found = false;
+				for(size_t k = workers.size(); k-- > 0;){
+					if(!fds[k].revents){
+						continue;
+					}
+					worker& w = workers[k];
+					char buffer[1 << 16];
+					ssize_t n = read(w.fd, buffer, sizeof(buffer));
+					if(n > 0){
+						w.data.insert(w.data.end(), buffer, buffer + n);
+						continue;
+					}
+					if(n < 0 && errno == EINTR){
+						continue;
+					}
+					// the child is done, possibly killed for exceeding its memory
+					joint_solution solution;
+					const entry& e = entries[w.entry];
+					if(decode(w.data, &solution) && (!found || e.optimal || solution.first < result->solution.first)){
+						found = true;
+						result->solver = e.name;
+						result->optimal = e.optimal;
+						result->solution = std::move(solution);
+						optimal_found |= e.optimal;
+					}
+					finish(w, false);
+					workers.erase(workers.begin() + k);
+				}
+				if(optimal_found){
+					break;
+				}
+			}
+			for(worker& w : workers){
+				finish(w, true);
+			}
+			if(found){
+				result->runtime = elapsed(start);
+			}
+			return found;
+		}
+
+	private:
+		struct entry{
+			std::string name;
+			solver s;
+			bool optimal;
+			size_t memory_limit;
+		};
+
+		struct worker{
+			size_t entry;
+			pid_t pid;
+			int fd;
+			std::vector<char> data;
+		};
+
+		static double elapsed(std::chrono::steady_clock::time_point start){
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// body of a child process; never returns
+		static void run(const entry& e, const mapf& map, const std::vector<std::pair<int, int> >& starts, double time_limit, int fd){
+			if(e.memory_limit){
+				rlimit rl = {rlim_t(e.memory_limit), rlim_t(e.memory_limit)};
+				setrlimit(RLIMIT_AS, &rl);
+			}
+			std::vector<int32_t> out;
+			try{
+				joint_solution solution;
+				if(e.s(map, starts, std::make_shared<budget>(time_limit), &solution)){
+					out.push_back(solution.first);
+					out.push_back(solution.second.size());
+					for(const auto& path : solution.second){
+						out.push_back(path.size());
+						for(const auto& p : path){
+							out.push_back(p.first);
+							out.push_back(p.second);
+						}
+					}
+				}
+			}catch(...){
+				// e.g. std::bad_alloc under the memory cap; reported as no solution
+				out.clear();
+			}
+			const char* data = reinterpret_cast<const char*>(out.data());
+			size_t size = out.size() * sizeof(int32_t);
+			while(size > 0){
+				ssize_t n = write(fd, data, size);
+				if(n <= 0 && errno != EINTR)	break;
+				if(n > 0){
+					data += n;
+					size -= n;
+				}
+			}
+			std::cout.flush();
+			fflush(NULL);
+			_exit(0);
+		}
+
+		static bool decode(const std::vector<char>& data, joint_solution* solution){
+			size_t count = data.size() / sizeof(int32_t);
+			if(count < 2 || count * sizeof(int32_t) != data.size()){
+				return false;
+			}
+			std::vector<int32_t> in(count);
+			std::copy(data.begin(), data.end(), reinterpret_cast<char*>(in.data()));
+			if(in[1] < 0){
+				return false;
+			}
+			size_t k = 0;
+			solution->first = in[k++];
+			solution->second.assign(in[k++], std::vector<std::pair<int, int> >());
+			for(auto& path : solution->second){
+				if(k >= count || in[k] < 0 || k + 1 + 2 * size_t(in[k]) > count){
+					return false;
+				}
+				int length = in[k++];
+				for(int t = 0; t < length; ++t, k += 2){
+					path.emplace_back(in[k], in[k + 1]);
+				}
+			}
+			return k == count;
+		}
+
+		static void finish(worker& w, bool cancel){
+			if(cancel){
+				kill(w.pid, SIGKILL);
+			}
+			close(w.fd);
+			while(waitpid(w.pid, NULL, 0) < 0 && errno == EINTR);
+		}
+
+		std::vector<entry> entries;
+	};
+}
+
+#endif
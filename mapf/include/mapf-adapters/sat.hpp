@@ -7,11 +7,15 @@
 #include <yaml-cpp/yaml.h>
 
 #include "mapf.hpp"
+#include "budget.hpp"
+#include "id.hpp"
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
 
 #include <chrono>
+#include <cmath>
+#include <memory>
 
 #ifndef __INSOLVER_MAIN_TEMP__
 #define __INSOLVER_MAIN_TEMP__
@@ -46,7 +50,7 @@ namespace sReloc
 
 /*----------------------------------------------------------------------------*/
 
-    sResult solve_MultirobotInstance_SAT(const std::vector<std::pair<int, int> > &obstacles, const std::vector<std::pair<int, int> >& goals, const std::vector<std::pair<int, int> > &starts, const int &x, const int &y, const std::vector<std::vector<int> > &graph, std::pair<float, std::vector<std::vector<std::tuple<int, int, int> > > > *solution)
+    sResult solve_MultirobotInstance_SAT(const std::vector<std::pair<int, int> > &obstacles, const std::vector<std::pair<int, int> >& goals, const std::vector<std::pair<int, int> > &starts, const int &x, const int &y, const mapf_adapters::Graph &graph, std::pair<float, std::vector<std::vector<std::tuple<int, int, int> > > > *solution, const std::shared_ptr<mapf_adapters::budget> &limits = nullptr)
     {
 	sResult result;
 	sUndirectedGraph environment(false);	
@@ -55,7 +59,7 @@ namespace sReloc
 	sRobotArrangement goal_arrangement;
 	sRobotGoal robot_goal;
 
-	environment.from_vector(obstacles, goals, starts, x, y, graph);
+	environment.from_vector(obstacles, goals, starts, x, y, graph.get_offsets(), graph.get_adj());
 
 	initial_arrangement.from_vector_initial(starts, x, y);
 	robot_goal.from_vector_goal(goals, x, y);
@@ -72,12 +76,25 @@ namespace sReloc
 	   	
 	sMultirobotInstance::MDD_vector MDD;
 
-	sMultirobotSolutionCompressor compressor(sRELOC_SAT_SOLVER_PATH, -1, 600, 65536, 4, sMultirobotSolutionCompressor::ENCODING_MDD);
+	// without a budget reLOC keeps its own limit of 600 CPU seconds
+	sMultirobotSolutionCompressor compressor(sRELOC_SAT_SOLVER_PATH, -1, limits ? limits->remaining_seconds() : 600, 65536, 4, sMultirobotSolutionCompressor::ENCODING_MDD);
 	compressor.set_Ratio(-1);
 	compressor.set_Robustness(1);		
+	if (limits)
+	{
+	    compressor.set_Interrupt([&limits](int attempts, int cost){ return limits->interrupted(attempts, cost); });
+	}
 
 	Glucose::Solver *solver;
 	result = compressor.incompute_CostOptimalSolution(&solver, initial_arrangement, robot_goal, environment, instance.m_sparse_environment, MDD, 65536, optimal_cost, optimal_solution);
+	if (sFAILED(result))
+	{
+	    return result;
+	}
+	if (optimal_cost == sMultirobotSolutionCompressor::MAKESPAN_UNDEFINED)
+	{
+	    return sMULTIROBOT_SOLUTION_COMPRESSOR_INDET_INFO;
+	}
 
 	printf("Computed sum of costs:%d\n", optimal_cost);
 	std::map<int, std::vector<std::pair<int, int> > > sol = optimal_solution.get_sol();
@@ -104,12 +121,47 @@ namespace SAT_solver{
   public:
     solver()  {}
 
-    bool solve(mapf_adapters::mapf map_obj, std::vector<std::pair<int, int> > starts){
-	
+    // limits every later solve; the budget may be shared with other solvers
+    void set_budget(std::shared_ptr<mapf_adapters::budget> limits){ this->limits = limits; }
+
+    // plans all agents; reLOC and Glucose keep static state, so never from several threads
+    bool plan(const mapf_adapters::mapf& map_obj, const std::vector<std::pair<int, int> >& starts, mapf_adapters::joint_solution* joint){
 	std::pair<float, std::vector<std::vector<std::tuple<int, int, int> > > > solution;
+	sResult result = ::sReloc::solve_MultirobotInstance_SAT(map_obj.get_obstacles(),map_obj.get_goals(),starts,map_obj.get_x(),map_obj.get_y(),map_obj.get_graph(), &solution, limits);
+	if (result != sRESULT_SUCCESS) {
+		return false;
+	}
+
+	// reLOC lists only the moves of an agent, with their times; it waits in between
+	joint->first = std::lround(solution.first);
+	joint->second.assign(starts.size(), std::vector<std::pair<int, int> >());
+	for(int i=0; i<starts.size(); i++){
+		std::vector<std::pair<int, int> > &path = joint->second[i];
+		path.push_back(starts[i]);
+		for(int j=0; j<solution.second[i].size(); j++){
+			int t = std::get<2>(solution.second[i][j]);
+			while(path.size() < t){
+				path.push_back(path.back());
+			}
+			if(path.size() == t){
+				path.emplace_back(std::get<0>(solution.second[i][j]), std::get<1>(solution.second[i][j]));
+			}
+		}
+	}
+	return true;
+    }
+
+    bool solve(const mapf_adapters::mapf& map_obj, const std::vector<std::pair<int, int> >& starts){
+	
+	mapf_adapters::joint_solution solution;
 	auto sat_start = std::chrono::system_clock::now();
-	::sReloc::solve_MultirobotInstance_SAT(map_obj.get_obstacles(),map_obj.get_goals(),starts,map_obj.get_x(),map_obj.get_y(),map_obj.get_graph().get_adj(), &solution);
+	bool success = plan(map_obj, starts, &solution);
 	auto sat_end = std::chrono::system_clock::now();
+
+	if (!success) {
+		std::cout << "Planning NOT successful!" << std::endl;
+		return false;
+	}
 	
 	std::ofstream out("../example/output_sat.yaml");
 	out << "statistics:" << std::endl;
@@ -120,13 +172,16 @@ namespace SAT_solver{
 	for(int i=0; i<solution.second.size(); i++){
 		out << "  agent" << i << ":" << std::endl;
 		for(int j=0; j<solution.second[i].size(); j++){
-			out << "    - x: " << std::get<0>(solution.second[i][j]) << std::endl;
-			out << "      y: " << std::get<1>(solution.second[i][j]) << std::endl;
-			out << "      t: " << std::get<2>(solution.second[i][j]) << std::endl;
+			out << "    - x: " << solution.second[i][j].first << std::endl;
+			out << "      y: " << solution.second[i][j].second << std::endl;
+			out << "      t: " << j << std::endl;
 		}
 	}
       return true;
     }
+
+  private:
+    std::shared_ptr<mapf_adapters::budget> limits;
   };
 }
 
@@ -0,0 +1,112 @@
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <cstdlib>
+#include <atomic>
+
+#include <yaml-cpp/yaml.h>
+
+#include <epea/epea.hpp>
+#include "mapf.hpp"
+
+#include <boost/program_options.hpp>
+
+using namespace EPEA;
+
+// every allocation of the process goes through these and is counted
+static std::atomic<long> num_allocations(0);
+
+void* operator new(std::size_t size) {
+  num_allocations++;
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+// kept out of line: once inlined, gcc pairs the free() below with the call to
+// operator new at the allocation site and reports -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Micro-benchmark of the node expansion: reports the heap allocations made by
+// EPEA* per expanded node, e.g.
+//   epea_allocations ../../libMultiRobotPlanning/benchmark/8x8_obst12/map_8by8_obst12_agents8_ex{0..4}.yaml
+// Loading the instance is not counted, and the allocations of the per-search
+// setup (building the OSF) are reported separately.
+int main(int argc, char* argv[]) {
+
+  namespace po = boost::program_options;
+  // Declare the supported options.
+  po::options_description desc("Allowed options");
+
+  std::vector<std::string> inputFiles;
+  desc.add_options()("help", "produce help message")(
+      "input,i", po::value<std::vector<std::string> >(&inputFiles)->required(),
+      "input files (YAML)");
+  po::positional_options_description positional;
+  positional.add("input", -1);
+
+  try {
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") != 0u) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  } catch (po::error& e) {
+    std::cerr << e.what() << std::endl << std::endl;
+    std::cerr << desc << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(8) << "agents" << std::setw(12) << "expanded" << std::setw(10) << "setup" << std::setw(14) << "allocations"
+            << std::setw(12) << "per exp." << "  instance" << std::endl;
+
+  for (const auto& inputFile : inputFiles) {
+    YAML::Node config = YAML::LoadFile(inputFile);
+
+    std::vector<std::pair<int, int> > obstacles;
+    std::vector<std::pair<int, int> > goals;
+    std::vector<std::pair<int, int> > starts;
+
+    const auto& dim = config["map"]["dimensions"];
+    int dimx = dim[0].as<int>();
+    int dimy = dim[1].as<int>();
+
+    for (const auto& node : config["map"]["obstacles"]) {
+      obstacles.emplace_back(std::make_pair(node[0].as<int>(), node[1].as<int>()));
+    }
+
+    for (const auto& node : config["agents"]) {
+      const auto& start = node["start"];
+      const auto& goal = node["goal"];
+      starts.emplace_back(std::make_pair(start[0].as<int>(), start[1].as<int>()));
+      goals.emplace_back(std::make_pair(goal[0].as<int>(), goal[1].as<int>()));
+    }
+
+    mapf_adapters::mapf mapf(dimx, dimy, obstacles, goals);
+
+    std::pair<int, std::vector< std::vector< std::pair<int, int> > > > solution;
+    EPEA::EPEAStar<mapf_adapters::mapf> mapf_epea;
+
+    long before = num_allocations;
+    {
+      OSF<mapf_adapters::mapf> osf(mapf);
+    }
+    long setup = num_allocations - before;
+
+    before = num_allocations;
+    mapf_epea.search(mapf, starts, &solution);
+    long allocations = num_allocations - before - setup;
+
+    int expanded = mapf_epea.get_nodes_expanded();
+    std::cout << std::setw(8) << starts.size() << std::setw(12) << expanded << std::setw(10) << setup << std::setw(14) << allocations
+              << std::setw(12) << (expanded ? double(allocations) / expanded : 0.0) << "  " << inputFile << std::endl;
+  }
+
+  return 0;
+}
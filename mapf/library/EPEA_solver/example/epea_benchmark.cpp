@@ -0,0 +1,111 @@
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+#include <yaml-cpp/yaml.h>
+
+#include <epea/epea.hpp>
+#include "mapf.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+
+using namespace EPEA;
+
+// Runs EPEA* on every given instance and reports runtime and expansions,
+// grouped by the number of agents, e.g.
+//   epea_benchmark ../../libMultiRobotPlanning/benchmark/8x8_obst12/map_8by8_obst12_agents{2,4,6,8}_ex{0..4}.yaml
+int main(int argc, char* argv[]) {
+
+  namespace po = boost::program_options;
+  // Declare the supported options.
+  po::options_description desc("Allowed options");
+
+  std::vector<std::string> inputFiles;
+  desc.add_options()("help", "produce help message")(
+      "input,i", po::value<std::vector<std::string> >(&inputFiles)->required(),
+      "input files (YAML)");
+  po::positional_options_description positional;
+  positional.add("input", -1);
+
+  try {
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") != 0u) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  } catch (po::error& e) {
+    std::cerr << e.what() << std::endl << std::endl;
+    std::cerr << desc << std::endl;
+    return 1;
+  }
+
+  struct summary {
+    int instances = 0;
+    int solved = 0;
+    double runtime = 0;
+    long expanded = 0;
+  };
+  std::map<size_t, summary> by_agents;
+
+  std::cout << std::setw(8) << "agents" << std::setw(8) << "cost" << std::setw(14) << "runtime [s]"
+            << std::setw(12) << "expanded" << "  instance" << std::endl;
+
+  for (const auto& inputFile : inputFiles) {
+    YAML::Node config = YAML::LoadFile(inputFile);
+
+    std::vector<std::pair<int, int> > obstacles;
+    std::vector<std::pair<int, int> > goals;
+    std::vector<std::pair<int, int> > starts;
+
+    const auto& dim = config["map"]["dimensions"];
+    int dimx = dim[0].as<int>();
+    int dimy = dim[1].as<int>();
+
+    for (const auto& node : config["map"]["obstacles"]) {
+      obstacles.emplace_back(std::make_pair(node[0].as<int>(), node[1].as<int>()));
+    }
+
+    for (const auto& node : config["agents"]) {
+      const auto& start = node["start"];
+      const auto& goal = node["goal"];
+      starts.emplace_back(std::make_pair(start[0].as<int>(), start[1].as<int>()));
+      goals.emplace_back(std::make_pair(goal[0].as<int>(), goal[1].as<int>()));
+    }
+
+    mapf_adapters::mapf mapf(dimx, dimy, obstacles, goals);
+
+    std::pair<int, std::vector< std::vector< std::pair<int, int> > > > solution;
+    EPEA::EPEAStar<mapf_adapters::mapf> mapf_epea;
+
+    auto epea_start = std::chrono::steady_clock::now();
+    bool success = mapf_epea.search(mapf, starts, &solution);
+    auto epea_end = std::chrono::steady_clock::now();
+    double epea_time = std::chrono::duration<double>(epea_end - epea_start).count();
+
+    summary& s = by_agents[starts.size()];
+    s.instances++;
+    s.runtime += epea_time;
+    s.expanded += mapf_epea.get_nodes_expanded();
+    if (success) {
+      s.solved++;
+    }
+
+    std::cout << std::setw(8) << starts.size() << std::setw(8) << (success ? std::to_string(solution.first) : "-")
+              << std::setw(14) << epea_time << std::setw(12) << mapf_epea.get_nodes_expanded() << "  " << inputFile << std::endl;
+  }
+
+  std::cout << std::endl << std::setw(8) << "agents" << std::setw(8) << "solved" << std::setw(14) << "mean [s]"
+            << std::setw(12) << "mean exp." << std::endl;
+  for (const auto& it : by_agents) {
+    const summary& s = it.second;
+    std::cout << std::setw(8) << it.first << std::setw(5) << s.solved << "/" << std::setw(2) << s.instances
+              << std::setw(14) << s.runtime / s.instances << std::setw(12) << s.expanded / s.instances << std::endl;
+  }
+
+  return 0;
+}
@@ -18,12 +18,12 @@ namespace mapf_adapters{
 				g = mapf_adapters::Graph(x_dim, y_dim, obstacles);
 			}
 
-		int get_x(){	return x_dim;	}
-		int get_y(){	return y_dim;	}
-		int get_size(){	return goals.size();	}
-		std::vector<std::pair<int, int> > get_obstacles(){	return obstacles;	}
-		std::vector<std::pair<int, int> > get_goals(){	return goals;	}
-		mapf_adapters::Graph get_graph(){	return g;	}
+		int get_x() const {	return x_dim;	}
+		int get_y() const {	return y_dim;	}
+		int get_size() const {	return goals.size();	}
+		const std::vector<std::pair<int, int> >& get_obstacles() const {	return obstacles;	}
+		const std::vector<std::pair<int, int> >& get_goals() const {	return goals;	}
+		const mapf_adapters::Graph& get_graph() const {	return g;	}
 
 	private:
 		int x_dim, y_dim;
@@ -7,90 +7,167 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <map>
+#include <set>
 #include <deque>
+#include <memory>
 #include <chrono>
 #include <climits>
+#include <cstdint>
+#include <functional>
 
 #include <algorithm>
 
-#include <boost/heap/fibonacci_heap.hpp>
-
 typedef std::pair<int, int> pair_1;
 typedef std::tuple<int, int, int, int> priority_tuple;
 
 typedef struct pq_node{
-	std::vector<pair_1> agent_locs;
+	const pair_1 *agent_locs;	// one location per agent, owned by the node_arena
+	const int *waits;	// per agent the steps it has waited at its goal since arriving, owned by the node_arena
 	int g;
 	int h;
 	int small_f;
 	int big_f;
-	struct pq_node *parent;	
+	struct pq_node *parent;
+	struct pq_node *next_same_locs;	// next undominated node of the same joint locations
+	bool dominated;	// a node of the same joint locations costs at most as much whatever happens next
 
-	pq_node(std::vector<pair_1> a, int b, int c, int d, int e, struct pq_node* p){
+	pq_node(const pair_1 *a, const int *w, int b, int c, int d, int e, struct pq_node* p){
 		agent_locs = a;
+		waits = w;
 		g = b;
 		h = c;
 		small_f = d;
 		big_f = e;
 		parent = p;
+		next_same_locs = NULL;
+		dominated = false;
 	}
 } pq_node;
 
-typedef struct op_table_type{
-	int delta_h;
-	std::vector<std::vector<std::pair<pair_1, int> > > operators;
+typedef std::pair<priority_tuple, pq_node*> heap_node;
+
+/*
+Undominated nodes of every set of joint locations, as a list through
+pq_node::next_same_locs. The joint locations are packed into a fixed-width
+key of one cell id (x*y_dim + y) per agent; all keys are stored back to back
+in one array and found through an open-addressing table of key indices.
+*/
+class joint_state_table{
+public:
+	joint_state_table(int num_agents, int y_dim):
+		num_agents(num_agents),
+		y_dim(y_dim),
+		num_keys(0),
+		slots(1024, empty_slot),
+		key(num_agents)	{}
+
+	// the first undominated node of the joint locations, added as null if they are new
+	pq_node*& first(const pair_1 *locs){
+		pack(locs);
+		size_t i = find_slot(key.data());
+		if(slots[i] == empty_slot){
+			if(2*(num_keys + 1) > slots.size()){
+				grow();
+				i = find_slot(key.data());
+			}
+			keys.insert(keys.end(), key.begin(), key.end());
+			first_nodes.push_back(nullptr);
+			slots[i] = num_keys++;
+		}
+		return first_nodes[slots[i]];
+	}
+
+	size_t size() const {	return num_keys;	}
 
-	bool is_data_present;
+private:
+	static constexpr uint32_t empty_slot = UINT32_MAX;
 
-	op_table_type(){
-		is_data_present = false;
-		operators = std::vector<std::vector<std::pair<pair_1, int> > >();
+	void pack(const pair_1 *locs){
+		for(int i=0; i<num_agents; i++){
+			key[i] = locs[i].first*y_dim + locs[i].second;
+		}
 	}
-} op_table_type;
 
-typedef std::pair<priority_tuple, pq_node*> heap_node;
+	size_t hash_key(const uint32_t *k) const {
+		uint64_t hash = 0x9E3779B97F4A7C15ULL;
+		for(int i=0; i<num_agents; i++){
+			hash = (hash ^ k[i])*0xFF51AFD7ED558CCDULL;
+			hash ^= hash >> 32;
+		}
+		return hash;
+	}
 
-struct VectorHashBySize {
-public:
-	size_t operator()(const std::vector<pair_1> & v) const {
-		int size = v.size();
-		return std::hash<int>()(size);
+	// slot holding the key, or the empty slot where it belongs
+	size_t find_slot(const uint32_t *k) const {
+		size_t mask = slots.size() - 1;
+		size_t i = hash_key(k) & mask;
+		while(slots[i] != empty_slot && !std::equal(k, k + num_agents, &keys[size_t(slots[i])*num_agents])){
+			i = (i + 1) & mask;
+		}
+		return i;
 	}
-};
 
-struct VectorHashByElements {
-public:
-	size_t operator()(const std::vector<pair_1> & v) const {
-		int size = v.size();
-		int val = 0;
-		for(int i=0; i<size; i++){
-			val += ((v[i].first*(i+1)) + (v[i].second*(i+10000)));
+	void grow(){
+		slots.assign(2*slots.size(), empty_slot);
+		for(uint32_t n=0; n<num_keys; n++){
+			slots[find_slot(&keys[size_t(n)*num_agents])] = n;
 		}
-		return std::hash<int>()(val);
-	}	
+	}
+
+	int num_agents;
+	int y_dim;
+	uint32_t num_keys;
+	std::vector<uint32_t> keys;
+	std::vector<pq_node*> first_nodes;
+	std::vector<uint32_t> slots;
+	std::vector<uint32_t> key;
 };
 
-struct VectorCompareByElements {
+/*
+Owns the nodes of one search and their joint locations and waits; all of
+them are released together. Locations and waits are cut from blocks of
+nodes_per_block joint states, so creating a node does not allocate in the
+common case.
+*/
+class node_arena{
 public:
-	bool operator()(const std::vector<pair_1> & v1, const std::vector<pair_1> & v2) const {
- 
-		if (v1.size() == v2.size()){
-			for(int i=0; i<v1.size(); i++){
-				if(v1[i].first == v2[i].first && v1[i].second == v2[i].second)	continue;
-				return false;
-			}
-			return true;
-		}
-		else{
-			return false;
+	node_arena(int num_agents):
+		num_agents(num_agents),
+		block_used(nodes_per_block)	{}
+
+	pq_node* create(const pair_1 *locs, const int *waits, int g, int h, int small_f, int big_f, pq_node *parent){
+		if(block_used == nodes_per_block){
+			loc_blocks.emplace_back(new pair_1[nodes_per_block*num_agents]);
+			wait_blocks.emplace_back(new int[nodes_per_block*num_agents]);
+			block_used = 0;
 		}
+		pair_1 *loc_copy = loc_blocks.back().get() + block_used*num_agents;
+		int *wait_copy = wait_blocks.back().get() + block_used*num_agents;
+		block_used++;
+		std::copy(locs, locs + num_agents, loc_copy);
+		std::copy(waits, waits + num_agents, wait_copy);
+		nodes.emplace_back(loc_copy, wait_copy, g, h, small_f, big_f, parent);
+		return &nodes.back();
 	}
+
+	size_t size() const {	return nodes.size();	}
+
+private:
+	static constexpr size_t nodes_per_block = 1024;
+
+	int num_agents;
+	size_t block_used;
+	std::deque<pq_node> nodes;
+	std::vector<std::unique_ptr<pair_1[]> > loc_blocks;
+	std::vector<std::unique_ptr<int[]> > wait_blocks;
 };
 
 template<typename Mapf>
 class OSF{
 private:
-	std::vector<std::vector<std::vector<int> > > h;
+	// distances of all cells (x*y + y) to each goal, unreachable cells are UINT16_MAX
+	std::vector<const uint16_t*> h;
+	std::vector<uint16_t> own_h;
 	std::vector<pair_1> goals;
 	std::vector<pair_1> obstacles;
 
@@ -99,14 +176,27 @@ private:
 
 	int x;
 	int y;
-	Mapf obj;
-	std::vector<std::map<pair_1, std::vector<std::pair<pair_1, int> > > > agent_osfs;
-	std::unordered_map<std::vector<pair_1>, std::vector<op_table_type>, VectorHashByElements> osf_table;
+	// operators of agent i at cell c (x*y + y) with the heuristic after the move
+	std::vector<std::vector<std::vector<std::pair<pair_1, int> > > > agent_osfs;
+
+	// scratch space of select_operators, reused by every expansion
+	std::vector<const std::vector<std::pair<pair_1, int> >*> agent_ops;
+	std::vector<char> at_goal;
+	std::vector<int> offset, min_rest, max_rest;
+	std::vector<char> reachable, next_reachable;
+	std::vector<pair_1> next_locs;
+	// per cell: the agent standing there (now) and the one moving there (next),
+	// valid if the stamp equals the current one
+	std::vector<int> now_agent, now_stamp, next_stamp;
+	int stamp;
 
 public:
 	OSF(){}
-	OSF(Mapf mapf){	
-		obj = mapf;
+	// h may point into own_h
+	OSF(const OSF&) = delete;
+	OSF& operator=(const OSF&) = delete;
+	// goal_distances: one table per goal as described at h, e.g. shared with other solvers; computed here if empty
+	OSF(const Mapf &mapf, const std::vector<const uint16_t*> &goal_distances = std::vector<const uint16_t*>()){
 		goals = mapf.get_goals();
 		obstacles = mapf.get_obstacles();
 		x = mapf.get_x();
@@ -119,25 +209,40 @@ public:
 			temp_map[obstacles[i].first][obstacles[i].second] = true;
 		}
 
-		h = get_true_distance_heuristics();
+		if(goal_distances.size() == goals.size()){
+			h = goal_distances;
+		}else{
+			compute_true_distance_heuristics();
+		}
 		agent_osfs = populate_agent_osf();
+
+		int num_agents = goals.size();
+		agent_ops.resize(num_agents);
+		at_goal.resize(num_agents);
+		offset.resize(num_agents);
+		min_rest.resize(num_agents + 1);
+		max_rest.resize(num_agents + 1);
+		next_locs.resize(num_agents);
+		now_agent.resize(x*y);
+		now_stamp.assign(x*y, 0);
+		next_stamp.assign(x*y, 0);
+		stamp = 0;
 	}
 
-	int get_size(){	return goals.size();	}
+	int get_size() const {	return goals.size();	}
 
-	std::vector<pair_1>  get_goals(){	return goals;	}
+	const std::vector<pair_1>& get_goals() const {	return goals;	}
 
-	std::vector<std::vector<std::vector<int> > > get_true_distance_heuristics(){
-		std::vector<std::vector<std::vector<int> > > heu;
-		for(int i=0; i<goals.size(); i++){
-			pair_1 this_goal = goals[i];
-			heu.push_back(true_distance_bfs(this_goal));
+	void compute_true_distance_heuristics(){
+		own_h.assign(goals.size()*x*y, UINT16_MAX);
+		h.clear();
+		for(size_t i=0; i<goals.size(); i++){
+			h.push_back(&own_h[i*x*y]);
+			true_distance_bfs(goals[i], &own_h[i*x*y]);
 		}
-		return heu;
 	}
 
-	std::vector<std::vector<int> > true_distance_bfs(pair_1 goal){
-		std::vector<std::vector<int> > bfs_result(x, std::vector<int>(y, 0));
+	void true_distance_bfs(pair_1 goal, uint16_t *bfs_result){
 		std::deque<pair_1> dq;
 		std::unordered_set<int> vis;
 
@@ -151,7 +256,7 @@ public:
 			int x_val = a.first / y;
 			int y_val = a.first % y;
 
-			bfs_result[x_val][y_val] = a.second;
+			bfs_result[a.first] = a.second;
 
 			for(int i=0; i<op.size(); i++){
 				int new_x = x_val + op[i].first;
@@ -163,236 +268,162 @@ public:
 				}
 			}
 		}
-		return bfs_result;
 	}
 
 	int manhattan_distance(pair_1 a, pair_1 b){
 		return abs(a.first - b.first) + abs(a.second - b.second);
 	}
 
-	std::vector<std::vector<std::pair<pair_1, int> > > cart_product (const std::vector<std::vector<std::pair<pair_1, int> > >& v) {
-		std::vector<std::vector<std::pair<pair_1, int> > > s = {{}};
-		for (const auto& u : v) {
-			std::vector<std::vector<std::pair<pair_1, int> > > r;
-
-			for (const auto& x : s) {
-				for (const auto y : u) {
-					r.push_back(x);
-					r.back().push_back(y);
-				}
-			}
-			s = std::move(r);
-
-		}
-		
-		return s;
-	}
-
-	std::vector<std::map<pair_1, std::vector<std::pair<pair_1, int> > > > populate_agent_osf(){
-		std::vector<std::map<pair_1, std::vector<std::pair<pair_1, int> > > > temp;
+	std::vector<std::vector<std::vector<std::pair<pair_1, int> > > > populate_agent_osf(){
+		std::vector<std::vector<std::vector<std::pair<pair_1, int> > > > temp;
 		for(int i=0; i<goals.size(); i++){
 			temp.push_back(get_one_agent_osf(i));
 		}
 		return temp;
 	}
 
-	std::map<pair_1, std::vector<std::pair<pair_1, int> > > get_one_agent_osf(int agent_no){
-		std::map<pair_1, std::vector<std::pair<pair_1, int> > > agent_osf;
-
-		std::unordered_set<int> processed_obstacles;
-		for(auto it = obstacles.begin(); it != obstacles.end(); ++it){
-			int i = it->first;
-			int j = it->second;
-			int new_xy = i*y + j;
-			processed_obstacles.insert(new_xy);
-		}
+	std::vector<std::vector<std::pair<pair_1, int> > > get_one_agent_osf(int agent_no){
+		std::vector<std::vector<std::pair<pair_1, int> > > agent_osf(x*y);
 
         for(int i=0; i<x; i++){
         	for(int j=0; j<y; j++){
         		std::vector<std::pair<pair_1, int> > good_ops;
-        		if(processed_obstacles.find((i*y)+(j)) == processed_obstacles.end()){
+        		if(temp_map[i][j] == false){
         			for(int t=0; t<op.size(); t++){
         				int new_x = i + op[t].first;
         				int new_y = j + op[t].second;
         				if(new_x >= 0 && new_x < x && new_y >=0 && new_y < y && temp_map[new_x][new_y] == false)
-	        				good_ops.push_back({op[t], h[agent_no][new_x][new_y]});
+	        				good_ops.push_back({op[t], h[agent_no][(new_x*y)+new_y]});
         			}
+        			// sorted by the heuristic after the move, i.e. by delta f
+        			std::stable_sort(good_ops.begin(), good_ops.end(), [](const std::pair<pair_1, int> &a, const std::pair<pair_1, int> &b){
+        				return a.second < b.second;
+        			});
         		}
-        		agent_osf[{i, j}] = good_ops;
+        		agent_osf[(i*y)+j] = good_ops;
         	}
         }
         return agent_osf;
 	}
 
-	int list_of_locations_to_heuristic(std::vector<pair_1> locs){
+	int list_of_locations_to_heuristic(const pair_1 *locs) const {
 		int val = 0;
-		for(int i=0; i<locs.size(); i++){
-			val += h[i][locs[i].first][locs[i].second];
+		for(size_t i=0; i<goals.size(); i++){
+			val += h[i][(locs[i].first*y)+locs[i].second];
 		}
 		return val;
 	}
 
-	std::pair<std::vector<std::vector<pair_1> >, int> get_children_and_next_F(pq_node *current_node){
-		std::pair<std::vector<std::vector<pair_1> >, int> temp = select_operators(current_node);
-		std::vector<std::vector<pair_1> > operators = temp.first;
-		int next_big_F = temp.second;
-
-		if(operators.size() == 0){
-			return {operators, next_big_F};
-		}
-
-		std::vector<std::vector<pair_1> > new_child_nodes = get_new_children(current_node->agent_locs, operators);
-		return {new_child_nodes, next_big_F};
+	/*
+	Appends the collision-free children of current_node that have the
+	requested delta f to children, get_size() locations per child, and
+	returns the next stored F of the node (INT_MAX if there is none).
+	*/
+	int get_children_and_next_F(const pq_node *current_node, std::vector<pair_1> &children){
+		return select_operators(current_node, children);
 	}
 
-	std::vector<pair_1> get_new_locations(const std::vector<pair_1> &ops, const std::vector<pair_1> &agent_locs){
-		std::vector<pair_1> new_locs;
-		for(int i=0; i<ops.size(); i++){
-			int new_x = agent_locs[i].first + ops[i].first;
-			int new_y = agent_locs[i].second + ops[i].second;
-			if(new_x >= 0 && new_x < x && new_y >= 0 && new_y < y)
-				new_locs.push_back({new_x, new_y});
+	/*
+	Direct operator selection function. An agent away from its goal pays one
+	step and contributes delta_f = h(v') - h(v) + 1 to the joint move from
+	cell v to v'. An agent waiting at its goal pays nothing, and one leaving
+	it pays for the steps it waited there as well, so that g is the sum of
+	costs of the agents if they all stay at their goals from now on. A joint
+	operator changes f by the sum of these values. The operators
+	with the requested delta f are enumerated agent by agent; the agent lists
+	are sorted by delta f, and a prefix is abandoned as soon as the remaining
+	agents can no longer reach the requested sum or two agents of the prefix
+	collide. The next stored F is the smallest reachable sum above the
+	requested one, computed from the sets of per-agent values without
+	building the product.
+	*/
+	int select_operators(const pq_node *node, std::vector<pair_1> &children){
+		const pair_1 *agent_locs = node->agent_locs;
+		int num_agents = goals.size();
+		int small_f = node->h + node->g;
+		int requested_row = node->big_f - small_f;
+
+		min_rest[num_agents] = 0;
+		max_rest[num_agents] = 0;
+		for(int i=num_agents-1; i>=0; i--){
+			agent_ops[i] = &agent_osfs[i][(agent_locs[i].first*y)+agent_locs[i].second];
+			if(agent_ops[i]->empty()){
+				return INT_MAX;
+			}
+			at_goal[i] = agent_locs[i] == goals[i];
+			offset[i] = at_goal[i] ? -1 - node->waits[i] : h[i][(agent_locs[i].first*y)+agent_locs[i].second] - 1;
+			min_rest[i] = min_rest[i+1] + delta_f(i, agent_ops[i]->front());
+			max_rest[i] = max_rest[i+1] + delta_f(i, agent_ops[i]->back());
 		}
-		return new_locs;
-	}
-
-	bool has_edge_collisions(const std::vector<pair_1> &this_locs, const std::vector<pair_1> &next_locs){
-		std::vector<std::pair<pair_1, pair_1> > forward;
-		std::vector<std::pair<pair_1, pair_1> > backward;
 
-		for(int i=0; i<this_locs.size(); i++){
-			if(this_locs[i] != next_locs[i]){
-				forward.push_back({this_locs[i], next_locs[i]});
+		// reachable[d]: some joint operator changes f by d
+		reachable.assign(max_rest[0] + 1, 0);
+		next_reachable.resize(max_rest[0] + 1);
+		reachable[0] = 1;
+		for(int i=0; i<num_agents; i++){
+			std::fill(next_reachable.begin(), next_reachable.end(), 0);
+			for(int d=0; d<=max_rest[0]; d++){
+				if(!reachable[d])	continue;
+				for(const auto &it:*agent_ops[i]){
+					next_reachable[d + delta_f(i, it)] = 1;
+				}
 			}
+			reachable.swap(next_reachable);
 		}
-		for(int i=0; i<this_locs.size(); i++){
-			if(this_locs[i] != next_locs[i]){
-				backward.push_back({next_locs[i], this_locs[i]});
+		int next_big_F = INT_MAX;
+		for(int d=std::max(requested_row + 1, 0); d<=max_rest[0]; d++){
+			if(reachable[d]){
+				next_big_F = small_f + d;
+				break;
 			}
 		}
 
-		std::set<std::pair<pair_1, pair_1> > set_forward(forward.begin(), forward.end());
-		std::set<std::pair<pair_1, pair_1> > set_backward(backward.begin(), backward.end());
-		
-		std::vector<std::pair<pair_1, pair_1>> common_data;
-		std::set_intersection(set_forward.begin(), set_forward.end(), set_backward.begin(), set_backward.end(), std::back_inserter(common_data));
-		return common_data.size() > 0;
-	}
-
-	bool move_invalid(const std::vector<pair_1> &this_locs, const std::vector<pair_1> &next_locs){
-		std::set<pair_1> set_locs(next_locs.begin(), next_locs.end());
-		bool vertex_collision = (set_locs.size() != next_locs.size());
-		bool edge_collision = has_edge_collisions(this_locs, next_locs);
-		return (vertex_collision || edge_collision);
-	}
-
-	std::vector<std::vector<pair_1> > get_new_children(const std::vector<pair_1> &agent_locs, const std::vector<std::vector<pair_1> > &group_ops){
-		std::vector<std::vector<pair_1> > children;
-
-		for(auto op:group_ops){
-			std::vector<pair_1> new_locs = get_new_locations(op, agent_locs);
-			if(move_invalid(agent_locs, new_locs) == false){
-				children.push_back(new_locs);
+		if(requested_row >= 0 && requested_row <= max_rest[0] && reachable[requested_row]){
+			if(++stamp == INT_MAX){
+				std::fill(now_stamp.begin(), now_stamp.end(), 0);
+				std::fill(next_stamp.begin(), next_stamp.end(), 0);
+				stamp = 1;
+			}
+			for(int i=0; i<num_agents; i++){
+				int cell = (agent_locs[i].first*y)+agent_locs[i].second;
+				now_agent[cell] = i;
+				now_stamp[cell] = stamp;
 			}
+			enumerate_operators(0, requested_row, agent_locs, children);
 		}
 
-		return children;
+		return next_big_F;
 	}
 
-	int get_heuristics_from_op(std::vector<std::pair<pair_1, int> > individual_ops){
-		int heuristic_value = 0;
-		for(int i=0; i<individual_ops.size(); i++){
-			heuristic_value +=  individual_ops[i].second;
+	void enumerate_operators(int agent, int budget, const pair_1 *agent_locs, std::vector<pair_1> &children){
+		if(agent == (int)goals.size()){
+			children.insert(children.end(), next_locs.begin(), next_locs.end());
+			return;
 		}
-		return heuristic_value;
-	}
-
-	std::vector<op_table_type> get_op_table(const std::vector<std::vector<std::pair<pair_1, int> > > &all_possible_ops, const std::vector<pair_1> &agent_locs, int small_f, int h, int g){
-		int num_agents = agent_locs.size();
-		int max_rows = (2*num_agents) + 1;
-
-		std::vector<op_table_type> op_table(max_rows);
-
-		for(auto it:all_possible_ops){//type of it is std::vector<std::pair<pair_1, int> >
-			int this_h = get_heuristics_from_op(it);
-			int this_g = g + num_agents;
-			int this_small_f = this_h + this_g;
-			int delta_small_f = this_small_f - small_f;
-
-			if(!op_table[delta_small_f].is_data_present){
-				op_table_type new_op_table_row;
-				new_op_table_row.delta_h = this_h - h;
-				new_op_table_row.is_data_present = true;
-				std::vector<std::vector<std::pair<pair_1, int> > > tt;	tt.push_back(it);
-                new_op_table_row.operators = std::move(tt);
-                op_table[delta_small_f] = new_op_table_row;
-			} else {
-				op_table[delta_small_f].operators.push_back(it);
-			}
+		const pair_1 &from = agent_locs[agent];
+		for(const auto &it:*agent_ops[agent]){
+			int delta = delta_f(agent, it);
+			if(delta > budget - min_rest[agent+1])	break;
+			if(delta < budget - max_rest[agent+1])	continue;
+
+			pair_1 to = {from.first + it.first.first, from.second + it.first.second};
+			int cell = (to.first*y)+to.second;
+			// vertex collision with an earlier agent
+			if(next_stamp[cell] == stamp)	continue;
+			// edge collision: swapping places with an earlier agent
+			if(to != from && now_stamp[cell] == stamp && now_agent[cell] < agent && next_locs[now_agent[cell]] == from)	continue;
+
+			next_locs[agent] = to;
+			next_stamp[cell] = stamp;
+			enumerate_operators(agent + 1, budget - delta, agent_locs, children);
+			next_stamp[cell] = 0;
 		}
-
-		return op_table;
 	}
 
-	int get_delta_big_F_next(const std::vector<op_table_type> &op_table, int requested_row){
-		if(requested_row > op_table.size())	return INT_MAX;
-
-        int my_index = requested_row;
-        if(op_table[requested_row].is_data_present == false){
-        	my_index = -1;
-        }
-        int next_start_index = my_index + 1;
-        int delta_big_F_next = INT_MAX;
-        for(int i=next_start_index; i<op_table.size(); i++){
-        	if(op_table[i].is_data_present){
-        		return i;
-        	}
-        }
-        return delta_big_F_next;
-	}
-
-	std::pair<std::vector<std::vector<pair_1> >, int> select_operators(pq_node *node){
-		std::vector<pair_1> agent_locs = node->agent_locs;
-		int big_f = node->big_f;
-		int h = node->h;
-		int g = node->g;
-		int small_f = h + g;
-
-		int requested_row = big_f - small_f;
-
-		std::vector<op_table_type> op_table;
-
-		if(osf_table.find(agent_locs) != osf_table.end()){
-			op_table = osf_table[agent_locs];
-		} else {
-			std::vector<std::vector<std::pair<pair_1, int> > > ops_to_cross_prod;
-			for(int i=0; i<agent_locs.size(); i++){
-				ops_to_cross_prod.push_back(agent_osfs[i][{agent_locs[i].first, agent_locs[i].second}]);
-			}
-			std::vector<std::vector<std::pair<pair_1, int> > > all_possible_ops = cart_product(ops_to_cross_prod);
-			op_table = get_op_table(all_possible_ops, agent_locs, small_f, h, g);
-			if(op_table.size()){
-				osf_table[agent_locs] = op_table;
-			}
-		}
-		int delta_big_F_next = get_delta_big_F_next(op_table, requested_row);
-
-        int next_big_F = small_f + delta_big_F_next;
-        if(requested_row > op_table.size() || op_table[requested_row].is_data_present == false){
-        	return {std::vector<std::vector<pair_1> >(), next_big_F};
-        }
-
-        std::vector<std::vector<std::pair<pair_1, int> > > all_ops = op_table[requested_row].operators;
-        std::vector<std::vector<pair_1> > good_ops;
-        for(auto it:all_ops){
-        	std::vector<pair_1> just_ops;
-        	for(auto u:it){
-        		just_ops.push_back(u.first);
-        	}
-        	good_ops.push_back(just_ops);
-        }
-
-		return {good_ops, next_big_F};
+	// the wait of an agent at its goal is the only operator there with h(v') = 0;
+	// the operators of every agent stay sorted by delta f
+	int delta_f(int agent, const std::pair<pair_1, int> &op) const {
+		return at_goal[agent] && op.second == 0 ? 0 : op.second - offset[agent];
 	}
 
 };
@@ -409,53 +440,77 @@ namespace EPEA{
 	template<typename Mapf>
 	class EPEAStar{
 	public:
-		EPEAStar()	{}
-		bool search(Mapf mapf, std::vector<pair_1> starts, std::pair<int, std::vector<std::vector<pair_1> > > *solution){
-			OSF<Mapf> osf(mapf);
-			std::unordered_set<std::vector<pair_1>, VectorHashBySize, VectorCompareByElements> visited;
+		EPEAStar():
+			nodes_expanded(0)	{}
+
+		// distances of all cells to each goal, e.g. tables shared with other solvers; search() computes them otherwise
+		void set_goal_distances(const std::vector<const uint16_t*> &tables){	goal_tables = tables;	}
+
+		// called every interrupt_interval expansions with the expansions so far and the smallest F in the
+		// open list, a lower bound on the optimal cost; the search gives up as soon as it returns true
+		void set_interrupt(std::function<bool(int, int)> f){	interrupt = f;	}
+
+		bool search(const Mapf &mapf, const std::vector<pair_1> &starts, std::pair<int, std::vector<std::vector<pair_1> > > *solution){
+			OSF<Mapf> osf(mapf, goal_tables);
+			int n_agents = osf.get_size();
+			const std::vector<pair_1> &goals = osf.get_goals();
+			joint_state_table visited(n_agents, mapf.get_y());
+			node_arena nodes(n_agents);
+			// children of the current expansion, n_agents locations each
+			std::vector<pair_1> children;
+			std::vector<int> child_waits(n_agents, 0);
 
 			int mycounter = 0; //counter used to break ties in the priority queue
 			int g = 0;
-			int h = osf.list_of_locations_to_heuristic(starts);
-			int n_agents = osf.get_size();
+			int h = osf.list_of_locations_to_heuristic(starts.data());
 
-			pq_node *start_node = new pq_node(starts, 0, h, g+h, g+h, NULL);
+			pq_node *start_node = nodes.create(starts.data(), child_waits.data(), 0, h, g+h, g+h, NULL);
+			visited.first(starts.data()) = start_node;
 
 			priority_tuple pq_tuple = {g+h, -g, h, mycounter};
 
-			boost::heap::fibonacci_heap<heap_node, boost::heap::compare<compare_node> > heap;
+			std::priority_queue<heap_node, std::vector<heap_node>, compare_node> heap;
 			heap.push({pq_tuple, start_node});
 
 			mycounter += 1;
-			int nodes_expanded = 0;
+			nodes_expanded = 0;
 
 			while(!heap.empty()){
 				heap_node t = heap.top();
-				heap.pop();
-				priority_tuple pq_tuple = t.first;
 				pq_node *current_node = t.second;
+				// a node found after this one was queued costs at most as much
+				if(current_node->dominated){
+					heap.pop();
+					continue;
+				}
+				if(interrupt && nodes_expanded % interrupt_interval == 0 && interrupt(nodes_expanded, std::get<0>(t.first))){
+					return false;
+				}
+				heap.pop();
 
-				if(current_node->agent_locs == mapf.get_goals()){
-					find_solution(current_node, mapf.get_goals(), solution);
+				if(std::equal(goals.begin(), goals.end(), current_node->agent_locs)){
+					find_solution(current_node, goals, solution);
 					return true;
 				}
-				std::pair<std::vector<std::vector<pair_1> >, int> temp = osf.get_children_and_next_F(current_node);
-				std::vector<std::vector<pair_1> > new_child_nodes = temp.first;
-				int next_big_f = temp.second;
-
-				for(auto child:new_child_nodes){
-					pq_node *child_node = get_child_node(child, current_node, osf);
-					if(visited.find(child) == visited.end()){
-						visited.insert(child);
-						pq_tuple = {child_node->big_f, child_node->h, -child_node->g, mycounter};
-						heap.push({pq_tuple, child_node});
-						mycounter++;
+				children.clear();
+				int next_big_f = osf.get_children_and_next_F(current_node, children);
+
+				for(size_t k=0; k<children.size(); k+=n_agents){
+					const pair_1 *child = &children[k];
+					int child_g = current_node->g + move_cost(current_node, child, goals, child_waits.data());
+					pq_node *&first = visited.first(child);
+					if(!add_undominated(first, child_g, child_waits.data(), n_agents)){
+						continue;
 					}
+					pq_node *child_node = get_child_node(child, child_waits.data(), child_g, current_node, osf, nodes);
+					child_node->next_same_locs = first;
+					first = child_node;
+					pq_tuple = {child_node->big_f, child_node->h, -child_node->g, mycounter};
+					heap.push({pq_tuple, child_node});
+					mycounter++;
 				}
 
-				if(next_big_f == INT_MAX){
-					visited.insert(current_node->agent_locs);
-				}else{
+				if(next_big_f != INT_MAX){
 					current_node->big_f = next_big_f;
 					pq_tuple = {current_node->big_f, current_node->h, -current_node->g, mycounter};
 					heap.push({pq_tuple, current_node});
@@ -466,51 +521,104 @@ namespace EPEA{
 			return false;
 		}
 
-		void find_solution(pq_node *node, std::vector<pair_1> goals, std::pair<int, std::vector<std::vector<pair_1> > > *solution){
+		// expansions of the last search, counting every re-expansion of a node
+		int get_nodes_expanded() const {	return nodes_expanded;	}
+
+		void find_solution(const pq_node *node, const std::vector<pair_1> &goals, std::pair<int, std::vector<std::vector<pair_1> > > *solution){
 			std::vector<std::vector<pair_1> > paths;
 			paths.push_back(goals);
 
 			while(node->parent){
-				paths.push_back(node->parent->agent_locs);
+				paths.emplace_back(node->parent->agent_locs, node->parent->agent_locs + goals.size());
 				node = node->parent;
 			}
 
 			std::reverse(paths.begin(), paths.end());
-			
+
+			// an agent may pass its goal and leave again, so only the waits after its last arrival are dropped
 			std::vector<std::vector<pair_1> > processed_path(goals.size(), std::vector<pair_1>());
-			for(int i=0; i<paths.size(); i++){
-				for(int j=0; j<paths[i].size(); j++){
-					if(processed_path[j].size() > 0 &&  processed_path[j][processed_path.size()-1] == goals[j])	continue;
+			int val = 0;
+			for(size_t j=0; j<goals.size(); j++){
+				size_t arrival = paths.size() - 1;
+				while(arrival > 0 && paths[arrival-1][j] == goals[j])	arrival--;
+				for(size_t i=0; i<=arrival; i++){
 					processed_path[j].push_back(paths[i][j]);
 				}
+				val += arrival;
 			}
 			solution->second = processed_path;
+			solution->first = val;
+		}
 
-			int val = 0;
-			for(int i=0; i<processed_path.size(); i++){
-				std::set<pair_1> set_path(processed_path[i].begin(), processed_path[i].end());
-				val += (set_path.size() - 1);
+		/*
+		Cost of the joint move from parent_node to child, and the waits of the
+		agents after it. Every agent away from its goal pays one step. An agent
+		waiting at its goal pays nothing until it leaves, and then pays for the
+		steps it waited there as well, since its path does not end there.
+		*/
+		static int move_cost(const pq_node *parent_node, const pair_1 *child, const std::vector<pair_1> &goals, int *waits){
+			int cost = 0;
+			for(size_t i=0; i<goals.size(); i++){
+				if(parent_node->agent_locs[i] != goals[i]){
+					cost++;
+					waits[i] = 0;
+				}else if(child[i] == goals[i]){
+					waits[i] = parent_node->waits[i] + 1;
+				}else{
+					cost += 1 + parent_node->waits[i];
+					waits[i] = 0;
+				}
 			}
-			solution->first = val;
+			return cost;
 		}
 
-		pq_node* get_child_node(const std::vector<pair_1> &child, pq_node *parent_node, OSF<Mapf> osf){
-			int h_val = osf.list_of_locations_to_heuristic(child);
-			int num_of_agents_not_at_goal = 0;
+		/*
+		Whether a node with cost g and the given waits is worth adding to the
+		undominated nodes of its joint locations, starting at first. A node
+		dominates another one of the same locations if it costs at most as much
+		after any continuation; since only an agent leaving its goal pays for
+		its waits, that is g + sum of max(0, waits - other waits) <= other g.
+		If the node is worth adding, the nodes it dominates are marked and
+		unlinked.
+		*/
+		static bool add_undominated(pq_node *&first, int g, const int *waits, int n_agents){
+			for(const pq_node *node = first; node; node = node->next_same_locs){
+				if(dominates(node->g, node->waits, g, waits, n_agents))	return false;
+			}
+			for(pq_node **link = &first; *link;){
+				if(dominates(g, waits, (*link)->g, (*link)->waits, n_agents)){
+					(*link)->dominated = true;
+					*link = (*link)->next_same_locs;
+				}else{
+					link = &(*link)->next_same_locs;
+				}
+			}
+			return true;
+		}
 
-			std::vector<pair_1> goals = osf.get_goals();
-			for(int i=0; i<child.size(); i++){
-				if(child[i] != goals[i])	num_of_agents_not_at_goal++;
+		static bool dominates(int g, const int *waits, int other_g, const int *other_waits, int n_agents){
+			for(int i=0; i<n_agents && g <= other_g; i++){
+				g += std::max(0, waits[i] - other_waits[i]);
 			}
+			return g <= other_g;
+		}
 
-			int g = parent_node->g + num_of_agents_not_at_goal;
+		// O(n_agents) and allocation-free, apart from the arena growing by a block
+		pq_node* get_child_node(const pair_1 *child, const int *waits, int g, pq_node *parent_node, const OSF<Mapf> &osf, node_arena &nodes){
+			int h_val = osf.list_of_locations_to_heuristic(child);
 			int small_f = g + h_val;
 			int big_f = small_f;
 
-			pq_node *temp_node = new pq_node(child, g, h_val, small_f, big_f, parent_node);
+			pq_node *temp_node = nodes.create(child, waits, g, h_val, small_f, big_f, parent_node);
 			return temp_node;
 		}
 
+	private:
+		static const int interrupt_interval = 1024;
+
+		int nodes_expanded;
+		std::function<bool(int, int)> interrupt;
+		std::vector<const uint16_t*> goal_tables;
 	};
 }
 
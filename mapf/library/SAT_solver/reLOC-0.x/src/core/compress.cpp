@@ -338,6 +338,12 @@ namespace sReloc
     }        
 
 
+    void sMultirobotSolutionCompressor::set_Interrupt(const std::function<bool(int, int)> &interrupt)
+    {
+	m_interrupt = interrupt;
+    }
+
+
     int sMultirobotSolutionCompressor::calc_MakespanLowerBound(const sRobotArrangement                     &start_arrangement,
 							       const sRobotArrangement                     &final_arrangement,
 							       const sUndirectedGraph::Distances_2d_vector &all_pairs_Distances)
@@ -7522,6 +7528,11 @@ namespace sReloc
 
 	while (true)
 	{
+	    if (m_interrupt && m_interrupt(expansion_count, total_cost))
+	    {
+		optimal_cost = MAKESPAN_UNDEFINED;
+		return sMULTIROBOT_SOLUTION_COMPRESSOR_INDET_INFO;
+	    }
 	    if (*solver != NULL)
 	    {
 		//delete *solver;
@@ -21,6 +21,7 @@
 
 #include <pthread.h>
 
+#include <functional>
 #include <vector>
 
 #include "types.h"
@@ -362,6 +363,9 @@ namespace sReloc
 	void set_Ratio(double ratio);
 	void set_Robustness(int robustness);
 	void set_Range(int range);	
+	/* called before each sum of costs is tried with the attempts so far and that cost;
+	   the search for the optimal cost stops without a solution as soon as it returns true */
+	void set_Interrupt(const std::function<bool(int, int)> &interrupt);
 
 	int calc_MakespanLowerBound(const sRobotArrangement                     &start_arrangement,
 				    const sRobotArrangement                     &final_arrangement,
@@ -2286,6 +2290,7 @@ namespace sReloc
 	double m_ratio;
 	int m_robustness;
 	int m_range;
+	std::function<bool(int, int)> m_interrupt;
     };
 
 
@@ -2556,7 +2556,7 @@ namespace sReloc
 	fprintf(fw, "%s]\n", indent.c_str());
     }
 
-    bool sUndirectedGraph::from_vector(std::vector<std::pair<int, int> > obstacles, std::vector<std::pair<int, int> > goals, std::vector<std::pair<int, int> > starts, int x, int y, std::vector<std::vector<int> > graph){
+    bool sUndirectedGraph::from_vector(const std::vector<std::pair<int, int> > &obstacles, const std::vector<std::pair<int, int> > &goals, const std::vector<std::pair<int, int> > &starts, int x, int y, const std::vector<int> &offsets, const std::vector<int> &adjacency){
 	m_Vertices.clear();
 	m_Edges.clear();
 	for(int i=0; i<x; i++){
@@ -2566,12 +2566,10 @@ namespace sReloc
 		}
 	}
 
-	int cnt = 0;
-	for(auto it=graph.begin(); it!=graph.end(); it++){
-		for(auto it2=it->begin(); it2!=it->end(); it2++){
-			add_Edge(cnt, *(it2));
+	for(int v=0; v+1<(int)offsets.size(); v++){
+		for(int e=offsets[v]; e<offsets[v+1]; e++){
+			add_Edge(v, adjacency[e]);
 		}
-		cnt++;
 	}
 	return true;
     }
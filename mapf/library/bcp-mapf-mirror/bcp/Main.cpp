@@ -24,8 +24,56 @@ Author: Edward Lam <ed@ed-lam.com>
 #include "scip/scipshell.h"
 #include "scip/scipdefplugins.h"
 #include "cxxopts.hpp"
+#include <cmath>
+#include <functional>
 #include <vector>
 
+#define EVENTHDLR_NAME "interrupt"
+#define EVENTHDLR_DESC "Reports progress and interrupts the solve on request"
+#define EVENTHDLR_EVENTS (SCIP_EVENTTYPE_LPEVENT | SCIP_EVENTTYPE_NODESOLVED)
+
+// Event handler data
+struct SCIP_EventhdlrData
+{
+    // Called with the number of LPs solved, the dual bound and the incumbent
+    // (-1 if none); the solve is interrupted as soon as it returns true
+    std::function<bool(size_t, int, int)> interrupt;
+};
+
+// Catch LP and node events when the solve starts
+static
+SCIP_DECL_EVENTINIT(eventInitInterrupt)
+{
+    SCIP_CALL(SCIPcatchEvent(scip, EVENTHDLR_EVENTS, eventhdlr, nullptr, nullptr));
+    return SCIP_OKAY;
+}
+
+// Drop the events when the solve ends
+static
+SCIP_DECL_EVENTEXIT(eventExitInterrupt)
+{
+    SCIP_CALL(SCIPdropEvent(scip, EVENTHDLR_EVENTS, eventhdlr, nullptr, -1));
+    return SCIP_OKAY;
+}
+
+// Check for interruption after every LP, so also during column generation
+static
+SCIP_DECL_EVENTEXEC(eventExecInterrupt)
+{
+    auto eventhdlrdata = SCIPeventhdlrGetData(eventhdlr);
+    const auto dual_bound = SCIPgetDualbound(scip);
+    const int lower_bound = SCIPisInfinity(scip, std::abs(dual_bound)) ?
+                            -1 : static_cast<int>(std::ceil(dual_bound - 1e-6));
+    const int incumbent = SCIPgetNSols(scip) > 0 ?
+                          static_cast<int>(std::lround(SCIPgetPrimalbound(scip))) : -1;
+    if (eventhdlrdata->interrupt(SCIPgetNLPs(scip), lower_bound, incumbent) &&
+        !SCIPisStopped(scip))
+    {
+        SCIP_CALL(SCIPinterruptSolve(scip));
+    }
+    return SCIP_OKAY;
+}
+
 static
 SCIP_RETCODE start_solver(
     int x, 
@@ -33,21 +81,35 @@ SCIP_RETCODE start_solver(
     std::vector<std::pair<int, int> > obstacles, 
     std::vector<std::pair<int, int> > starts,
     std::vector<std::pair<int, int> > goals,
-    std::pair<float, std::vector<std::string> > *solution
+    std::pair<float, std::vector<std::string> > *solution,
+    SCIP_Real time_limit = 0,                                   // Seconds, 0 for none
+    std::function<bool(size_t, int, int)> interrupt = nullptr   // See SCIP_EventhdlrData
 )
 {
-    // Parse program options.
-    SCIP_Real time_limit = 0;
-   
     // Initialize SCIP.
     SCIP* scip = nullptr;
     SCIP_CALL(SCIPcreate(&scip));
+    SCIP_EventhdlrData eventhdlrdata{interrupt};
 
     // Set up plugins.
     {
         // Include default SCIP plugins.
         SCIP_CALL(SCIPincludeDefaultPlugins(scip));
 
+        // Include the event handler for interruption.
+        if (interrupt)
+        {
+            SCIP_EVENTHDLR* eventhdlr = nullptr;
+            SCIP_CALL(SCIPincludeEventhdlrBasic(scip,
+                                                &eventhdlr,
+                                                EVENTHDLR_NAME,
+                                                EVENTHDLR_DESC,
+                                                eventExecInterrupt,
+                                                &eventhdlrdata));
+            SCIP_CALL(SCIPsetEventhdlrInit(scip, eventhdlr, eventInitInterrupt));
+            SCIP_CALL(SCIPsetEventhdlrExit(scip, eventhdlr, eventExitInterrupt));
+        }
+
         // Disable parallel solve.
         SCIP_CALL(SCIPsetIntParam(scip, "parallel/maxnthreads", 1));
         SCIP_CALL(SCIPsetIntParam(scip, "lp/threads", 1));
@@ -120,8 +182,11 @@ SCIP_RETCODE start_solver(
         println("");
         //SCIP_CALL(SCIPprintStatistics(scip, NULL));
 
-        // Write best solution to file.
-        *solution = write_best_solution(scip);
+        // Write best solution to file if it is proven optimal.
+        if (SCIPgetStatus(scip) == SCIP_STATUS_OPTIMAL)
+        {
+            *solution = write_best_solution(scip);
+        }
     }
 
     // Free memory.
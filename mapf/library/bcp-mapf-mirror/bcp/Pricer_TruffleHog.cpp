@@ -33,6 +33,10 @@ Author: Edward Lam <ed@ed-lam.com>
 //#include "Constraint_WaitBranching.h"
 #include "Constraint_LengthBranching.h"
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 //#include <numeric>
 
 #include "trufflehog/Instance.h"
@@ -44,6 +48,10 @@ Author: Edward Lam <ed@ed-lam.com>
 #define PRICER_PRIORITY                      0
 #define PRICER_DELAY                      TRUE  // Only call pricer if all problem variables have non-negative reduced costs
 
+// Default parameters
+#define DEFAULT_THREADS                      0  // Number of agents to price concurrently (0: one per hardware thread)
+#define DEFAULT_WARM_START               FALSE  // Skip agents whose reduced cost cannot be negative given the previous round at the node
+
 struct PricingOrder
 {
     Agent a;
@@ -51,6 +59,120 @@ struct PricingOrder
     SCIP_VAR* new_var;
 };
 
+// Negative dual value of a row in the previous pricing round
+struct PreviousDual
+{
+    SCIP_ROW* row;         // Row
+    SCIP_Real dual;        // Dual value in the previous round
+    Agent a1;              // Agent whose paths are in the row, -1 if all agents
+    Agent a2;              // Second agent whose paths are in the row, -1 if none
+    Int max_coeff;         // Largest coefficient of a path in the row
+};
+
+// Threads that price the agents of a batch, kept alive between batches and rounds
+class PricingWorkers
+{
+    Vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable done_;
+    std::function<void(Int)> job_;
+    Int nb_tasks_;
+    Int nb_active_;
+    Int generation_;
+    bool stop_;
+
+  public:
+    // Constructors and destructor
+    explicit PricingWorkers(const Int nb_threads) :
+        nb_tasks_(0),
+        nb_active_(0),
+        generation_(0),
+        stop_(false)
+    {
+        for (Int idx = 1; idx < nb_threads; ++idx)
+        {
+            threads_.emplace_back([this, idx]() { worker_loop(idx); });
+        }
+    }
+    PricingWorkers(const PricingWorkers&) = delete;
+    PricingWorkers& operator=(const PricingWorkers&) = delete;
+    ~PricingWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wakeup_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    // Call job(idx) for every task idx < nb_tasks and wait for all of them. Task 0 runs
+    // in the calling thread and task idx in worker idx.
+    template<class F>
+    void run(const Int nb_tasks, F&& job)
+    {
+        debug_assert(nb_tasks <= static_cast<Int>(threads_.size()) + 1);
+        if (nb_tasks > 1)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                job_ = std::ref(job);
+                nb_tasks_ = nb_tasks;
+                nb_active_ = nb_tasks - 1;
+                generation_++;
+            }
+            wakeup_.notify_all();
+        }
+        if (nb_tasks > 0)
+        {
+            job(0);
+        }
+        if (nb_tasks > 1)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this]() { return nb_active_ == 0; });
+            job_ = nullptr;
+        }
+    }
+
+  private:
+    void worker_loop(const Int idx)
+    {
+        Int seen = 0;
+        while (true)
+        {
+            // Wait for a batch with a task for this worker.
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wakeup_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+                if (stop_)
+                {
+                    return;
+                }
+                seen = generation_;
+                if (idx >= nb_tasks_)
+                {
+                    continue;
+                }
+            }
+
+            // Run the task.
+            job_(idx);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--nb_active_ == 0)
+                {
+                    done_.notify_one();
+                }
+            }
+        }
+    }
+};
+
 // Pricer data
 struct SCIP_PricerData
 {
@@ -58,6 +180,13 @@ struct SCIP_PricerData
     SCIP_Real* price_priority;                   // Pricing priority of each agent
     PricingOrder* order;                         // Order of agents to price
     SCIP_Real* agent_part_dual;                  // Dual variable values of agent partition constraints
+    Vector<UniquePtr<AStar>> astars;             // Pricing solvers of the threads other than the main thread
+    UniquePtr<PricingWorkers> workers;           // Threads other than the main thread
+
+    SCIP_Bool warm_start;                        // Skip agents whose reduced cost cannot be negative
+    SCIP_Longint warm_start_node;                // Node of the previous pricing round, -1 if none
+    Vector<SCIP_Real> min_path_cost;             // Lower bound on the path cost of each agent in the previous round
+    Vector<PreviousDual> prev_duals;             // Negative dual values in the previous round
 
     SCIP_CONSHDLR* vertex_branching_conshdlr;    // Constraint handler for vertex branching
 //    SCIP_CONSHDLR* wait_branching_conshdlr;      // Constraint handler for wait branching
@@ -95,6 +224,31 @@ SCIP_DECL_PRICERINIT(pricerTruffleHogInit)
     SCIP_CALL(SCIPallocBlockMemoryArray(scip, &pricerdata->agent_part_dual, pricerdata->N));
     // Overwritten in each run. No need for initialisation.
 
+    // Create a pricing solver for every additional thread. The solvers share the
+    // distances to the goals.
+    {
+        int nb_threads;
+        SCIP_CALL(SCIPgetIntParam(scip, "pricers/" PRICER_NAME "/threads", &nb_threads));
+        if (nb_threads == 0)
+        {
+            nb_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        nb_threads = std::min(nb_threads, pricerdata->N);
+
+        const auto& map = SCIPprobdataGetMap(probdata);
+        const auto& heuristic = SCIPprobdataGetAStar(probdata).heuristic();
+        for (Int idx = 1; idx < nb_threads; ++idx)
+        {
+            pricerdata->astars.push_back(std::make_unique<AStar>(map, heuristic));
+        }
+        pricerdata->workers = std::make_unique<PricingWorkers>(nb_threads);
+    }
+
+    // Set up warm-starting. The bounds are only known after the first round at a node.
+    SCIP_CALL(SCIPgetBoolParam(scip, "pricers/" PRICER_NAME "/warmstart", &pricerdata->warm_start));
+    pricerdata->warm_start_node = -1;
+    pricerdata->min_path_cost.assign(pricerdata->N, -std::numeric_limits<SCIP_Real>::infinity());
+
     // Find constraint handler for branching decisions.
     pricerdata->vertex_branching_conshdlr = SCIPfindConshdlr(scip, "vertex_branching");
     release_assert(pricerdata->vertex_branching_conshdlr,
@@ -114,6 +268,26 @@ SCIP_DECL_PRICERINIT(pricerTruffleHogInit)
     return SCIP_OKAY;
 }
 
+// Deinitialize pricer (called before the branch-and-bound process is freed)
+static
+SCIP_DECL_PRICEREXITSOL(pricerTruffleHogExitsol)
+{
+    // Check.
+    debug_assert(scip);
+    debug_assert(pricer);
+
+    // Get pricer data.
+    auto pricerdata = SCIPpricerGetData(pricer);
+    debug_assert(pricerdata);
+
+    // Forget the previous round since its rows are freed.
+    pricerdata->warm_start_node = -1;
+    pricerdata->prev_duals.clear();
+
+    // Done.
+    return SCIP_OKAY;
+}
+
 // Free pricer
 static
 SCIP_DECL_PRICERFREE(pricerTruffleHogFree)
@@ -232,6 +406,463 @@ inline Direction get_direction(
     }
 }
 
+// Get the largest coefficient of a path in a two-agent robust cut
+static
+Int get_max_coeff(
+    const TwoAgentRobustCut& cut    // Cut
+)
+{
+    // A path uses one edge at the timestep of the cut.
+    if (cut.is_same_time())
+    {
+        return 1;
+    }
+
+    // Count the timesteps of the edges of each agent.
+    Int max_coeff = 0;
+    Vector<Time> times;
+    for (const auto a : {cut.a1(), cut.a2()})
+    {
+        times.clear();
+        for (auto [it, end] = cut.edge_times(a); it != end; ++it)
+        {
+            times.push_back(it->t);
+        }
+        std::sort(times.begin(), times.end());
+        const auto nb_times = std::unique(times.begin(), times.end()) - times.begin();
+        max_coeff = std::max<Int>(max_coeff, nb_times);
+    }
+    return max_coeff;
+}
+
+// Path of another agent to avoid
+struct ReservedPath
+{
+    Agent a;                // Agent of the path
+    Time path_length;       // Path length
+    const Edge* path;       // Path
+};
+
+// Master problem data needed to price an agent. Everything is read from SCIP before the
+// agents are priced so that the pricing problems can be solved concurrently.
+struct PricingProblem
+{
+    Time makespan;                                                         // Length of the longest path
+    const SCIP_Real* agent_part_dual;                                      // Dual variable values of agent partition constraints
+    EdgePenalties global_edge_penalties;                                   // Edge penalties of all agents
+    Vector<ReservedPath> reserved_paths;                                   // Paths in the LP solution and new paths
+    Vector<Pair<NodeTime, Cost>> vertex_conflicts;                         // Vertex conflicts with negative dual
+    Vector<Pair<const TwoAgentRobustCut*, Cost>> two_agent_robust_cuts;    // Two-agent robust cuts with negative dual
+#ifdef USE_GOAL_CONFLICTS
+    Vector<Tuple<Agent, Agent, NodeTime, Cost>> goal_conflicts;            // Goal conflicts with negative dual
+#endif
+    Vector<Tuple<Agent, VertexBranchDirection, NodeTime>> vertex_branching;    // Active vertex branching decisions
+    Vector<Tuple<Agent, LengthBranchDirection, NodeTime>> length_branching;    // Active length branching decisions
+
+    PricingProblem(const Int map_size) : global_edge_penalties(map_size) {}
+};
+
+// Solve the pricing problem of one agent. Runs in a pricing thread, so it must not call
+// SCIP and must only modify its own solver.
+template<bool is_farkas>
+static
+void price_agent(
+    const PricingProblem& problem,    // Master problem data
+    const Map& map,                   // Map
+    const AgentsData& agents,         // Agents
+    AStar& astar,                     // Pricing solver of this thread
+    const Agent a,                    // Agent
+    Vector<Edge>& path,               // Output path, empty if none is found
+    SCIP_Real& path_cost,             // Output path cost
+    SCIP_Real& min_path_cost          // Output lower bound on the cost of a path of the agent
+)
+{
+    // Get agent.
+    const auto start = agents[a].start;
+    const auto goal = agents[a].goal;
+    const auto agent_part_dual = problem.agent_part_dual;
+    path_cost = 0.0;
+    path.clear();
+    min_path_cost = -std::numeric_limits<SCIP_Real>::infinity();
+
+    // Get solver.
+    auto& restab = astar.reservation_table();
+    auto& edge_penalties = astar.edge_penalties();
+#ifdef USE_GOAL_CONFLICTS
+    auto& goal_crossings = astar.goal_crossings();
+#endif
+
+    // Clear previous run.
+    auto& time_finish_penalties = astar.time_finish_penalties();
+    time_finish_penalties.clear();
+
+    // Set up reservation table. Reserve vertices in use by all other agents and
+    // reserve vertices in all new paths.
+    restab.clear_reservations();
+    for (const auto& [path_a, path_length, path] : problem.reserved_paths)
+        if (path_a != a)
+        {
+            // Update reservation table.
+            Time t = 0;
+            {
+                const auto n = path[t].n;
+                restab.reserve(NodeTime{n, t});
+                restab.reserve(NodeTime{n, t + 1});
+            }
+            for (t = 1; t < path_length; ++t)
+            {
+                const auto n = path[t].n;
+                restab.reserve(NodeTime{n, t - 1});
+                restab.reserve(NodeTime{n, t});
+                restab.reserve(NodeTime{n, t + 1});
+            }
+            const auto n = path[path_length - 1].n;
+            for (++t; t < problem.makespan; ++t)
+            {
+                restab.reserve(NodeTime{n, t});
+            }
+        }
+
+    // Modify edge costs for two-agent robust cuts.
+    edge_penalties = problem.global_edge_penalties;
+    for (const auto& [cut, dual] : problem.two_agent_robust_cuts)
+        if (a == cut->a1() || a == cut->a2())
+        {
+            // Add the dual variable value to the edges.
+            if (cut->is_same_time())
+            {
+                const auto t = cut->t();
+                for (auto [it, end] = cut->edges(a); it != end; ++it)
+                {
+                    const auto e = *it;
+                    auto& penalties = edge_penalties.get_edge_penalties(e.n, t);
+                    penalties.d[e.d] -= dual;
+                }
+            }
+            else
+            {
+                for (auto [it, end] = cut->edge_times(a); it != end; ++it)
+                {
+                    const auto n = it->n;
+                    const auto d = it->d;
+                    const auto t = it->t;
+                    auto& penalties = edge_penalties.get_edge_penalties(n, t);
+                    penalties.d[d] -= dual;
+                }
+            }
+        }
+
+    // Add goal crossings. If a2 uses the goal of a1 at or after time t, incur the penalty.
+#ifdef USE_GOAL_CONFLICTS
+    goal_crossings.clear();
+    for (const auto& [a1, a2, nt, dual] : problem.goal_conflicts)
+        if (a == a2)
+        {
+            auto& goal = goal_crossings.emplace_back();
+            goal.dual = dual;
+            goal.nt = nt;
+        }
+#endif
+
+    // Modify edge costs for vertex branching decisions.
+    Vector<NodeTime> segments;
+    segments.push_back(NodeTime{start, 0});
+    for (const auto& [branch_a, dir, nt] : problem.vertex_branching)
+    {
+        // Enforce the decision.
+        if (branch_a == a && dir == VertexBranchDirection::Use)
+        {
+            // End the path segment.
+            segments.push_back(nt);
+        }
+        else if (branch_a == a || dir == VertexBranchDirection::Use)
+        {
+            // Don't use the vertex.
+            const auto prev_time = nt.t - 1;
+            {
+                const auto n = map.get_south(nt.n);
+                auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                penalties.north = NAN;
+            }
+            {
+                const auto n = map.get_north(nt.n);
+                auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                penalties.south = NAN;
+            }
+            {
+                const auto n = map.get_west(nt.n);
+                auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                penalties.east = NAN;
+            }
+            {
+                const auto n = map.get_east(nt.n);
+                auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                penalties.west = NAN;
+            }
+            {
+                const auto n = map.get_wait(nt.n);
+                auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                penalties.wait = NAN;
+            }
+        }
+    }
+
+    // Modify edge costs for wait branching decisions.
+    Time earliest_finish = 0;
+//    for (Int c = 0; c < n_wait_branching_conss; ++c)
+//    {
+//        // Get the constraint.
+//        auto cons = wait_branching_conss[c];
+//        debug_assert(cons);
+//
+//        // Ignore constraints that are not active since these are not on the current
+//        // active path of the search tree or constraints for a different agent.
+//        if (!SCIPconsIsActive(cons) || SCIPgetWaitBranchingAgent(cons) != a)
+//            continue;
+//
+//        // Enforce the decision.
+//        const auto dir = SCIPgetWaitBranchingDirection(cons);
+//        const auto t = SCIPgetWaitBranchingTime(cons);
+//        if (dir == WaitBranchDirection::MustWait)
+//        {
+//            for (Coord x = 0; x < width; ++x)
+//                for (Coord y = 0; y < height; ++y)
+//                {
+//                    const auto n = map.get_id(x, y);
+//                    auto& duals = edge_duals.get_edge_duals(n, t);
+//                    duals.north = NAN;
+//                    duals.south = NAN;
+//                    duals.east = NAN;
+//                    duals.west = NAN;
+//                }
+//
+//            if (t + 1 > earliest_finish)
+//                earliest_finish = t + 1;
+//        }
+//        else
+//        {
+//            for (Coord x = 0; x < width; ++x)
+//                for (Coord y = 0; y < height; ++y)
+//                {
+//                    const auto n = map.get_id(x, y);
+//                    auto& duals = edge_duals.get_edge_duals(n, t);
+//                    duals.wait = NAN;
+//                }
+//        }
+//        edge_duals_changed = true;
+//    }
+
+    // Sort segments by time.
+    std::sort(segments.begin(), segments.end(), [](const auto& a, const auto& b)
+    {
+        return a.t < b.t;
+    });
+#ifdef DEBUG
+    for (size_t idx = 0; idx < segments.size() - 1; ++idx)
+    {
+        debug_assert(segments[idx].t < segments[idx + 1].t);
+    }
+#endif
+
+    // Modify edge costs for length branching decisions.
+    debug_assert(astar.max_path_length() >= 1);
+    Time latest_finish = astar.max_path_length() - 1;
+    for (const auto& [branch_a, dir, nt] : problem.length_branching)
+    {
+        // Enforce the decision if the same agent. Disable crossing if different
+        // agent.
+        if (branch_a == a)
+        {
+            if (dir == LengthBranchDirection::LEq && nt.t < latest_finish)
+            {
+                latest_finish = nt.t;
+            }
+            else if (dir == LengthBranchDirection::GEq && nt.t > earliest_finish)
+            {
+                earliest_finish = nt.t;
+            }
+        }
+        else if (dir == LengthBranchDirection::LEq)
+        {
+            // Don't use the vertex.
+            for (Time t = nt.t; t < astar.max_path_length(); ++t)
+            {
+                const auto prev_time = t - 1;
+                {
+                    const auto n = map.get_south(nt.n);
+                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                    penalties.north = NAN;
+                }
+                {
+                    const auto n = map.get_north(nt.n);
+                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                    penalties.south = NAN;
+                }
+                {
+                    const auto n = map.get_west(nt.n);
+                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                    penalties.east = NAN;
+                }
+                {
+                    const auto n = map.get_east(nt.n);
+                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                    penalties.west = NAN;
+                }
+                {
+                    const auto n = map.get_wait(nt.n);
+                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
+                    penalties.wait = NAN;
+                }
+            }
+        }
+    }
+    debug_assert(latest_finish >= segments.back().t);
+
+    // Start timer.
+#ifdef PRINT_DEBUG
+    const auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+
+    // Solve each segment.
+    size_t idx = 0;
+    for (; idx < segments.size() - 1; ++idx)
+    {
+        // Get the start and goal of this segment.
+        const auto segment_start = segments[idx];
+        const auto segment_goal = segments[idx + 1];
+
+        // Print.
+#ifdef PRINT_DEBUG
+        {
+            const auto [x1, y1] = map.get_xy(segments[idx].n);
+            const auto [x2, y2] = map.get_xy(segments[idx + 1].n);
+            debugln("   Solving segment {} for agent {} from ({},{}) at {} to ({},{}) at {}",
+                    idx, a, x1, y1, segments[idx].t, x2, y2, segments[idx + 1].t);
+        }
+#endif
+
+        // Solve.
+        const auto max_cost = agent_part_dual[a] - path_cost;
+        const auto [segment, segment_cost] = astar.solve<is_farkas>(segment_start,
+                                                                    segment_goal.n,
+                                                                    segment_goal.t,
+                                                                    segment_goal.t,
+                                                                    max_cost);
+
+        // Give up on this agent if no path is found.
+        if (segment.empty())
+        {
+            path.clear();
+            return;
+        }
+
+        // Get the solution.
+        path_cost += segment_cost;
+        for (auto it = segment.begin(); it != segment.end() - 1; ++it)
+        {
+            const auto d = get_direction(*it, *(it + 1), map);
+            path.push_back(Edge{it->n, d});
+        }
+    }
+
+    // Solve from the last segment to the goal.
+    {
+        // Get the start and goal of this segment.
+        const auto segment_start = segments[idx];
+
+        // Modify edge costs for vertex conflicts at the goal after the agent has completed its
+        // path. Incur a penalty for staying at the goal.
+        for (const auto& [nt, dual] : problem.vertex_conflicts)
+            if (nt.n == goal)
+            {
+                // Add the penalty if the a1 finishes before time t. The timestep of the
+                // conflict is accounted for in the global edge duals, so this loop has
+                // terminal condition < instead of <=.
+                if (static_cast<Time>(time_finish_penalties.size()) < nt.t)
+                {
+                    time_finish_penalties.resize(nt.t);
+                }
+                for (Time t = 0; t < nt.t; ++t)
+                {
+                    time_finish_penalties[t] -= dual;
+                }
+            }
+
+        // Modify edge costs for goal conflicts. If a1 finishes at or before time t, incur the
+        // penalty.
+#ifdef USE_GOAL_CONFLICTS
+        for (const auto& [a1, a2, nt, dual] : problem.goal_conflicts)
+            if (a == a1)
+            {
+                debug_assert(nt.n == goal);
+
+                if (static_cast<Time>(time_finish_penalties.size()) < nt.t + 1)
+                {
+                    time_finish_penalties.resize(nt.t + 1);
+                }
+                for (Time t = 0; t <= nt.t; ++t)
+                {
+                    time_finish_penalties[t] -= dual;
+                }
+            }
+#endif
+
+        // Print.
+#ifdef PRINT_DEBUG
+        {
+            const auto [x1, y1] = map.get_xy(segments[idx].n);
+            const auto [x2, y2] = map.get_xy(goal);
+            debugln("   Solving last segment {} for agent {} from ({},{}) at {} to "
+                    "({},{})",
+                    idx, a, x1, y1, segments[idx].t, x2, y2);
+        }
+#endif
+
+        // Solve.
+        const auto max_cost = agent_part_dual[a] - path_cost;
+        const auto [segment, segment_cost] = astar.solve<is_farkas>(segment_start,
+                                                                    goal,
+                                                                    earliest_finish,
+                                                                    latest_finish,
+                                                                    max_cost);
+
+        // Give up on this agent if no path is found. Without branching on the vertices of
+        // this agent, no path costs less than the upper bound.
+        if (segment.empty())
+        {
+            if (segments.size() == 1)
+            {
+                min_path_cost = max_cost;
+            }
+            path.clear();
+            return;
+        }
+
+        // Get the solution. Without branching on the vertices of this agent, the path is
+        // the shortest.
+        path_cost += segment_cost;
+        if (segments.size() == 1)
+        {
+            min_path_cost = path_cost;
+        }
+        for (auto it = segment.begin(); it != segment.end(); ++it)
+        {
+            const auto d = it != segment.end() - 1 ?
+                           get_direction(*it, *(it + 1), map) :
+                           Direction::INVALID;
+            path.push_back(Edge{it->n, d});
+        }
+    }
+
+    // End timer.
+#ifdef PRINT_DEBUG
+    const auto end_time = std::chrono::high_resolution_clock::now();
+    const auto duration =
+        std::chrono::duration<double>(end_time - start_time).count();
+    debugln("      Agent {} done in {:.4f} seconds", a, duration);
+#endif
+}
+
 static
 SCIP_RETCODE run_trufflehog_pricer(
     SCIP* scip,             // SCIP
@@ -299,13 +930,12 @@ SCIP_RETCODE run_trufflehog_pricer(
     auto length_branching_conss = SCIPconshdlrGetConss(pricerdata->length_branching_conshdlr);
     debug_assert(n_length_branching_conss == 0 || length_branching_conss);
 
-    // Get solver.
-    auto& astar = SCIPprobdataGetAStar(probdata);
-    auto& restab = astar.reservation_table();
-    auto& edge_penalties = astar.edge_penalties();
-#ifdef USE_GOAL_CONFLICTS
-    auto& goal_crossings = astar.goal_crossings();
-#endif
+    // Get solvers, one for each pricing thread.
+    Vector<AStar*> astars{&SCIPprobdataGetAStar(probdata)};
+    for (auto& astar : pricerdata->astars)
+    {
+        astars.push_back(astar.get());
+    }
     static_assert(std::numeric_limits<Cost>::has_quiet_NaN);
 
     // Print used paths.
@@ -391,6 +1021,9 @@ SCIP_RETCODE run_trufflehog_pricer(
 //        return SCIP_OKAY;
 //    }
 
+    // Gather the master problem data for pricing.
+    PricingProblem problem(map.size());
+
     // Find the makespan.
     Time makespan = 0;
     for (auto var : vars)
@@ -404,6 +1037,7 @@ SCIP_RETCODE run_trufflehog_pricer(
         if (path_length > makespan)
             makespan = path_length;
     }
+    problem.makespan = makespan;
 
     // Print dual values.
 #ifdef PRINT_DEBUG
@@ -436,9 +1070,63 @@ SCIP_RETCODE run_trufflehog_pricer(
                              SCIPgetDualsolSetppc(scip, cons);
         debug_assert(SCIPisGE(scip, agent_part_dual[a], 0.0));
     }
+    problem.agent_part_dual = agent_part_dual;
+
+    // Carry the lower bounds on the path costs over from the previous round at this node.
+    // A path pays the negated dual value of every row it is in, so its cost falls by at
+    // most the increase of these dual values, weighted by its coefficients.
+    auto& min_path_cost = pricerdata->min_path_cost;
+    auto& prev_duals = pricerdata->prev_duals;
+    if (pricerdata->warm_start)
+    {
+        // Forget the bounds of other nodes, which have different branching decisions.
+        const auto node = SCIPnodeGetNumber(SCIPgetCurrentNode(scip));
+        if (node != pricerdata->warm_start_node)
+        {
+            pricerdata->warm_start_node = node;
+            std::fill(min_path_cost.begin(),
+                      min_path_cost.end(),
+                      -std::numeric_limits<SCIP_Real>::infinity());
+            prev_duals.clear();
+        }
+
+        // Lower the bounds.
+        SCIP_Real all_agents_decrease = 0.0;
+        for (const auto& [row, prev_dual, a1, a2, max_coeff] : prev_duals)
+        {
+            // Get the dual value. Ignore it like the penalties do if it is almost zero.
+            auto dual = is_farkas ? SCIProwGetDualfarkas(row) : SCIProwGetDualsol(row);
+            if (!SCIPisLT(scip, dual, 0.0))
+            {
+                dual = 0.0;
+            }
+
+            // Lower the bounds of the agents in the row.
+            const auto decrease = max_coeff * std::max(dual - prev_dual, 0.0);
+            if (a1 < 0)
+            {
+                all_agents_decrease += decrease;
+            }
+            else
+            {
+                min_path_cost[a1] -= decrease;
+                if (a2 >= 0)
+                {
+                    min_path_cost[a2] -= decrease;
+                }
+            }
+        }
+        for (Agent a = 0; a < N; ++a)
+        {
+            min_path_cost[a] -= all_agents_decrease;
+        }
+
+        // Store the dual values of this round below.
+        prev_duals.clear();
+    }
 
     // Make edge penalties for all agents.
-    EdgePenalties global_edge_penalties;
+    auto& global_edge_penalties = problem.global_edge_penalties;
 
     // Input dual values for vertex conflicts.
     for (const auto [row, nt] : vertex_conflicts_conss)
@@ -447,6 +1135,13 @@ SCIP_RETCODE run_trufflehog_pricer(
         debug_assert(SCIPisLE(scip, dual, 0.0));
         if (SCIPisLT(scip, dual, 0.0))
         {
+            // Store the dual for the penalties at the goals.
+            problem.vertex_conflicts.emplace_back(nt, dual);
+            if (pricerdata->warm_start)
+            {
+                prev_duals.push_back({row, dual, -1, -1, 1});
+            }
+
             // Add the dual variable value to the edges leading into the vertex.
             const auto t = nt.t - 1;
             {
@@ -484,6 +1179,12 @@ SCIP_RETCODE run_trufflehog_pricer(
         debug_assert(SCIPisLE(scip, dual, 0.0));
         if (SCIPisLT(scip, dual, 0.0))
         {
+            // Store the dual.
+            if (pricerdata->warm_start)
+            {
+                prev_duals.push_back({row, dual, -1, -1, 1});
+            }
+
             // Add the dual variable value to the edges.
             for (const auto e : edges)
             {
@@ -493,563 +1194,197 @@ SCIP_RETCODE run_trufflehog_pricer(
         }
     }
 
-    // Create order of agents to solve.
-    auto order = pricerdata->order;
-    calculate_agents_order(scip, probdata, pricerdata);
-    for (Agent a = 0; a < N; ++a)
-    {
-        pricerdata->price_priority[a] /= PRICE_PRIORITY_DECAY_FACTOR;
-    }
+    // Store the edge penalties densely if most node-times have one. The solvers copy the
+    // layout.
+    global_edge_penalties.choose_layout();
 
-    // Price each agent.
-#ifdef PRINT_DEBUG
-    Int nb_new_cols = 0;
-#endif
-    bool found = false;
-    for (Int order_idx = 0;
-         order_idx < N && (!found || order[order_idx].must_price) && !SCIPisStopped(scip);
-         ++order_idx)
+    // Input dual values for two-agent robust cuts.
+    for (const auto& cut : two_agent_robust_cuts)
     {
-        // Get agent.
-        const auto a = order[order_idx].a;
-        const auto start = agents[a].start;
-        const auto goal = agents[a].goal;
-        SCIP_Real path_cost = 0.0;
-        Vector<Edge> path;
-
-        // Clear previous run.
-        auto& time_finish_penalties = astar.time_finish_penalties();
-        time_finish_penalties.clear();
-
-        // Set up reservation table. Reserve vertices in use by all other agents and
-        // reserve vertices in all new paths.
-        restab.clear_reservations();
-        for (auto var : vars)
-        {
-            // Make reservations.
-            debug_assert(var);
-            const auto var_val = SCIPgetSolVal(scip, nullptr, var);
-            if (SCIPisPositive(scip, var_val))
-            {
-                // Reserve if different agent.
-                auto vardata = SCIPvarGetData(var);
-                const auto path_a = SCIPvardataGetAgent(vardata);
-                if (path_a != a)
-                {
-                    // Get the path.
-                    const auto path_length = SCIPvardataGetPathLength(vardata);
-                    const auto path = SCIPvardataGetPath(vardata);
-
-                    // Update reservation table.
-                    Time t = 0;
-                    {
-                        const auto n = path[t].n;
-                        restab.reserve(NodeTime{n, t});
-                        restab.reserve(NodeTime{n, t + 1});
-                    }
-                    for (t = 1; t < path_length; ++t)
-                    {
-                        const auto n = path[t].n;
-                        restab.reserve(NodeTime{n, t - 1});
-                        restab.reserve(NodeTime{n, t});
-                        restab.reserve(NodeTime{n, t + 1});
-                    }
-                    const auto n = path[path_length - 1].n;
-                    for (++t; t < makespan; ++t)
-                    {
-                        restab.reserve(NodeTime{n, t});
-                    }
-                }
-            }
-        }
-        for (Int idx = 0; idx < order_idx; ++idx)
+        const auto dual = is_farkas ?
+                          SCIProwGetDualfarkas(cut.row()) :
+                          SCIProwGetDualsol(cut.row());
+        debug_assert(SCIPisLE(scip, dual, 0.0));
+        if (SCIPisLT(scip, dual, 0.0))
         {
-            auto var = order[idx].new_var;
-            if (var)
+            problem.two_agent_robust_cuts.emplace_back(&cut, dual);
+            if (pricerdata->warm_start)
             {
-                // Get the path.
-                auto vardata = SCIPvarGetData(var);
-                debug_assert(SCIPvardataGetAgent(vardata) != a);
-                const auto path_length = SCIPvardataGetPathLength(vardata);
-                const auto path = SCIPvardataGetPath(vardata);
-
-                // Update reservation table.
-                Time t = 0;
-                {
-                    const auto n = path[t].n;
-                    restab.reserve(NodeTime{n, t});
-                    restab.reserve(NodeTime{n, t + 1});
-                }
-                for (t = 1; t < path_length; ++t)
-                {
-                    const auto n = path[t].n;
-                    restab.reserve(NodeTime{n, t - 1});
-                    restab.reserve(NodeTime{n, t});
-                    restab.reserve(NodeTime{n, t + 1});
-                }
-                const auto n = path[path_length - 1].n;
-                for (++t; t < makespan; ++t)
-                {
-                    restab.reserve(NodeTime{n, t});
-                }
+                prev_duals.push_back({cut.row(), dual, cut.a1(), cut.a2(), get_max_coeff(cut)});
             }
         }
+    }
 
-        // Modify edge costs for two-agent robust cuts.
-        edge_penalties = global_edge_penalties;
-        for (const auto& cut : two_agent_robust_cuts)
-            if (a == cut.a1() || a == cut.a2())
-            {
-                const auto dual = is_farkas ?
-                                  SCIProwGetDualfarkas(cut.row()) :
-                                  SCIProwGetDualsol(cut.row());
-                debug_assert(SCIPisLE(scip, dual, 0.0));
-                if (SCIPisLT(scip, dual, 0.0))
-                {
-                    // Add the dual variable value to the edges.
-                    if (cut.is_same_time())
-                    {
-                        const auto t = cut.t();
-                        for (auto [it, end] = cut.edges(a); it != end; ++it)
-                        {
-                            const auto e = *it;
-                            auto& penalties = edge_penalties.get_edge_penalties(e.n, t);
-                            penalties.d[e.d] -= dual;
-                        }
-                    }
-                    else
-                    {
-                        for (auto [it, end] = cut.edge_times(a); it != end; ++it)
-                        {
-                            const auto n = it->n;
-                            const auto d = it->d;
-                            const auto t = it->t;
-                            auto& penalties = edge_penalties.get_edge_penalties(n, t);
-                            penalties.d[d] -= dual;
-                        }
-                    }
-                }
-            }
-
-        // Add goal crossings. If a2 uses the goal of a1 at or after time t, incur the penalty.
+    // Input dual values for goal conflicts.
 #ifdef USE_GOAL_CONFLICTS
-        goal_crossings.clear();
-        for (const auto& [row, a1, a2, nt] : goal_conflicts_conss)
-            if (a == a2)
-            {
-                const auto dual = is_farkas ?
-                                  SCIProwGetDualfarkas(row) :
-                                  SCIProwGetDualsol(row);
-                debug_assert(SCIPisLE(scip, dual, 0.0));
-                if (SCIPisLT(scip, dual, 0.0))
-                {
-                    auto& goal = goal_crossings.emplace_back();
-                    goal.dual = dual;
-                    goal.nt = nt;
-                }
-            }
-#endif
-
-        // Modify edge costs for vertex branching decisions.
-        Vector<NodeTime> segments;
-        segments.push_back(NodeTime{start, 0});
-        for (Int c = 0; c < n_vertex_branching_conss; ++c)
+    for (const auto& [row, a1, a2, nt] : goal_conflicts_conss)
+    {
+        const auto dual = is_farkas ? SCIProwGetDualfarkas(row) : SCIProwGetDualsol(row);
+        debug_assert(SCIPisLE(scip, dual, 0.0));
+        if (SCIPisLT(scip, dual, 0.0))
         {
-            // Get the constraint.
-            auto cons = vertex_branching_conss[c];
-            debug_assert(cons);
-
-            // Ignore constraints that are not active since these are not on the current
-            // active path of the search tree.
-            if (!SCIPconsIsActive(cons))
-                continue;
-
-            // Enforce the decision.
-            const auto branch_a = SCIPgetVertexBranchingAgent(cons);
-            const auto dir = SCIPgetVertexBranchingDirection(cons);
-            const auto nt = SCIPgetVertexBranchingNodeTime(cons);
-            if (branch_a == a && dir == VertexBranchDirection::Use)
+            problem.goal_conflicts.emplace_back(a1, a2, nt, dual);
+            if (pricerdata->warm_start)
             {
-                // End the path segment.
-                segments.push_back(nt);
-            }
-            else if (branch_a == a || dir == VertexBranchDirection::Use)
-            {
-                // Don't use the vertex.
-                const auto prev_time = nt.t - 1;
-                {
-                    const auto n = map.get_south(nt.n);
-                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                    penalties.north = NAN;
-                }
-                {
-                    const auto n = map.get_north(nt.n);
-                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                    penalties.south = NAN;
-                }
-                {
-                    const auto n = map.get_west(nt.n);
-                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                    penalties.east = NAN;
-                }
-                {
-                    const auto n = map.get_east(nt.n);
-                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                    penalties.west = NAN;
-                }
-                {
-                    const auto n = map.get_wait(nt.n);
-                    auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                    penalties.wait = NAN;
-                }
+                prev_duals.push_back({row, dual, a1, a2, 1});
             }
         }
+    }
+#endif
 
-        // Modify edge costs for wait branching decisions.
-        Time earliest_finish = 0;
-//        for (Int c = 0; c < n_wait_branching_conss; ++c)
-//        {
-//            // Get the constraint.
-//            auto cons = wait_branching_conss[c];
-//            debug_assert(cons);
-//
-//            // Ignore constraints that are not active since these are not on the current
-//            // active path of the search tree or constraints for a different agent.
-//            if (!SCIPconsIsActive(cons) || SCIPgetWaitBranchingAgent(cons) != a)
-//                continue;
-//
-//            // Enforce the decision.
-//            const auto dir = SCIPgetWaitBranchingDirection(cons);
-//            const auto t = SCIPgetWaitBranchingTime(cons);
-//            if (dir == WaitBranchDirection::MustWait)
-//            {
-//                for (Coord x = 0; x < width; ++x)
-//                    for (Coord y = 0; y < height; ++y)
-//                    {
-//                        const auto n = map.get_id(x, y);
-//                        auto& duals = edge_duals.get_edge_duals(n, t);
-//                        duals.north = NAN;
-//                        duals.south = NAN;
-//                        duals.east = NAN;
-//                        duals.west = NAN;
-//                    }
-//
-//                if (t + 1 > earliest_finish)
-//                    earliest_finish = t + 1;
-//            }
-//            else
-//            {
-//                for (Coord x = 0; x < width; ++x)
-//                    for (Coord y = 0; y < height; ++y)
-//                    {
-//                        const auto n = map.get_id(x, y);
-//                        auto& duals = edge_duals.get_edge_duals(n, t);
-//                        duals.wait = NAN;
-//                    }
-//            }
-//            edge_duals_changed = true;
-//        }
-
-        // Sort segments by time.
-        std::sort(segments.begin(), segments.end(), [](const auto& a, const auto& b)
-        {
-            return a.t < b.t;
-        });
-#ifdef DEBUG
-        for (size_t idx = 0; idx < segments.size() - 1; ++idx)
+    // Input branching decisions. Ignore constraints that are not active since these are
+    // not on the current active path of the search tree.
+    for (Int c = 0; c < n_vertex_branching_conss; ++c)
+    {
+        auto cons = vertex_branching_conss[c];
+        debug_assert(cons);
+        if (SCIPconsIsActive(cons))
         {
-            debug_assert(segments[idx].t < segments[idx + 1].t);
+            problem.vertex_branching.emplace_back(SCIPgetVertexBranchingAgent(cons),
+                                                  SCIPgetVertexBranchingDirection(cons),
+                                                  SCIPgetVertexBranchingNodeTime(cons));
         }
-#endif
-
-        // Modify edge costs for length branching decisions.
-        debug_assert(astar.max_path_length() >= 1);
-        Time latest_finish = astar.max_path_length() - 1;
-        for (Int c = 0; c < n_length_branching_conss; ++c)
+    }
+    for (Int c = 0; c < n_length_branching_conss; ++c)
+    {
+        auto cons = length_branching_conss[c];
+        debug_assert(cons);
+        if (SCIPconsIsActive(cons))
         {
-            // Get the constraint.
-            auto cons = length_branching_conss[c];
-            debug_assert(cons);
-
-            // Ignore constraints that are not active since these are not on the current
-            // active path of the search tree.
-            if (!SCIPconsIsActive(cons))
-                continue;
+            problem.length_branching.emplace_back(SCIPgetLengthBranchingAgent(cons),
+                                                  SCIPgetLengthBranchingDirection(cons),
+                                                  SCIPgetLengthBranchingNodeTime(cons));
+        }
+    }
 
-            // Enforce the decision if the same agent. Disable crossing if different
-            // agent.
-            const auto branch_a = SCIPgetLengthBranchingAgent(cons);
-            const auto dir = SCIPgetLengthBranchingDirection(cons);
-            const auto nt = SCIPgetLengthBranchingNodeTime(cons);
-            if (branch_a == a)
-            {
-                if (dir == LengthBranchDirection::LEq && nt.t < latest_finish)
-                {
-                    latest_finish = nt.t;
-                }
-                else if (dir == LengthBranchDirection::GEq && nt.t > earliest_finish)
-                {
-                    earliest_finish = nt.t;
-                }
-            }
-            else if (dir == LengthBranchDirection::LEq)
+    // Compute h to the vertices that end path segments under vertex branching. Do this
+    // before pricing since the pricing threads only read h.
+    {
+        Vector<Node> segment_goals;
+        for (const auto& [branch_a, dir, nt] : problem.vertex_branching)
+            if (dir == VertexBranchDirection::Use)
             {
-                // Don't use the vertex.
-                for (Time t = nt.t; t < astar.max_path_length(); ++t)
-                {
-                    const auto prev_time = t - 1;
-                    {
-                        const auto n = map.get_south(nt.n);
-                        auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                        penalties.north = NAN;
-                    }
-                    {
-                        const auto n = map.get_north(nt.n);
-                        auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                        penalties.south = NAN;
-                    }
-                    {
-                        const auto n = map.get_west(nt.n);
-                        auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                        penalties.east = NAN;
-                    }
-                    {
-                        const auto n = map.get_east(nt.n);
-                        auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                        penalties.west = NAN;
-                    }
-                    {
-                        const auto n = map.get_wait(nt.n);
-                        auto& penalties = edge_penalties.get_edge_penalties(n, prev_time);
-                        penalties.wait = NAN;
-                    }
-                }
+                segment_goals.push_back(nt.n);
             }
+        SCIPprobdataGetHeuristic(probdata).compute_h(segment_goals, astars.size());
+    }
+
+    // Reserve the paths in use. Each agent avoids those of the other agents.
+    for (auto var : vars)
+    {
+        debug_assert(var);
+        const auto var_val = SCIPgetSolVal(scip, nullptr, var);
+        if (SCIPisPositive(scip, var_val))
+        {
+            auto vardata = SCIPvarGetData(var);
+            problem.reserved_paths.push_back({SCIPvardataGetAgent(vardata),
+                                              SCIPvardataGetPathLength(vardata),
+                                              SCIPvardataGetPath(vardata)});
         }
-        debug_assert(latest_finish >= segments.back().t);
+    }
 
-        // Print time constraints.
-//#ifdef PRINT_DEBUG
-//        {
-//            debugln("   Modified edge costs for agent {}", a);
-//            const uint32_t size = gm.height() * gm.width();
-//            for (uint32_t node1 = 0; node1 < size; ++node1)
-//            {
-//                uint32_t x, y;
-//                gm.to_unpadded_xy(node1, x, y);
-//                const auto& constraints = time_cons.get_constraint_set(node1);
-//                for (const auto& constraint : constraints)
-//                {
-//                    const auto t = constraint.timestep_;
-//                    if (constraint.e_[Direction::NORTH] != 1)
-//                    {
-//                        debugln("      (({},{}),({},{})) time {} edge cost {:.4f}",
-//                                x, y, x, y - 1, t,
-//                                constraint.e_[Direction::NORTH]);
-//                    }
-//                    if (constraint.e_[Direction::SOUTH] != 1)
-//                    {
-//                        debugln("      (({},{}),({},{})) time {} edge cost {:.4f}",
-//                                x, y, x, y + 1, t,
-//                                constraint.e_[Direction::SOUTH]);
-//                    }
-//                    if (constraint.e_[Direction::EAST] != 1)
-//                    {
-//                        debugln("      (({},{}),({},{})) time {} edge cost {:.4f}",
-//                                x, y, x + 1, y, t,
-//                                constraint.e_[Direction::EAST]);
-//                    }
-//                    if (constraint.e_[Direction::WEST] != 1)
-//                    {
-//                        debugln("      (({},{}),({},{})) time {} edge cost {:.4f}",
-//                                x, y, x - 1, y, t,
-//                                constraint.e_[Direction::WEST]);
-//                    }
-//                    if (constraint.e_[Direction::WAIT] != 1)
-//                    {
-//                        debugln("      (({},{}),({},{})) time {} edge cost {:.4f}",
-//                                x, y, x, y, t,
-//                                constraint.e_[Direction::WAIT]);
-//                    }
-//                }
-//            }
-//        }
-//#endif
+    // Create order of agents to solve.
+    auto order = pricerdata->order;
+    calculate_agents_order(scip, probdata, pricerdata);
+    for (Agent a = 0; a < N; ++a)
+    {
+        pricerdata->price_priority[a] /= PRICE_PRIORITY_DECAY_FACTOR;
+    }
 
-        // Start timer.
+    // Price the agents in batches of one agent per thread. The agents of a batch are
+    // priced concurrently and avoid the new paths of earlier batches. When warm-starting,
+    // skip the agents whose paths cannot have negative reduced cost.
 #ifdef PRINT_DEBUG
-        const auto start_time = std::chrono::high_resolution_clock::now();
+    Int nb_new_cols = 0;
 #endif
-
-        // Solve each segment.
-        size_t idx = 0;
-        for (; idx < segments.size() - 1; ++idx)
+    const auto nb_threads = static_cast<Int>(astars.size());
+    Vector<Int> batch;
+    Vector<Vector<Edge>> paths(nb_threads);
+    Vector<SCIP_Real> path_costs(nb_threads);
+    Vector<SCIP_Real> min_path_costs(nb_threads);
+    auto& workers = *pricerdata->workers;
+    bool found = false;
+    Int order_idx = 0;
+    while (order_idx < N && (!found || order[order_idx].must_price) && !SCIPisStopped(scip))
+    {
+        // Choose the agents of the batch.
+        batch.clear();
+        for (; order_idx < N && static_cast<Int>(batch.size()) < nb_threads; ++order_idx)
         {
-            // Get the start and goal of this segment.
-            const auto segment_start = segments[idx];
-            const auto segment_goal = segments[idx + 1];
-
-            // Print.
-#ifdef PRINT_DEBUG
+            const auto a = order[order_idx].a;
+            if (pricerdata->warm_start &&
+                SCIPisSumGE(scip, min_path_cost[a] - agent_part_dual[a], 0.0))
             {
-                const auto [x1, y1] = map.get_xy(segments[idx].n);
-                const auto [x2, y2] = map.get_xy(segments[idx + 1].n);
-                debugln("   Solving segment {} for agent {} from ({},{}) at {} to ({},{}) at {}",
-                        idx, a, x1, y1, segments[idx].t, x2, y2, segments[idx + 1].t);
-            }
-#endif
-
-            // Solve.
-            const auto max_cost = agent_part_dual[a] - path_cost;
-            const auto [segment, segment_cost] = astar.solve<is_farkas>(segment_start,
-                                                                        segment_goal.n,
-                                                                        segment_goal.t,
-                                                                        segment_goal.t,
-                                                                        max_cost);
-
-            // Advance to the next agent if no path is found.
-            if (segment.empty())
-            {
-                goto NEXT_AGENT;
-            }
-
-            // Get the solution.
-            path_cost += segment_cost;
-            for (auto it = segment.begin(); it != segment.end() - 1; ++it)
-            {
-                const auto d = get_direction(*it, *(it + 1), map);
-                path.push_back(Edge{it->n, d});
+                debugln("      Skipping agent {} with reduced cost at least {:.6f}",
+                        a,
+                        min_path_cost[a] - agent_part_dual[a]);
+                continue;
             }
+            batch.push_back(order_idx);
         }
-
-        // Solve from the last segment to the goal.
+        const auto batch_size = static_cast<Int>(batch.size());
+        if (batch_size == 0)
         {
-            // Get the start and goal of this segment.
-            const auto segment_start = segments[idx];
-
-            // Modify edge costs for vertex conflicts at the goal after the agent has completed its
-            // path. Incur a penalty for staying at the goal.
-            for (const auto [row, nt] : vertex_conflicts_conss)
-                if (nt.n == goal)
-                {
-                    const auto dual = is_farkas ?
-                                      SCIProwGetDualfarkas(row) :
-                                      SCIProwGetDualsol(row);
-                    debug_assert(SCIPisLE(scip, dual, 0.0));
-                    if (SCIPisLT(scip, dual, 0.0))
-                    {
-                        // Add the penalty if the a1 finishes before time t. The timestep of the
-                        // conflict is accounted for in the global edge duals, so this loop has
-                        // terminal condition < instead of <=.
-                        if (static_cast<Time>(time_finish_penalties.size()) < nt.t)
-                        {
-                            time_finish_penalties.resize(nt.t);
-                        }
-                        for (Time t = 0; t < nt.t; ++t)
-                        {
-                            time_finish_penalties[t] -= dual;
-                        }
-                    }
-                }
-
-            // Modify edge costs for goal conflicts. If a1 finishes at or before time t, incur the
-            // penalty.
-#ifdef USE_GOAL_CONFLICTS
-            for (const auto& [row, a1, a2, nt] : goal_conflicts_conss)
-                if (a == a1)
-                {
-                    debug_assert(nt.n == goal);
-
-                    const auto dual = is_farkas ?
-                                      SCIProwGetDualfarkas(row) :
-                                      SCIProwGetDualsol(row);
-                    debug_assert(SCIPisLE(scip, dual, 0.0));
-                    if (SCIPisLT(scip, dual, 0.0))
-                    {
-                        if (static_cast<Time>(time_finish_penalties.size()) < nt.t + 1)
-                        {
-                            time_finish_penalties.resize(nt.t + 1);
-                        }
-                        for (Time t = 0; t <= nt.t; ++t)
-                        {
-                            time_finish_penalties[t] -= dual;
-                        }
-                    }
-                }
-#endif
-
-            // Print.
-#ifdef PRINT_DEBUG
-            {
-                const auto [x1, y1] = map.get_xy(segments[idx].n);
-                const auto [x2, y2] = map.get_xy(goal);
-                debugln("   Solving last segment {} for agent {} from ({},{}) at {} to "
-                        "({},{})",
-                        idx, a, x1, y1, segments[idx].t, x2, y2);
-            }
-#endif
+            break;
+        }
 
-            // Solve.
-            const auto max_cost = agent_part_dual[a] - path_cost;
-            const auto [segment, segment_cost] = astar.solve<is_farkas>(segment_start,
-                                                                        goal,
-                                                                        earliest_finish,
-                                                                        latest_finish,
-                                                                        max_cost);
+        // Price the batch.
+        workers.run(batch_size, [&](const Int idx)
+        {
+            price_agent<is_farkas>(problem,
+                                   map,
+                                   agents,
+                                   *astars[idx],
+                                   order[batch[idx]].a,
+                                   paths[idx],
+                                   path_costs[idx],
+                                   min_path_costs[idx]);
+        });
 
-            // Advance to next agent if no path is found.
-            if (segment.empty())
+        // Add the columns in the order of the agents.
+        for (Int idx = 0; idx < batch_size; ++idx)
+        {
+            // Store the lower bound on the path cost for the next round.
+            const auto a = order[batch[idx]].a;
+            if (pricerdata->warm_start)
             {
-                goto NEXT_AGENT;
+                min_path_cost[a] = min_path_costs[idx];
             }
 
-            // Get the solution.
-            path_cost += segment_cost;
-            for (auto it = segment.begin(); it != segment.end(); ++it)
+            // Add a column only if the path has negative reduced cost.
+            const auto& path = paths[idx];
+            const auto path_cost = path_costs[idx];
+            if (!path.empty() && SCIPisSumLT(scip, path_cost - agent_part_dual[a], 0.0))
             {
-                const auto d = it != segment.end() - 1 ?
-                               get_direction(*it, *(it + 1), map) :
-                               Direction::INVALID;
-                path.push_back(Edge{it->n, d});
-            }
-        }
-
-        // Add a column only if the path has negative reduced cost.
-        if (SCIPisSumLT(scip, path_cost - agent_part_dual[a], 0.0))
-        {
-            // Print.
-            debugln("      Found path with length {}, reduced cost {:.6f} ({})",
-                    path.size(),
-                    path_cost - agent_part_dual[a],
-                    format_path(probdata, path.size(), path.data()));
-
-            // Add column.
-            SCIP_VAR* var = nullptr;
-            SCIP_CALL(SCIPprobdataAddPricedVar(scip,
-                                               probdata,
-                                               a,
-                                               path.size(),
-                                               path.data(),
-                                               &var));
-            debug_assert(var);
-            found = true;
-            order[order_idx].new_var = var;
-            pricerdata->price_priority[a]++;
+                // Print.
+                debugln("      Found path with length {}, reduced cost {:.6f} ({})",
+                        path.size(),
+                        path_cost - agent_part_dual[a],
+                        format_path(probdata, path.size(), path.data()));
+
+                // Add column.
+                SCIP_VAR* var = nullptr;
+                SCIP_CALL(SCIPprobdataAddPricedVar(scip,
+                                                   probdata,
+                                                   a,
+                                                   path.size(),
+                                                   path.data(),
+                                                   &var));
+                debug_assert(var);
+                found = true;
+                order[batch[idx]].new_var = var;
+                pricerdata->price_priority[a]++;
 #ifdef PRINT_DEBUG
-            nb_new_cols++;
+                nb_new_cols++;
 #endif
-        }
 
-        // End of this agent.
-        NEXT_AGENT:;
-
-        // End timer.
-#ifdef PRINT_DEBUG
-        const auto end_time = std::chrono::high_resolution_clock::now();
-        const auto duration =
-            std::chrono::duration<double>(end_time - start_time).count();
-        debugln("      Done in {:.4f} seconds", duration);
-#endif
+                // Reserve the new path for the next batches.
+                auto vardata = SCIPvarGetData(var);
+                problem.reserved_paths.push_back({a,
+                                                  SCIPvardataGetPathLength(vardata),
+                                                  SCIPvardataGetPath(vardata)});
+            }
+        }
     }
 
     // Print.
@@ -1093,8 +1428,30 @@ SCIP_RETCODE SCIPincludePricerTruffleHog(
 
     // Set callbacks.
     SCIP_CALL(SCIPsetPricerInit(scip, pricer, pricerTruffleHogInit));
+    SCIP_CALL(SCIPsetPricerExitsol(scip, pricer, pricerTruffleHogExitsol));
     SCIP_CALL(SCIPsetPricerFree(scip, pricer, pricerTruffleHogFree));
 
+    // Add parameters.
+    SCIP_CALL(SCIPaddIntParam(scip,
+                              "pricers/" PRICER_NAME "/threads",
+                              "number of agents to price concurrently (0: one per hardware thread)",
+                              nullptr,
+                              FALSE,
+                              DEFAULT_THREADS,
+                              0,
+                              INT_MAX,
+                              nullptr,
+                              nullptr));
+    SCIP_CALL(SCIPaddBoolParam(scip,
+                               "pricers/" PRICER_NAME "/warmstart",
+                               "skip agents whose reduced cost cannot be negative given the "
+                               "previous pricing round at the same node",
+                               nullptr,
+                               FALSE,
+                               DEFAULT_WARM_START,
+                               nullptr,
+                               nullptr));
+
     // Done.
     return SCIP_OKAY;
 }
@@ -52,6 +52,7 @@ Author: Edward Lam <ed@ed-lam.com>
 #include "Constraint_VertexBranching.h"
 #include "Constraint_WaitBranching.h"
 #include "Constraint_LengthBranching.h"
+#include <thread>
 
 // Problem data
 struct SCIP_ProbData
@@ -62,6 +63,7 @@ struct SCIP_ProbData
 
     // Model data
     SCIP_PricerData* pricerdata;                        // Pricer data
+    SharedPtr<Heuristic> heuristic;                     // Distances to the goals of the pricing solvers
     SharedPtr<AStar> astar;                             // Pricing solver
 
     // Variables
@@ -117,6 +119,7 @@ SCIP_DECL_PROBTRANS(probtrans)
 
     // Copy model data.
     (*targetdata)->pricerdata = sourcedata->pricerdata;
+    (*targetdata)->heuristic = sourcedata->heuristic;
     (*targetdata)->astar = sourcedata->astar;
 
     // Allocate memory for variables.
@@ -753,6 +756,7 @@ SCIP_RETCODE SCIPprobdataCreate(
     SCIP* scip,                       // SCIP
     const char* probname,             // Problem name
     SharedPtr<Instance>& instance,    // Instance
+    SharedPtr<Heuristic>& heuristic,  // Distances to the goals, computed here
     SharedPtr<AStar>& astar           // Search algorithm
 )
 {
@@ -822,6 +826,7 @@ SCIP_RETCODE SCIPprobdataCreate(
 
     // Copy model data.
     probdata->pricerdata = nullptr;
+    probdata->heuristic = heuristic;
     probdata->astar = astar;
 
     // Create agent partition constraints.
@@ -927,14 +932,16 @@ SCIP_RETCODE SCIPprobdataCreate(
         debug_assert(var);
     }
 
-    // Calculate the longest path length. Do this internally after computing h.
+    // Compute h to every goal in parallel. This also calculates the longest path length.
     {
         const auto& agents = instance->agents;
+        Vector<Node> goals(N);
         for (Agent a = 0; a < N; ++a)
         {
-            const auto goal = agents[a].goal;
-            probdata->astar->compute_h(goal);
+            goals[a] = agents[a].goal;
         }
+        const Int nb_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        heuristic->compute_h(goals, nb_threads);
     }
 
     // Set problem data.
@@ -1153,6 +1160,15 @@ AStar& SCIPprobdataGetAStar(
     return *probdata->astar;
 }
 
+// Get the distances to the goals of the pricing solvers
+Heuristic& SCIPprobdataGetHeuristic(
+    SCIP_ProbData* probdata    // Problem data
+)
+{
+    debug_assert(probdata);
+    return *probdata->heuristic;
+}
+
 // Format path
 String format_path(
     SCIP_ProbData* probdata,    // Problem data
@@ -33,6 +33,7 @@ SCIP_RETCODE SCIPprobdataCreate(
     SCIP* scip,                       // SCIP
     const char* probname,             // Problem name
     SharedPtr<Instance>& instance,    // Instance
+    SharedPtr<Heuristic>& heuristic,  // Distances to the goals, computed here
     SharedPtr<AStar>& astar           // Search algorithm
 );
 
@@ -165,6 +166,11 @@ AStar& SCIPprobdataGetAStar(
     SCIP_ProbData* probdata    // Problem data
 );
 
+// Get the distances to the goals of the pricing solvers
+Heuristic& SCIPprobdataGetHeuristic(
+    SCIP_ProbData* probdata    // Problem data
+);
+
 // Format path
 String format_path(
     SCIP_ProbData* probdata,    // Problem data
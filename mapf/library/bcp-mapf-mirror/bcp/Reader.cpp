@@ -40,10 +40,11 @@ SCIP_RETCODE read_instance(
     auto instance = std::make_shared<Instance>(x, y, obstacles, starts, goals);
 
     // Create pricing solver.
-    auto astar = std::make_shared<AStar>(instance->map);
+    auto heuristic = std::make_shared<Heuristic>(instance->map);
+    auto astar = std::make_shared<AStar>(instance->map, *heuristic);
 
     // Create the problem.
-    SCIP_CALL(SCIPprobdataCreate(scip, "instance_name", instance, astar));
+    SCIP_CALL(SCIPprobdataCreate(scip, "instance_name", instance, heuristic, astar));
 
     // Done.
     return SCIP_OKAY;
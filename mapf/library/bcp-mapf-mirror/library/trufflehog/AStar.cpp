@@ -75,11 +75,11 @@ String make_goal_state_string(const std::byte* const state, const Int nb_goal_cr
 }
 #endif
 
-AStar::AStar(const Map& map)
+AStar::AStar(const Map& map, const Heuristic& heuristic)
     : map_(map),
       label_pool_(),
-      heuristic_(map, label_pool_),
-      edge_penalties_(),
+      heuristic_(heuristic),
+      edge_penalties_(map.size()),
       time_finish_penalties_(),
 #ifdef USE_GOAL_CONFLICTS
       goal_crossings_(),
@@ -87,10 +87,8 @@ AStar::AStar(const Map& map)
       open_(map.size()),
       frontier_without_resources_(),
       h_(nullptr),
-      time_finish_h_()
-#ifdef DEBUG
-    , nb_labels_(0)
-#endif
+      time_finish_h_(),
+      nb_labels_(0)
 {
 }
 
@@ -171,7 +169,7 @@ void AStar::generate_start(const NodeTime start)
     // Create label.
     auto new_label = reinterpret_cast<Label*>(label_pool_.get_label_buffer());
     memset(new_label, 0, label_pool_.label_size());
-    const auto h_to_goal = (*h_)[start.n];
+    const auto h_to_goal = h_[start.n];
     const auto h_to_finish = start.t + h_to_goal < static_cast<Int>(time_finish_h_.size()) ?
                              time_finish_h_[start.t + h_to_goal] :
                              0.0;
@@ -179,9 +177,7 @@ void AStar::generate_start(const NodeTime start)
     new_label->f = h;
     new_label->nt = start.nt;
     new_label->pqueue_index = -1;
-#ifdef DEBUG
     new_label->label_id = nb_labels_++;
-#endif
 
     // Store the label.
     debug_assert(open_.empty());
@@ -227,9 +223,7 @@ void AStar::generate_end(Label* const current, const Cost max_cost)
     new_label->f = new_label->g;
     new_label->nt = nt.nt;
     new_label->pqueue_index = -1;
-#ifdef DEBUG
     new_label->label_id = nb_labels_++;
-#endif
 
     // Check if cost-infeasible.
     if (new_label->g > max_cost)
@@ -291,7 +285,7 @@ void AStar::generate(Label* const current,
     const NodeTime nt(node, new_t);
 
     // Check if time-infeasible.
-    const auto h_to_goal = (*h_)[nt.n];
+    const auto h_to_goal = h_[nt.n];
     if (new_t + h_to_goal > goal_latest)
     {
         // Print.
@@ -320,9 +314,7 @@ void AStar::generate(Label* const current,
     new_label->reserved = reservation_table().is_reserved(nt);
 //    new_label->dominated = false;
     new_label->pqueue_index = -1;
-#ifdef DEBUG
     new_label->label_id = nb_labels_++;
-#endif
 
     // Get number of resources.
 #ifdef USE_GOAL_CONFLICTS
@@ -560,9 +552,9 @@ Pair<Vector<NodeTime>, Cost> AStar::solve_internal(const NodeTime start,
     auto& path = output.first;
     auto& path_cost = output.second;
 
-    // Get h values to the goal node. Compute them if necessary.
+    // Get h values to the goal node.
     debug_assert(heuristic_.max_path_length() >= 1);
-    h_ = &heuristic_.compute_h(goal);
+    h_ = heuristic_.get_h(goal);
 
     // Calculate the default edge cost.
     constexpr IntCost default_cost = is_farkas ? 0 : 1;
@@ -606,6 +598,7 @@ Pair<Vector<NodeTime>, Cost> AStar::solve_internal(const NodeTime start,
     const auto nb_states = nb_goal_crossings;
     label_pool_.reset(sizeof(Label) + (nb_states / CHAR_BIT) + (nb_states % CHAR_BIT != 0));
     open_.clear();
+    nb_labels_ = 0;
     static_assert(without_resources);
     if constexpr (without_resources)
     {
@@ -56,16 +56,10 @@ class AStar
             };
         };
         Int pqueue_index;
-#ifdef DEBUG
         Int label_id;
-#endif
         std::byte state_[0];
     };
-#ifdef DEBUG
     static_assert(sizeof(Label) == 8 + 8 + 8 + 8 + 4 + 4);
-#else
-    static_assert(sizeof(Label) == 8 + 8 + 8 + 8 + 4 + 4);
-#endif
 
     // Comparison of labels in heuristic
     struct LabelCompare
@@ -74,14 +68,28 @@ class AStar
 
         LabelCompare(const Int map_size) : reservation_table_(map_size) {}
 
-        inline bool operator()(const Label* const a, const Label* const b)
+        inline bool operator()(const Label* const a, const Label* const b) const
         {
-            // Prefer smallest f (shorter path) and break ties with smallest reserved
-            // status (not reserved) and then largest g (near the end).
+#ifdef USE_RANDOM_TIE_BREAK
+            // Previous comparison breaking complete ties randomly, kept to benchmark against.
             return (a->f <  b->f) ||
                    (a->f == b->f && a->reserved <  b->reserved) ||
                    (a->f == b->f && a->reserved == b->reserved && a->g >  b->g) ||
                    (a->f == b->f && a->reserved == b->reserved && a->g == b->g && static_cast<bool>(rand() % 2));
+#else
+            // Prefer smallest f (shorter path) and break ties with smallest reserved
+            // status (not reserved), then largest g (near the end) and then the label
+            // created last. All comparisons are evaluated without short-circuiting so
+            // that the heap compares labels without branching.
+            const bool f_lt = a->f < b->f;
+            const bool f_eq = a->f == b->f;
+            const bool reserved_lt = a->reserved < b->reserved;
+            const bool reserved_eq = a->reserved == b->reserved;
+            const bool g_gt = a->g > b->g;
+            const bool g_eq = a->g == b->g;
+            const bool label_id_gt = a->label_id > b->label_id;
+            return f_lt | (f_eq & (reserved_lt | (reserved_eq & (g_gt | (g_eq & label_id_gt)))));
+#endif
         }
     };
 
@@ -92,7 +100,7 @@ class AStar
     LabelPool label_pool_;
 
     // Heuristic
-    Heuristic heuristic_;
+    const Heuristic& heuristic_;
 
     // Penalties
     EdgePenalties edge_penalties_;
@@ -104,18 +112,16 @@ class AStar
     // Temporary storage for each run
     PriorityQueue<Label, LabelCompare, false> open_;
     HashTable<NodeTime, Label*> frontier_without_resources_;
-    const Vector<IntCost>* h_;
+    const uint16_t* h_;
     Vector<Cost> time_finish_h_;
 
-    // Label counter
-#ifdef DEBUG
+    // Label counter, which numbers the labels of a run to break ties
     Int nb_labels_;
-#endif
 
   public:
     // Constructors
     AStar() = delete;
-    AStar(const Map& map);
+    AStar(const Map& map, const Heuristic& heuristic);
     AStar(const AStar&) = delete;
     AStar(AStar&&) = delete;
     AStar& operator=(const AStar&) = delete;
@@ -124,6 +130,7 @@ class AStar
 
     // Getters
     inline auto max_path_length() const { return heuristic_.max_path_length(); }
+    inline const auto& heuristic() const { return heuristic_; }
     auto& reservation_table() { return open_.cmp().reservation_table_; };
     auto& edge_penalties() { return edge_penalties_; }
     auto& time_finish_penalties() { return time_finish_penalties_; }
@@ -132,7 +139,6 @@ class AStar
 #endif
 
     // Solve
-    inline void compute_h(const Node goal) { heuristic_.compute_h(goal); }
     template<bool is_farkas>
     Pair<Vector<NodeTime>, Cost> solve(const NodeTime start,
                                        const Node goal,
@@ -51,19 +51,86 @@ union EdgeCosts
 static_assert(std::is_trivially_copyable<EdgeCosts>::value);
 static_assert(sizeof(EdgeCosts) == 5 * 8);
 
+// Penalties of the outgoing edges of node-times. Penalties are stored in a hash table by
+// default. If most node-times have penalties, they are better stored densely by time and
+// node so that looking up the costs of an expansion does not need to hash.
 class EdgePenalties
 {
+    // Use the dense layout if at least this fraction of the node-times up to the last
+    // penalised timestep have penalties. Below it, copying the dense table for every agent
+    // costs more than hashing saves.
+    static constexpr Float dense_min_density = 0.5;
+
+    // Sparse layout
     HashTable<NodeTime, EdgeCosts> edge_penalties_;
 
+    // Dense layout
+    Vector<EdgeCosts> dense_edge_penalties_;    // Penalties of node n at time t at index t * map_size + n
+    Vector<Int> touched_;                       // Indices of the penalties that can be non-zero
+    EdgeCosts before_start_;                    // Penalties before time 0, which are never used
+    Int map_size_;
+    Time timesteps_;                            // Number of timesteps in use in the dense layout
+    bool is_dense_;
+
   public:
     // Constructors
-    EdgePenalties() noexcept = default;
+    EdgePenalties(const Int map_size = 0) noexcept :
+        edge_penalties_(),
+        dense_edge_penalties_(),
+        touched_(),
+        before_start_(),
+        map_size_(map_size),
+        timesteps_(0),
+        is_dense_(false)
+    {
+    }
     EdgePenalties(const EdgePenalties& other) = default;
     EdgePenalties(EdgePenalties&& other) noexcept = default;
-    EdgePenalties& operator=(const EdgePenalties& other) = default;
+    EdgePenalties& operator=(const EdgePenalties& other)
+    {
+        // Reuse the memory of this table.
+        if (this != &other)
+        {
+            map_size_ = other.map_size_;
+            if (other.is_dense_)
+            {
+                // Copy the used timesteps whole. The table is dense, so this is sequential
+                // and not much more than copying its penalties one by one.
+                const auto size = static_cast<size_t>(other.timesteps_) * map_size_;
+                for (const auto idx : touched_)
+                    if (static_cast<size_t>(idx) >= size)
+                    {
+                        dense_edge_penalties_[idx] = EdgeCosts();
+                    }
+                if (dense_edge_penalties_.size() < size)
+                {
+                    dense_edge_penalties_.resize(size);
+                }
+                std::copy(other.dense_edge_penalties_.begin(),
+                          other.dense_edge_penalties_.begin() + size,
+                          dense_edge_penalties_.begin());
+                touched_ = other.touched_;
+                timesteps_ = other.timesteps_;
+                edge_penalties_.clear();
+            }
+            else
+            {
+                clear();
+                edge_penalties_ = other.edge_penalties_;
+            }
+            is_dense_ = other.is_dense_;
+        }
+        return *this;
+    }
     EdgePenalties& operator=(EdgePenalties&& other) noexcept = default;
     ~EdgePenalties() noexcept = default;
 
+    // Getters
+    inline bool is_dense() const
+    {
+        return is_dense_;
+    }
+
     // Return the edge costs of a node-time
     template<IntCost default_cost>
     inline EdgeCosts get_edge_costs(const NodeTime nt) const
@@ -72,16 +139,25 @@ class EdgePenalties
         EdgeCosts costs(default_cost);
 
         // Find the edge penalties.
-        auto it = edge_penalties_.find(nt);
-        if (it != edge_penalties_.end())
+        const EdgeCosts* values = nullptr;
+        if (is_dense_)
         {
-            const auto& values = it->second;
-
-            costs.north += values.north;
-            costs.south += values.south;
-            costs.east += values.east;
-            costs.west += values.west;
-            costs.wait += values.wait;
+            if (nt.t < timesteps_)
+            {
+                values = &dense_edge_penalties_[static_cast<size_t>(nt.t) * map_size_ + nt.n];
+            }
+        }
+        else if (auto it = edge_penalties_.find(nt); it != edge_penalties_.end())
+        {
+            values = &it->second;
+        }
+        if (values)
+        {
+            costs.north += values->north;
+            costs.south += values->south;
+            costs.east += values->east;
+            costs.west += values->west;
+            costs.wait += values->wait;
         }
 
         // Return.
@@ -91,31 +167,145 @@ class EdgePenalties
     // Create or return the outgoing edge penalties of a node-time
     inline EdgeCosts& get_edge_penalties(const NodeTime nt)
     {
-        return edge_penalties_[nt];
+        if (is_dense_)
+        {
+            // Ignore penalties before the start.
+            if (nt.t < 0)
+            {
+                before_start_ = EdgeCosts();
+                return before_start_;
+            }
+
+            // Grow by time like the reservation table.
+            if (nt.t >= timesteps_)
+            {
+                timesteps_ = nt.t + 1;
+                if (dense_edge_penalties_.size() < static_cast<size_t>(timesteps_) * map_size_)
+                {
+                    dense_edge_penalties_.resize(static_cast<size_t>(timesteps_ + 50) * map_size_);
+                }
+            }
+
+            // Remember the entry so that it is reset by clear().
+            const auto idx = nt.t * map_size_ + nt.n;
+            auto& values = dense_edge_penalties_[idx];
+            if (is_zero(values))
+            {
+                touched_.push_back(idx);
+            }
+            return values;
+        }
+        else
+        {
+            return edge_penalties_[nt];
+        }
     }
     inline EdgeCosts& get_edge_penalties(const Node n, const Time t)
     {
         return get_edge_penalties(NodeTime(n, t));
     }
 
+    // Switch to the layout suited to the density of the penalties
+    void choose_layout()
+    {
+        debug_assert(map_size_ > 0);
+
+        // Count the penalties and find the last penalised timestep.
+        Int nb_penalties = 0;
+        Time last_time = -1;
+        if (is_dense_)
+        {
+            for (const auto idx : touched_)
+                if (!is_zero(dense_edge_penalties_[idx]))
+                {
+                    nb_penalties++;
+                    last_time = std::max(last_time, idx / map_size_);
+                }
+        }
+        else
+        {
+            nb_penalties = edge_penalties_.size();
+            for (const auto& [nt, values] : edge_penalties_)
+            {
+                last_time = std::max<Time>(last_time, nt.t);
+            }
+        }
+
+        // Convert.
+        const auto nb_node_times = static_cast<Float>(last_time + 1) * map_size_;
+        const bool dense = nb_penalties > 0 && nb_penalties >= dense_min_density * nb_node_times;
+        if (dense && !is_dense_)
+        {
+            is_dense_ = true;
+            for (const auto& [nt, values] : edge_penalties_)
+            {
+                get_edge_penalties(nt) = values;
+            }
+            edge_penalties_.clear();
+        }
+        else if (!dense && is_dense_)
+        {
+            is_dense_ = false;
+            for (const auto idx : touched_)
+            {
+                auto& values = dense_edge_penalties_[idx];
+                if (!is_zero(values))
+                {
+                    edge_penalties_[NodeTime(idx % map_size_, idx / map_size_)] = values;
+                    values = EdgeCosts();
+                }
+            }
+            touched_.clear();
+            timesteps_ = 0;
+        }
+    }
+
     // Reset for next run
-//    inline void reset()
-//    {
-//        edge_penalties_.clear();
-//    }
+    inline void clear()
+    {
+        for (const auto idx : touched_)
+        {
+            dense_edge_penalties_[idx] = EdgeCosts();
+        }
+        touched_.clear();
+        timesteps_ = 0;
+        edge_penalties_.clear();
+    }
 
     // Debug
     void print()
     {
         println("Edge penalties:");
-        for (const auto& [nt, values] : edge_penalties_)
+        auto print_values = [](const NodeTime nt, const EdgeCosts& values)
         {
             println("   n: {}, t: {}, nt: {}, north: {}, south: {}, east: {}, west {}, wait {}",
                     nt.n, nt.t, nt.nt,
                     values.north, values.south, values.east, values.west, values.wait);
+        };
+        if (is_dense_)
+        {
+            for (const auto idx : touched_)
+            {
+                print_values(NodeTime(idx % map_size_, idx / map_size_), dense_edge_penalties_[idx]);
+            }
+        }
+        else
+        {
+            for (const auto& [nt, values] : edge_penalties_)
+            {
+                print_values(nt, values);
+            }
         }
         println("");
     }
+
+  private:
+    // Check if no penalty is set. NaN, used to forbid an edge, is not zero.
+    static inline bool is_zero(const EdgeCosts& values)
+    {
+        return values.north == 0 && values.south == 0 && values.east == 0 &&
+               values.west == 0 && values.wait == 0;
+    }
 };
 
 }
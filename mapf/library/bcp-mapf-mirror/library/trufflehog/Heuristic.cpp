@@ -20,199 +20,97 @@ Author: Edward Lam <ed@ed-lam.com>
 //#define PRINT_DEBUG
 
 #include "Heuristic.h"
+#include <atomic>
+#include <thread>
 
 namespace TruffleHog
 {
 
-Heuristic::Heuristic(const Map& map, LabelPool& label_pool)
+Heuristic::Heuristic(const Map& map)
     : map_(map),
-      label_pool_(label_pool),
-      goals_(),
+      goal_idx_(map_.size(), -1),
       h_(),
-      max_path_length_(-1),
-      open_(),
-      visited_(map_.size())
-#ifdef DEBUG
-    , nb_labels_(0)
-#endif
+      max_path_length_(-1)
 {
-    goals_.reserve(1000);
-    h_.reserve(1000);
 }
 
-bool Heuristic::dominated(const Node n)
+void Heuristic::search(const Node goal, uint16_t* h) const
 {
-    if (!visited_[n])
-    {
-        // Not yet visited.
-        visited_[n] = true;
-        return false;
-    }
-    else
+    // Reset.
+    std::fill(h, h + map_.size(), unreachable);
+
+    // Breadth-first search from the goal since all edges have unit cost. The queue holds
+    // the nodes in order of distance.
+    Vector<Node> queue;
+    queue.reserve(map_.size());
+    h[goal] = 0;
+    queue.push_back(goal);
+    for (size_t idx = 0; idx < queue.size(); ++idx)
     {
-        // Already visited.
-        return true;
+        // Get a node.
+        const auto current_n = queue[idx];
+        const auto next_h = h[current_n] + 1;
+        debug_assert(next_h < unreachable);
+
+        // Expand in four directions.
+        for (const auto next_n : {map_.get_north(current_n),
+                                  map_.get_south(current_n),
+                                  map_.get_east(current_n),
+                                  map_.get_west(current_n)})
+            if (map_[next_n] && h[next_n] == unreachable)
+            {
+                h[next_n] = next_h;
+                queue.push_back(next_n);
+            }
     }
 }
 
-void Heuristic::generate_start(const Node start)
+void Heuristic::compute_h(const Vector<Node>& goals, const Int nb_threads)
 {
-    // Create label.
-    auto new_label = reinterpret_cast<Label*>(label_pool_.get_label_buffer());
-    new_label->parent = nullptr;
-    new_label->g = 0;
-    new_label->n = start;
-#ifdef DEBUG
-    new_label->label_id = nb_labels_++;
-#endif
-
-    // Store the label.
-    dominated(start);
-    label_pool_.take_label();
-    open_.push(new_label);
-
-    // Print.
-    debugln("   Generating start label {} (n {}, position ({},{}), g {})",
-            new_label->label_id,
-            new_label->n,
-            map_.get_x(new_label->n),
-            map_.get_y(new_label->n),
-            new_label->g);
-}
-
-void Heuristic::generate(const Label* const current, const Node n)
-{
-    if (!dominated(n))
-    {
-        // Create label.
-        auto new_label = reinterpret_cast<Label*>(label_pool_.get_label_buffer());
-        new_label->parent = current;
-        new_label->g = current->g + 1;
-        new_label->n = n;
-#ifdef DEBUG
-        new_label->label_id = nb_labels_++;
-#endif
-
-        // Store the label.
-        label_pool_.take_label();
-        open_.push(new_label);
-
-        // Print.
-        debugln("   Generating label {} (n {}, position ({},{}), g {})",
-                new_label->label_id,
-                new_label->n,
-                map_.get_x(new_label->n),
-                map_.get_y(new_label->n),
-                new_label->g);
-    }
-    else
-    {
-        debugln("   Not generating label (n {}, position ({},{}), g {})",
-                n,
-                map_.get_x(n),
-                map_.get_y(n),
-                current->g + 1);
-    }
-}
+    // Add the goals that do not have h-values yet.
+    const auto first_new = static_cast<Int>(h_.size());
+    Vector<Node> new_goals;
+    for (const auto goal : goals)
+        if (goal_idx_[goal] < 0)
+        {
+            // Print.
+            debugln("Computing h to goal node {}, position ({},{})",
+                    goal, map_.get_x(goal), map_.get_y(goal));
+
+            // Add a new goal.
+            goal_idx_[goal] = h_.size();
+            h_.emplace_back(map_.size());
+            new_goals.push_back(goal);
+        }
 
-void Heuristic::generate_neighbours(const Label* const current)
-{
-    // Expand in four directions.
-    const auto current_n = current->n;
-    if (const auto new_n = map_.get_north(current_n); map_[new_n])
+    // Compute the h-values of the new goals.
+    std::atomic<size_t> next_idx(0);
+    auto run = [&]()
     {
-        generate(current, new_n);
-    }
-    if (const auto new_n = map_.get_south(current_n); map_[new_n])
-    {
-        generate(current, new_n);
-    }
-    if (const auto new_n = map_.get_east(current_n); map_[new_n])
-    {
-        generate(current, new_n);
-    }
-    if (const auto new_n = map_.get_west(current_n); map_[new_n])
+        for (auto idx = next_idx++; idx < new_goals.size(); idx = next_idx++)
+        {
+            search(new_goals[idx], h_[first_new + idx].data());
+        }
+    };
+    Vector<std::thread> threads;
+    for (Int idx = 1; idx < std::min<Int>(nb_threads, new_goals.size()); ++idx)
     {
-        generate(current, new_n);
+        threads.emplace_back(run);
     }
-}
-
-void Heuristic::search(const Node goal, Vector<IntCost>& h)
-{
-    // Reset.
-    label_pool_.reset(sizeof(Label));
-    open_.clear();
-    std::fill(visited_.begin(), visited_.end(), false);
-
-    // Create label at the start node.
-    generate_start(goal);
-
-    // Main loop.
-    debug_assert(static_cast<Int>(h.size()) == map_.size());
-    while (!open_.empty())
+    run();
+    for (auto& thread : threads)
     {
-        // Get a label from priority queue.
-        const auto current = open_.top();
-        open_.pop();
-
-        // Print.
-        debugln("Expanding label {} (n {}, position ({},{}), g {})",
-                current->label_id,
-                current->n,
-                map_.get_x(current->n),
-                map_.get_y(current->n),
-                current->g);
-
-        // Store h.
-        h[current->n] = current->g;
-
-        // Generate neighbours.
-        generate_neighbours(current);
+        thread.join();
     }
-    debugln("=======================================");
-}
 
-const Vector<IntCost>& Heuristic::compute_h(const Node goal)
-{
-    auto it = std::find(goals_.begin(), goals_.end(), goal);
-    if (it == goals_.end())
-    {
-        // Print.
-        debugln("Computing h to goal node {}, position ({},{})",
-                goal, map_.get_x(goal), map_.get_y(goal));
-
-        // Add a new goal since no h-values exist for this goal yet.
-        goals_.emplace_back(goal);
-
-        // Compute the h-values for this goal.
-        auto& h = h_.emplace_back(map_.size(), -1);
-        search(goal, h);
-
-        // Get estimate of longest path length.
-        {
-            auto it = std::max_element(h.begin(), h.end());
-            debug_assert(it != h.end());
-            const auto new_max_path_length = 2 * *it;
-            if (new_max_path_length > max_path_length_)
+    // Get estimate of longest path length.
+    for (size_t idx = first_new; idx < h_.size(); ++idx)
+        for (const auto h : h_[idx])
+            if (h != unreachable && 2 * h > max_path_length_)
             {
-                max_path_length_ = new_max_path_length;
+                max_path_length_ = 2 * h;
                 debugln("Max path length: {}", max_path_length_);
             }
-        }
-
-        // Done.
-        return h;
-    }
-    else
-    {
-        // Print.
-        debugln("Retrieving pre-computed h to goal node {}, position ({},{})",
-                goal, map_.get_x(goal), map_.get_y(goal));
-
-        // Retrieve existing h-values.
-        const auto idx = it - goals_.begin();
-        return h_[idx];
-    }
 }
 
 }
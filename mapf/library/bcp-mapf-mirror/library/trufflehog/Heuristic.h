@@ -22,64 +22,33 @@ Author: Edward Lam <ed@ed-lam.com>
 
 #include "Includes.h"
 #include "Coordinates.h"
-#include "LabelPool.h"
 #include "Map.h"
-#include "PriorityQueue.h"
+#include <limits>
 
 namespace TruffleHog
 {
 
+// Distances to the goals of the agents. The distances are computed once for every goal and
+// then shared by all pricing solvers, which switch between goals by pointer.
 class Heuristic
 {
-    // Label for heuristic
-    struct Label
-    {
-        const Label* parent;
-        IntCost g;
-        Node n;
-#ifdef DEBUG
-        Int label_id;
-#endif
-    };
-#ifdef DEBUG
-    static_assert(sizeof(Label) == 8 + 4 + 4 + 8);
-#else
-    static_assert(sizeof(Label) == 8 + 4 + 4);
-#endif
-
-    // Comparison of labels in heuristic
-    struct LabelCompare
-    {
-        inline bool operator()(const Label* const a, const Label* const b)
-        {
-            return a->g < b->g;
-        }
-    };
+  public:
+    // Distance of nodes that cannot reach the goal
+    static constexpr uint16_t unreachable = std::numeric_limits<uint16_t>::max();
 
+  private:
     // Instance
     const Map& map_;
 
-    // Global memory pool
-    LabelPool& label_pool_;
-
     // Runs
-    Vector<Node> goals_;
-    Vector<Vector<IntCost>> h_;
+    Vector<Int> goal_idx_;                 // Index of the table of each goal node, -1 if none
+    Vector<Vector<uint16_t>> h_;           // Distance of every node to each goal
     Time max_path_length_;
 
-    // Temporary storage for each run
-    PriorityQueue<Label, LabelCompare, true> open_;
-    Vector<bool> visited_;
-
-    // Label counter
-#ifdef DEBUG
-    Int nb_labels_;
-#endif
-
   public:
     // Constructors
     Heuristic() = delete;
-    Heuristic(const Map& map, LabelPool& label_pool);
+    Heuristic(const Map& map);
     Heuristic(const Heuristic&) = delete;
     Heuristic(Heuristic&&) = delete;
     Heuristic& operator=(const Heuristic&) = delete;
@@ -89,20 +58,20 @@ class Heuristic
     // Getters
     inline auto max_path_length() const { return max_path_length_; }
 
-    // Compute heuristic costs to a goal node
-    const Vector<IntCost>& compute_h(const Node goal);
+    // Compute heuristic costs to the goal nodes that do not have them yet, one goal per
+    // thread
+    void compute_h(const Vector<Node>& goals, const Int nb_threads = 1);
 
-  private:
-    // Check if a node has already been visited
-    bool dominated(const Node n);
-
-    // Generate labels
-    void generate_start(const Node start);
-    void generate(const Label* const current, const Node n);
-    void generate_neighbours(const Label* const current);
+    // Get the heuristic costs to a goal node
+    inline const uint16_t* get_h(const Node goal) const
+    {
+        debug_assert(goal_idx_[goal] >= 0);
+        return h_[goal_idx_[goal]].data();
+    }
 
+  private:
     // Find h of each node to a goal
-    void search(const Node goal, Vector<IntCost>& h);
+    void search(const Node goal, uint16_t* h) const;
 };
 
 }
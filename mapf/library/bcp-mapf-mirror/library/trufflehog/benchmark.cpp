@@ -0,0 +1,151 @@
+/*
+This file is part of BCP-MAPF.
+
+BCP-MAPF is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BCP-MAPF is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with BCP-MAPF.  If not, see <https://www.gnu.org/licenses/>.
+
+Author: Edward Lam <ed@ed-lam.com>
+*/
+
+// Measures the throughput of the pricing solver on a fixed random instance.
+//
+// Usage: trufflehog_benchmark [penalty percent] [threads] [runs per agent]
+//
+// The instance is a 32x32 map with 10% obstacles and 50 agents. The given percentage
+// of (node, time) pairs up to time 80 get random edge penalties. Every thread owns an
+// AStar and solves a share of the agents. The sum of the path costs is printed so that
+// changes to the solver can be checked for identical results. The penalties are stored
+// in the layout chosen by the pricer, so 50% and above run on the dense layout.
+//
+// trufflehog_benchmark_random_tie_break is built with USE_RANDOM_TIE_BREAK to measure
+// the previous open-list comparison, which broke ties with rand(), as a baseline.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Includes.h"
+#include "Coordinates.h"
+#include "Instance.h"
+#include "EdgePenalties.h"
+#include "Heuristic.h"
+#include "AStar.h"
+
+int main(int argc, char** argv)
+{
+    using namespace TruffleHog;
+
+    // Read parameters.
+    const Int penalty_percent = argc > 1 ? std::atoi(argv[1]) : 5;
+    const Int nb_threads = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 1;
+    const Int nb_runs = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+    // Create instance.
+    std::mt19937 rng(7);
+    const Int width = 32;
+    const Int height = 32;
+    Vector<std::pair<int, int>> obstacles;
+    Vector<std::pair<int, int>> starts;
+    Vector<std::pair<int, int>> goals;
+    Vector<bool> blocked(width * height, false);
+    for (Int x = 0; x < width; ++x)
+        for (Int y = 0; y < height; ++y)
+            if (rng() % 10 == 0)
+            {
+                obstacles.emplace_back(x, y);
+                blocked[x * height + y] = true;
+            }
+    while (starts.size() < 50)
+    {
+        const Int start_x = rng() % width;
+        const Int start_y = rng() % height;
+        const Int goal_x = rng() % width;
+        const Int goal_y = rng() % height;
+        if (!blocked[start_x * height + start_y] && !blocked[goal_x * height + goal_y])
+        {
+            starts.emplace_back(start_x, start_y);
+            goals.emplace_back(goal_x, goal_y);
+        }
+    }
+    const auto instance = Instance(width, height, obstacles, starts, goals);
+    const auto& map = instance.map;
+    const auto& agents = instance.agents;
+    const auto nb_agents = static_cast<Int>(agents.size());
+
+    // Compute h to the goals.
+    Heuristic heuristic(map);
+    {
+        Vector<Node> agent_goals(nb_agents);
+        for (Agent a = 0; a < nb_agents; ++a)
+        {
+            agent_goals[a] = agents[a].goal;
+        }
+        heuristic.compute_h(agent_goals, nb_threads);
+    }
+
+    // Create edge penalties.
+    EdgePenalties edge_penalties(map.size());
+    for (Node n = 0; n < map.size(); ++n)
+        for (Time t = 0; t < 80; ++t)
+            if (static_cast<Int>(rng() % 100) < penalty_percent)
+            {
+                auto& penalties = edge_penalties.get_edge_penalties(n, t);
+                penalties.d[rng() % 5] += 0.5 * (rng() % 4);
+            }
+    edge_penalties.choose_layout();
+
+    // Solve.
+    Vector<Cost> path_costs(nb_agents);
+    auto work = [&](const Int thread_idx)
+    {
+        AStar astar(map, heuristic);
+        astar.edge_penalties() = edge_penalties;
+        for (Int run = 0; run < nb_runs; ++run)
+            for (Agent a = thread_idx; a < nb_agents; a += nb_threads)
+            {
+                path_costs[a] = astar.solve<false>(NodeTime(agents[a].start, 0), agents[a].goal).second;
+            }
+    };
+    const auto start_time = std::chrono::steady_clock::now();
+    Vector<std::thread> threads;
+    for (Int thread_idx = 1; thread_idx < nb_threads; ++thread_idx)
+    {
+        threads.emplace_back(work, thread_idx);
+    }
+    work(0);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const std::chrono::duration<double> run_time = std::chrono::steady_clock::now() - start_time;
+
+    // Print.
+    Cost total_cost = 0;
+    for (const auto path_cost : path_costs)
+    {
+        total_cost += path_cost;
+    }
+    printf("Threads: %d, penalties: %d%% (%s), total cost: %.2f, time: %.3f s, solves/s: %.0f\n",
+           nb_threads,
+           penalty_percent,
+           edge_penalties.is_dense() ? "dense" : "sparse",
+           total_cost,
+           run_time.count(),
+           nb_runs * nb_agents / run_time.count());
+
+    // Done.
+    return 0;
+}
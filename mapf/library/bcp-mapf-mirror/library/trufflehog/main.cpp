@@ -50,8 +50,19 @@ int main()
     const auto& map = instance.map;
     const auto& agents = instance.agents;
 
+    // Compute h to the goals.
+    Heuristic heuristic(map);
+    {
+        Vector<Node> goals(agents.size());
+        for (Agent a = 0; a < agents.size(); ++a)
+        {
+            goals[a] = agents[a].goal;
+        }
+        heuristic.compute_h(goals);
+    }
+
     // Create shortest path algorithm.
-    AStar astar(map);
+    AStar astar(map, heuristic);
     astar.set_verbose(true);
 
     // Create edge dual values.
@@ -82,6 +82,8 @@ int main(int argc, char* argv[]) {
     out << "statistics:" << std::endl;
     out << "  cost: " << solution.first << std::endl;
     out << "  runtime: " << icts_time << std::endl;
+    out << "  ictNodesGenerated: " << mapf_icts_.get_nodes_generated() << std::endl;
+    out << "  ictNodesPruned: " << mapf_icts_.get_nodes_pruned() << std::endl;
     out << "schedule:" << std::endl;
 
     int count = 0;
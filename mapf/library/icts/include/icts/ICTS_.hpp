@@ -8,7 +8,15 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <map>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
 #include <time.h>
 
 #include <boost/heap/fibonacci_heap.hpp>
@@ -22,591 +30,816 @@ typedef std::tuple<int, int, int> tup;
 typedef std::vector<tup> v_tup;
 typedef std::set<tup> s_tup;
 
-class TreeNode{
-public:
-	TreeNode(std::vector<int> path_costs){
-		agent_path_costs = path_costs;
-		childs.resize(0);
-	}
-
-	std::vector<int> get_costs(){	return agent_path_costs;	}
-
-	int get_costs_sum(){
-		int val = 0;
-		for(int i=0; i<agent_path_costs.size(); i++)	val += agent_path_costs[i];
-		return val;
-	}
-
-	TreeNode* get_ith_child(int i){	
-		if(i > childs.size())	return NULL;
-		return childs[i];	
-	}
-
-	std::vector<TreeNode*> get_childs(){	return childs;	}
-
-	void add_child(std::vector<int> new_path_costs){
-		TreeNode* new_node = new TreeNode(new_path_costs);
-		childs.push_back(new_node);
-	}
-
-	void expand_node(){
-		for(int i=0; i<agent_path_costs.size(); i++){
-			std::vector<int> new_costs = agent_path_costs;
-			new_costs[i] += 1;
-			TreeNode* new_child = new TreeNode(new_costs);
-			childs.push_back(new_child);
-		}
-	}
-
-private:
-	std::vector<int> agent_path_costs;
-	std::vector<TreeNode*> childs;
-};
-
-class IncreasingCostTree{
-public:
-	IncreasingCostTree(std::vector<std::vector<bool> > mp, std::vector<pair_1> g, std::vector<pair_1> s, std::vector<int> initial_estimate){
-		my_map = mp;
-		goals = g;
-		starts = s;
-		initial_cost = initial_estimate;
-
-		root = new TreeNode(initial_estimate);
-		open_list.push_back(root);
-		closed_list.insert(initial_estimate);
-	}
-
-	std::deque<TreeNode*> get_open_list(){	return open_list;	}
-	
-	TreeNode* get_next_node_to_expand(){	return open_list.front();	}
-	
-	void pop_next_node_to_expand(){	open_list.pop_front();	}
-
-	void add_node_to_open_list(TreeNode* node){	open_list.push_back(node);	}
-
-	void add_unexplored_node_to_open_list(TreeNode* node){
-		std::vector<int> node_cost = node->get_costs();
-
-		if(closed_list.find(node_cost) == closed_list.end()){
-			closed_list.insert(node_cost);
-			open_list.push_back(node);
+namespace ICT_NEW{
+	const uint16_t unreachable = 0xFFFF;
+
+	/*
+	The cells of the map, numbered x*y_dim + y. The successors of a cell are
+	stored in one flat table, num_ops entries per cell in the order of op
+	(wait first), with -1 for moves into obstacles or off the map.
+	*/
+	class grid{
+	public:
+		static const int num_ops = 5;
+
+		grid():
+			x_dim(0),
+			y_dim(0)	{}
+
+		grid(int x, int y, const std::vector<pair_1> &obstacles):
+			x_dim(x),
+			y_dim(y),
+			blocked(x*y, 0),
+			move_table(x*y*num_ops, -1)	{
+				const std::vector<pair_1> op = {{0,0}, {-1,0}, {0,1}, {1,0}, {0,-1}};
+				for(const pair_1 &o : obstacles){
+					blocked[index(o)] = 1;
+				}
+				for(int cell=0; cell<size(); cell++){
+					if(blocked[cell])	continue;
+					for(int k=0; k<num_ops; k++){
+						int nx = cell/y_dim + op[k].first;
+						int ny = cell%y_dim + op[k].second;
+						if(nx >= 0 && nx < x_dim && ny >= 0 && ny < y_dim && !blocked[nx*y_dim + ny]){
+							move_table[cell*num_ops + k] = nx*y_dim + ny;
+						}
+					}
+				}
 		}
-	}
-
-	void expand_next_node(){
-		TreeNode* next_node = get_next_node_to_expand();
-		next_node->expand_node();
-		std::vector<TreeNode*> ch = next_node->get_childs();
-		for(int i=0; i<ch.size(); i++){
-			add_unexplored_node_to_open_list(ch[i]);
+
+		int size() const {	return x_dim*y_dim;	}
+		int num_free() const {	return size() - std::count(blocked.begin(), blocked.end(), 1);	}
+		bool is_blocked(int cell) const {	return blocked[cell];	}
+		int index(pair_1 p) const {	return p.first*y_dim + p.second;	}
+		pair_1 location(int cell) const {	return {cell/y_dim, cell%y_dim};	}
+
+		// num_ops successors of cell, -1 where the move is invalid
+		const int* moves(int cell) const {	return &move_table[cell*num_ops];	}
+
+		// breadth-first distances from source, unreachable for the other cells
+		void bfs(int source, uint16_t *dist) const {
+			std::fill(dist, dist + size(), unreachable);
+			std::vector<int> queue(1, source);
+			dist[source] = 0;
+			for(size_t head=0; head<queue.size(); head++){
+				int v = queue[head];
+				const int *next = moves(v);
+				for(int k=1; k<num_ops; k++){
+					if(next[k] != -1 && dist[next[k]] == unreachable){
+						dist[next[k]] = dist[v] + 1;
+						queue.push_back(next[k]);
+					}
+				}
+			}
 		}
-	}
-
-private:
-	std::vector<std::vector<bool> > my_map;
-	std::vector<pair_1> goals;
-	std::vector<pair_1> starts;
-	std::vector<int> initial_cost;
-	TreeNode* root;
-	std::deque<TreeNode*> open_list;
-	std::set<std::vector<int> > closed_list;
-};
 
-namespace ICT_NEW{
+	private:
+		int x_dim, y_dim;
+		std::vector<char> blocked;
+		std::vector<int> move_table;
+	};
 
+	/*
+	Multi-valued decision diagram of the paths of one agent that reach its
+	goal at time depth, as one bitset over the cells per time step. Level t
+	holds the cells v with from_start[v] <= t and to_goal[v] <= depth - t;
+	since waiting is allowed everywhere, every such cell lies on such a path.
+
+	Levels only grow with the depth, so extend() turns the MDD of depth d into
+	that of depth d+1 in place, adding the cells with to_goal = d+1-t to every
+	level. The MDD of depth D also answers for any smaller depth d: a cell of
+	level t belongs to the depth-d MDD iff to_goal[v] <= d - t. One MDD per
+	agent therefore serves every ICT node.
+	*/
 	class MDD{
 	public:
-		MDD(){
-			agent = -1;
-		}
-		MDD(int ag, pair_1 s, pair_1 g, std::vector<std::vector<bool> > my_map, int d, MDD last_mdd = MDD(), bool generate = true){
-			agent = ag;
-			start = s;
-			goal = g;
-			depth = d;
-
-			mdd = std::map<tup, s_tup>();
-			level = std::map<int, std::set<pair_1> >();
-			bfs_tree = std::map<tup, s_tup>();
-			visited = std::set<tup>();
-			fringe = std::set<tup>();
-			fringe_prevs = std::map<tup, s_tup>();
-
-			if(generate){
-				if(last_mdd.agent != -1 && last_mdd.depth < depth && last_mdd.agent == agent){
-					generate_mdd(my_map, last_mdd);
-				}else{
-					generate_mdd(my_map);
+		MDD():
+			map(NULL),
+			start(-1),
+			goal(-1),
+			depth(-1),
+			words(0)	{}
+
+		// from_start and to_goal are the agent's distance tables; they must outlive the MDD
+		MDD(const grid &map, int start, int goal, const uint16_t *from_start, const uint16_t *to_goal, int d):
+			map(&map),
+			start(start),
+			goal(goal),
+			depth(-1),
+			from_start(from_start),
+			to_goal(to_goal),
+			words((map.size() + 63)/64)	{
+				// counting sort of the cells reachable from the start by distance to the goal
+				int max_dist = -1;
+				for(int v=0; v<map.size(); v++){
+					if(from_start[v] != unreachable && to_goal[v] != unreachable)	max_dist = std::max<int>(max_dist, to_goal[v]);
 				}
-			}
+				bucket_offsets.assign(max_dist + 2, 0);
+				for(int v=0; v<map.size(); v++){
+					if(from_start[v] != unreachable && to_goal[v] != unreachable)	bucket_offsets[to_goal[v] + 1]++;
+				}
+				for(size_t k=1; k<bucket_offsets.size(); k++){
+					bucket_offsets[k] += bucket_offsets[k-1];
+				}
+				by_goal_dist.resize(bucket_offsets.back());
+				std::vector<int> fill(bucket_offsets.begin(), bucket_offsets.end() - 1);
+				for(int v=0; v<map.size(); v++){
+					if(from_start[v] != unreachable && to_goal[v] != unreachable)	by_goal_dist[fill[to_goal[v]]++] = v;
+				}
+				extend_to(d);
 		}
 
-		void generate_mdd(std::vector<std::vector<bool> > my_map, MDD last_mdd = MDD()){
-			if(last_mdd.agent != -1){
-				bootstrap_depth_d_bfs_tree(my_map, last_mdd);
-			} else {
-				get_depth_d_bfs_tree(my_map);
-			}
-			bfs_to_mdd();
-			if(mdd.size()){
-				populate_levels();
+		// the MDD of depth get_depth() + 1
+		void extend(){
+			depth++;
+			levels.resize((depth+1)*words, 0);
+			for(int t=0; t<=depth; t++){
+				int r = depth - t;
+				if(r + 1 >= (int)bucket_offsets.size())	continue;
+				uint64_t *level = &levels[t*words];
+				for(int k=bucket_offsets[r]; k<bucket_offsets[r+1]; k++){
+					int v = by_goal_dist[k];
+					if(from_start[v] <= t)	level[v >> 6] |= uint64_t(1) << (v & 63);
+				}
 			}
 		}
 
-		void populate_levels(){
-			level[0] = std::set<pair_1>();
-			level[0].insert(start);
+		void extend_to(int d){
+			while(depth < d)	extend();
+		}
 
-			for(auto it=mdd.begin(); it!=mdd.end(); it++){
-				for(auto it2 = it->second.begin(); it2!=it->second.end(); it2++){
-					if(level.find(std::get<2>(*(it2))) == level.end()){
-						level[std::get<2>(*(it2))] = std::set<pair_1>();
-					}
-					level[std::get<2>(*(it2))].insert({std::get<0>(*(it2)), std::get<1>(*(it2))});
-				}
-			}
+		// whether cell is at level t of the MDD of depth d <= get_depth(); past d the agent waits at its goal
+		bool contains(int t, int cell, int d) const {
+			if(t >= d)	return cell == goal && from_start[goal] <= d;
+			return ((levels[t*words + (cell >> 6)] >> (cell & 63)) & 1) && to_goal[cell] <= d - t;
 		}
 
-		void bootstrap_depth_d_bfs_tree(std::vector<std::vector<bool> > my_map, MDD last_mdd){
-			std::deque<tup> fringe_bfs;
-			std::set<tup> old_fringe = last_mdd.fringe;
-			for(auto i:old_fringe){
-				fringe_bfs.push_back(i);
-			}
+		int get_start() const {	return start;	}
+		int get_goal() const {	return goal;	}
+		int get_depth() const {	return depth;	}
+		const grid& get_map() const {	return *map;	}
 
-			std::map<tup, s_tup> prev_dict = last_mdd.bfs_tree;
-			for(auto i:old_fringe){
-				for(auto j:last_mdd.fringe_prevs[i])
-					prev_dict[i].insert(j);
-			}
+	private:
+		const grid *map;
+		int start;
+		int goal;
+		int depth;
+		const uint16_t *from_start;
+		const uint16_t *to_goal;
+		size_t words;
+		// level t occupies [t*words, (t+1)*words)
+		std::vector<uint64_t> levels;
+		// cells with to_goal = r are by_goal_dist[bucket_offsets[r] .. bucket_offsets[r+1]-1]
+		std::vector<int> by_goal_dist;
+		std::vector<int> bucket_offsets;
+	};
 
-			std::set<tup> vis = last_mdd.visited;
-			main_bfs_loop(my_map, fringe_bfs, prev_dict, vis);
+	// the MDD of one agent at one cost; the shared MDD may already be deeper
+	struct mdd_at_depth{
+		const MDD *mdd;
+		int depth;
+	};
 
+	/*
+	Set of joint MDD nodes, each packed into a fixed-width key of one cell id
+	per agent followed by the time step. Keys are stored back to back and
+	found through an open-addressing table.
+	*/
+	class joint_node_table{
+	public:
+		joint_node_table():
+			width(0),
+			num_keys(0)	{}
+
+		void reset(int num_agents){
+			width = num_agents + 1;
+			num_keys = 0;
+			keys.clear();
+			slots.assign(1024, empty_slot);
 		}
 
-		void get_depth_d_bfs_tree(std::vector<std::vector<bool> > my_map){
-			std::deque<tup> fringe_bfs;
-			fringe_bfs.push_back({start.first, start.second, 0});
-			std::map<tup, s_tup> prev_dict = std::map<tup, s_tup>();
-			std::set<tup> vis = std::set<tup>();
-			main_bfs_loop(my_map, fringe_bfs, prev_dict, vis);
+		// returns false if the node is already in the table
+		bool insert(const int *cells, int t){
+			key.assign(cells, cells + width - 1);
+			key.push_back(t);
+			size_t i = find_slot(key.data());
+			if(slots[i] != empty_slot)	return false;
+			if(2*(num_keys + 1) > slots.size()){
+				grow();
+				i = find_slot(key.data());
+			}
+			keys.insert(keys.end(), key.begin(), key.end());
+			slots[i] = num_keys++;
+			return true;
 		}
 
-		void main_bfs_loop(std::vector<std::vector<bool> > my_map, std::deque<tup> fringe_bfs, std::map<tup, s_tup> prev_dict, std::set<tup> vis){
-			std::set<tup> depth_d_plus_one_fringe;
-			std::map<tup, s_tup> fringe_prevs_bfs;
-
-			while(!fringe_bfs.empty()){
-				tup cur = fringe_bfs.front();
-				fringe_bfs.pop_front();
-
-				int agent_loc_x = std::get<0>(cur);
-				int agent_loc_y = std::get<1>(cur);
-				int agent_loc_d = std::get<2>(cur);
-
-				for(int i=0; i<op.size(); i++){
-					int new_agent_x = agent_loc_x + op[i].first;
-					int new_agent_y = agent_loc_y + op[i].second;
-					int new_agent_d = agent_loc_d + 1;
-					if(new_agent_x < my_map.size() && new_agent_x >= 0 && my_map.size() > 0 && new_agent_y >= 0 && new_agent_y < my_map[0].size() && my_map[new_agent_x][new_agent_y] == false){
-						if(new_agent_d <= depth){
-							if(prev_dict.find({new_agent_x, new_agent_y, new_agent_d}) != prev_dict.end())
-								prev_dict[{new_agent_x, new_agent_y, new_agent_d}].insert(cur);
-							else{
-								prev_dict[{new_agent_x, new_agent_y, new_agent_d}] = std::set<tup>();
-								prev_dict[{new_agent_x, new_agent_y, new_agent_d}].insert(cur);
-							}
-							if(vis.find({new_agent_x, new_agent_y, new_agent_d}) == vis.end()){
-								fringe_bfs.push_back({new_agent_x, new_agent_y, new_agent_d});
-								vis.insert({new_agent_x, new_agent_y, new_agent_d});
-							}
-						}
-						if(new_agent_d == depth + 1){
-							depth_d_plus_one_fringe.insert({new_agent_x, new_agent_y, new_agent_d});
-							if(fringe_prevs_bfs.find({new_agent_x, new_agent_y, new_agent_d}) == fringe_prevs_bfs.end())
-								fringe_prevs_bfs[{new_agent_x, new_agent_y, new_agent_d}] = std::set<tup>();
-							fringe_prevs_bfs[{new_agent_x, new_agent_y, new_agent_d}].insert(cur);
-						}
-					}
-				}
+		size_t size() const {	return num_keys;	}
+
+	private:
+		static constexpr uint32_t empty_slot = UINT32_MAX;
+
+		size_t hash_key(const int *k) const {
+			uint64_t hash = 0x9E3779B97F4A7C15ULL;
+			for(int i=0; i<width; i++){
+				hash = (hash ^ uint32_t(k[i]))*0xFF51AFD7ED558CCDULL;
+				hash ^= hash >> 32;
 			}
+			return hash;
+		}
 
-			bfs_tree = prev_dict;
-			visited = vis;
-			fringe = depth_d_plus_one_fringe;
-			fringe_prevs = fringe_prevs_bfs;
+		// slot holding the key, or the empty slot where it belongs
+		size_t find_slot(const int *k) const {
+			size_t mask = slots.size() - 1;
+			size_t i = hash_key(k) & mask;
+			while(slots[i] != empty_slot && !std::equal(k, k + width, &keys[size_t(slots[i])*width])){
+				i = (i + 1) & mask;
+			}
+			return i;
 		}
 
-		void bfs_to_mdd(){
-			tup goal_time = {goal.first, goal.second, depth};
-			std::set<std::pair<tup, tup> > vis;
+		void grow(){
+			slots.assign(2*slots.size(), empty_slot);
+			for(uint32_t n=0; n<num_keys; n++){
+				slots[find_slot(&keys[size_t(n)*width])] = n;
+			}
+		}
 
-			if(bfs_tree.find(goal_time) == bfs_tree.end())	return;
+		int width;
+		uint32_t num_keys;
+		std::vector<int> keys;
+		std::vector<uint32_t> slots;
+		std::vector<int> key;
+	};
 
-			std::deque<std::pair<tup, tup> > trace_list;
-			
-			for(auto parent:bfs_tree[goal_time]){
-				trace_list.push_back({parent, goal_time});
-				vis.insert({parent, goal_time});
+	/*
+	Depth-first search of the joint MDD of several agents for paths without
+	vertex and swap conflicts. The recursion is an explicit stack of joint
+	nodes, one frame per time step, so the frames spell out the paths when the
+	goal is reached.
+
+	Children are generated lazily, one agent at a time: each frame keeps the
+	operator chosen for every agent and how many agents are fixed, and a move
+	that collides with an agent fixed before it is rejected before the agents
+	after it are considered. Collisions are found through stamped per-cell
+	arrays. Every joint node is expanded at most once per find().
+
+	All buffers are kept between calls; once they have grown, find() does not
+	allocate apart from the visited table.
+	*/
+	class joint_mdd_search{
+	public:
+		joint_mdd_search():
+			num_agents(0),
+			stamp(0),
+			nodes_generated(0),
+			interrupted(false)	{}
+
+		// called every interrupt_interval generated nodes; find() gives up and returns false as soon as it returns true
+		void set_interrupt(std::function<bool()> f){	interrupt = f;	}
+
+		// one path per agent, all of length max depth + 1, or false if the joint MDD has no solution; paths may be NULL
+		bool find(const std::vector<mdd_at_depth> &mdds, std::vector<std::vector<pair_1> > *paths){
+			num_agents = mdds.size();
+			nodes_generated = 0;
+			interrupted = false;
+			if(!num_agents)	return false;
+			agents = &mdds;
+			const grid &map = mdds[0].mdd->get_map();
+			if(now_stamp.size() != size_t(map.size())){
+				now_stamp.assign(map.size(), 0);
+				next_stamp.assign(map.size(), 0);
+				now_agent.assign(map.size(), 0);
+				stamp = 0;
 			}
 
-			while(!trace_list.empty()){
-				std::pair<tup, tup> t = trace_list.front();
-				trace_list.pop_front();
-				tup cur = t.first;
-				tup child = t.second;
-
-				if(mdd.find(cur) == mdd.end()){
-					mdd[cur] = std::set<tup>();
+			max_depth = 0;
+			cells.clear();
+			for(const mdd_at_depth &m : mdds){
+				if(!m.mdd->contains(0, m.mdd->get_start(), m.depth))	return false;
+				cells.push_back(m.mdd->get_start());
+				max_depth = std::max(max_depth, m.depth);
+			}
+			visited.reset(num_agents);
+			visited.insert(cells.data(), 0);
+			ops.assign(num_agents, 0);
+			fixed.assign(1, 0);
+
+			while(!fixed.empty()){
+				int t = fixed.size() - 1;
+				const int *cur = &cells[t*num_agents];
+				if(is_goal(cur, t)){
+					if(!paths)	return true;
+					paths->assign(num_agents, std::vector<pair_1>());
+					for(int i=0; i<num_agents; i++){
+						for(int s=0; s<=t; s++){
+							(*paths)[i].push_back(map.location(cells[s*num_agents + i]));
+						}
+					}
+					return true;
 				}
 
-				mdd[cur].insert(child);
-				for(auto p:bfs_tree[cur]){
-					if(vis.find({p, cur}) == vis.end()){
-						vis.insert({p, cur});
-						trace_list.push_back({p, cur});
+				cells.resize((t+2)*num_agents);
+				int *child = &cells[(t+1)*num_agents];
+				if(t < max_depth && next_child(t, child)){
+					if(++nodes_generated % interrupt_interval == 0 && interrupt && interrupt()){
+						interrupted = true;
+						return false;
+					}
+					if(visited.insert(child, t+1)){
+						ops.resize((t+2)*num_agents, 0);
+						fixed.push_back(0);
 					}
+					continue;
 				}
+				// no children left; the node stays behind as the partial child of its parent
+				cells.resize((t+1)*num_agents);
+				ops.resize(t*num_agents);
+				fixed.pop_back();
 			}
+			return false;
 		}
 
-		pair_1 get_start(){	return start;	}
-		pair_1 get_goal(){	return goal;	}
-		int get_depth(){	return depth;	}
-		int get_agent(){	return agent;	}
-		std::map<tup, s_tup> get_mdd(){	return mdd;	}
-	private:
-		int agent;
-		pair_1 start;
-		pair_1 goal;
-		int depth;
-		std::map<tup, s_tup> mdd;
-		std::map<int, std::set<pair_1> > level;
-		std::map<tup, s_tup> bfs_tree;
-		std::set<tup> visited;
-		std::set<tup> fringe;
-		std::map<tup, s_tup> fringe_prevs;
-		std::vector<pair_1> op = {{0,0}, {-1,0}, {0,1}, {1,0}, {0,-1}};
-	};
-
-	bool has_edge_collisions(const std::vector<pair_1> &this_locs, const std::vector<pair_1> &next_locs){
-		std::vector<std::pair<pair_1, pair_1> > forward;
-		std::vector<std::pair<pair_1, pair_1> > backward;
+		// joint nodes generated by the last find(), including duplicates
+		size_t get_nodes_generated() const {	return nodes_generated;	}
+		// whether the last find() was stopped by the interrupt rather than exhausting the joint MDD
+		bool was_interrupted() const {	return interrupted;	}
 
-		for(int i=0; i<this_locs.size(); i++){
-			if(this_locs[i] != next_locs[i]){
-				forward.push_back({this_locs[i], next_locs[i]});
+	private:
+		bool is_goal(const int *cur, int t) const {
+			for(int i=0; i<num_agents; i++){
+				if(t < (*agents)[i].depth || cur[i] != (*agents)[i].mdd->get_goal())	return false;
 			}
+			return true;
 		}
-		for(int i=0; i<this_locs.size(); i++){
-			if(this_locs[i] != next_locs[i]){
-				backward.push_back({next_locs[i], this_locs[i]});
+
+		// marks the cells of the node at time t and of the agents fixed in its partial child
+		void mark(int t, const int *child){
+			if(++stamp == 0){
+				std::fill(now_stamp.begin(), now_stamp.end(), 0);
+				std::fill(next_stamp.begin(), next_stamp.end(), 0);
+				stamp = 1;
+			}
+			const int *cur = &cells[t*num_agents];
+			for(int i=0; i<num_agents; i++){
+				now_stamp[cur[i]] = stamp;
+				now_agent[cur[i]] = i;
+			}
+			for(int i=0; i<fixed[t]; i++){
+				next_stamp[child[i]] = stamp;
 			}
 		}
 
-		std::set<std::pair<pair_1, pair_1> > set_forward(forward.begin(), forward.end());
-		std::set<std::pair<pair_1, pair_1> > set_backward(backward.begin(), backward.end());
-		
-		std::vector<std::pair<pair_1, pair_1>> common_data;
-		std::set_intersection(set_forward.begin(), set_forward.end(), set_backward.begin(), set_backward.end(), std::back_inserter(common_data));
-		return common_data.size() > 0;
-	}
-
-	bool is_invalid_move(const std::vector<pair_1> &this_locs, const std::vector<pair_1> &next_locs){
-		std::set<pair_1> set_locs(next_locs.begin(), next_locs.end());
-		bool vertex_collision = (set_locs.size() != next_locs.size());
-		bool edge_collision = has_edge_collisions(this_locs, next_locs);
-		return (vertex_collision || edge_collision);
-	}
-
-	bool is_goal_state(std::vector<MDD> mdds_list, std::vector<pair_1> nodes, int cur_depth){
-		for(int i=0; i<nodes.size(); i++){
-			if(cur_depth < mdds_list[i].get_depth() or nodes[i] != mdds_list[i].get_goal())	return false;
-		}
-		return true;
-	}
-
-	std::vector<std::vector<pair_1> > get_children_for_cross_prod(std::vector<MDD> mdds_list, std::vector<pair_1> nodes, int cur_depth){
-		std::vector<std::vector<pair_1> > all_indiv_children;
-		for(int i=0; i<nodes.size(); i++){
-			if(mdds_list[i].get_goal() == nodes[i] && cur_depth >= mdds_list[i].get_depth()){
-				std::vector<pair_1> temp;
-				temp.push_back(mdds_list[i].get_goal());
-				all_indiv_children.push_back(temp);
-				continue;
-			}
-			std::vector<pair_1> temp;
-			std::map<tup, s_tup> temp_mdd = mdds_list[i].get_mdd();
-			for(auto c:temp_mdd[{nodes[i].first, nodes[i].second, cur_depth}]){
-				temp.push_back({std::get<0>(c), std::get<1>(c)});
-			}
-			all_indiv_children.push_back(temp);
-		}
-		return all_indiv_children;
-	}
-
-	std::vector<std::vector<pair_1> > cart_product (const std::vector<std::vector<pair_1> >& v) {
-		std::vector<std::vector<pair_1> > s = {{}};
-		for (const auto& u : v) {
-			std::vector<std::vector<pair_1> > r;
-			for (const auto& x : s) {
-				for (const auto y : u) {
-					r.push_back(x);
-					r.back().push_back(y);
+		/*
+		Advances the partial child of the node at time t to its next complete,
+		conflict-free child, odometer style over the agents' operators. Returns
+		false once all children were generated.
+		*/
+		bool next_child(int t, int *child){
+			const int *cur = &cells[t*num_agents];
+			uint8_t *op = &ops[t*num_agents];
+			int &i = fixed[t];
+			mark(t, child);
+			if(i == num_agents){
+				// the previous child was returned; move on from its last agent
+				i--;
+				next_stamp[child[i]] = 0;
+				op[i]++;
+			}
+			while(true){
+				if(op[i] == grid::num_ops){
+					op[i] = 0;
+					if(i == 0)	return false;
+					i--;
+					next_stamp[child[i]] = 0;
+					op[i]++;
+					continue;
 				}
+				const mdd_at_depth &m = (*agents)[i];
+				int from = cur[i];
+				int to = m.mdd->get_map().moves(from)[op[i]];
+				bool valid = to != -1 && m.mdd->contains(t + 1, to, m.depth)
+					// vertex conflict with an agent fixed before
+					&& next_stamp[to] != stamp
+					// swap with an agent fixed before
+					&& !(to != from && now_stamp[to] == stamp && now_agent[to] < i && child[now_agent[to]] == from);
+				if(!valid){
+					op[i]++;
+					continue;
+				}
+				child[i] = to;
+				next_stamp[to] = stamp;
+				if(++i == num_agents)	return true;
 			}
-			s = std::move(r);
-		}
-		return s;
-	}
-
-	std::vector<std::vector<pair_1> > get_children(std::vector<MDD> mdds_list, std::vector<pair_1> nodes, int cur_depth){
-		std::vector<std::vector<pair_1> > children_for_cross_prod = get_children_for_cross_prod(mdds_list, nodes, cur_depth);
-		std::vector<std::vector<pair_1> > all_joint_child_nodes = cart_product(children_for_cross_prod);
-		return all_joint_child_nodes;
-	}
-
-	std::pair<std::vector<std::pair<std::vector<pair_1>, int> >, std::set<std::pair<std::vector<pair_1>, int> > > joint_mdd_dfs_return_solution(std::vector<MDD> mdds_list, int max_depth, std::pair<std::vector<pair_1>, int> curr, std::set<std::pair<std::vector<pair_1>, int> > visited, std::vector<pair_1> prev = std::vector<pair_1>()){
-		if(prev.size() && is_invalid_move(prev, curr.first)){
-			return {std::vector<std::pair<std::vector<pair_1>, int> >(), visited};
 		}
-		if(visited.find(curr) != visited.end() || curr.second > max_depth){
-			return {std::vector<std::pair<std::vector<pair_1>, int> >(), visited};
+
+		int num_agents;
+		int max_depth;
+		const std::vector<mdd_at_depth> *agents;
+		// the node of frame t is cells[t*num_agents .. (t+1)*num_agents-1]; one more slot holds the partial child
+		std::vector<int> cells;
+		// operator of every agent in the partial child of frame t, and how many agents are fixed
+		std::vector<uint8_t> ops;
+		std::vector<int> fixed;
+		joint_node_table visited;
+		std::vector<uint32_t> now_stamp, next_stamp;
+		std::vector<int> now_agent;
+		uint32_t stamp;
+		size_t nodes_generated;
+		static const size_t interrupt_interval = 4096;
+		std::function<bool()> interrupt;
+		bool interrupted;
+	};
+
+	/*
+	Fixed-size set of worker threads for fork-join loops. The threads stay
+	alive between calls, so a loop per ICT node costs no thread creation. The
+	calling thread works as worker 0; a pool of size 1 starts no threads.
+	Only one thread at a time may call parallel_for().
+	*/
+	class worker_pool{
+	public:
+		explicit worker_pool(size_t num_threads):
+			generation(0),
+			num_tasks(0),
+			next_task(0),
+			active(0),
+			stop(false)	{
+				for(size_t i=1; i<std::max<size_t>(num_threads, 1); i++){
+					threads.emplace_back([this, i]{	worker_loop(i);	});
+				}
 		}
 
-		visited.insert(curr);
-		
-		if(is_goal_state(mdds_list, curr.first, curr.second)){
-			std::vector<std::pair<std::vector<pair_1>, int> > temp;
-			temp.push_back(curr);
-			return {temp, visited};
+		worker_pool(const worker_pool&) = delete;
+		worker_pool& operator=(const worker_pool&) = delete;
+
+		~worker_pool(){
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			wakeup.notify_all();
+			for(auto &t : threads){
+				t.join();
+			}
 		}
 
-		std::vector<std::vector<pair_1> > children = get_children(mdds_list, curr.first, curr.second);
+		// number of workers, including the calling thread
+		size_t size() const {	return threads.size() + 1;	}
 
-		std::vector<std::pair<std::vector<pair_1>, int> > partial_solution;
-		partial_solution.push_back(curr);
+		// calls fn(task, worker) for every task in [0, n) and waits for all of them; fn must not throw
+		template<typename Fn>
+		void parallel_for(size_t n, Fn &&fn){
+			if(threads.empty() || n <= 1){
+				for(size_t i=0; i<n; i++){
+					fn(i, 0);
+				}
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				job = std::ref(fn);
+				num_tasks = n;
+				next_task = 0;
+				active = threads.size();
+				generation++;
+			}
+			wakeup.notify_all();
+			run_tasks(0);
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]{	return active == 0;	});
+			job = nullptr;
+		}
 
-		std::pair<std::vector<std::pair<std::vector<pair_1>, int> >, std::set<std::pair<std::vector<pair_1>, int> > > temp_sol;
+	private:
+		void run_tasks(size_t worker){
+			size_t task;
+			while((task = next_task.fetch_add(1)) < num_tasks){
+				job(task, worker);
+			}
+		}
 
-		for(auto node:children){//vector<pair>
-			std::pair<std::vector<pair_1>, int> child = {node, curr.second + 1};
-			if(visited.find(child) == visited.end()){
-				temp_sol = joint_mdd_dfs_return_solution(mdds_list, max_depth, child, visited, curr.first);
-				if(temp_sol.first.size()){
-					for(int i=0; i<temp_sol.first.size(); i++){
-						partial_solution.push_back(temp_sol.first[i]);
-					}
-					return {partial_solution, temp_sol.second};
+		void worker_loop(size_t worker){
+			size_t seen = 0;
+			while(true){
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wakeup.wait(lock, [&]{	return stop || generation != seen;	});
+					if(stop)	return;
+					seen = generation;
+				}
+				run_tasks(worker);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if(--active == 0)	done.notify_one();
 				}
 			}
 		}
-		
-		return {std::vector<std::pair<std::vector<pair_1>, int> >(), temp_sol.second};
-	}
 
-	std::vector<std::pair<std::vector<pair_1>, int> > is_solution_in_joint_mdd(std::vector<MDD> mdds_list){
-		for(int i=0; i<mdds_list.size(); i++){
-			if(mdds_list[i].get_agent() == -1)	return std::vector<std::pair<std::vector<pair_1>, int> >();
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::condition_variable done;
+		std::function<void(size_t, size_t)> job;
+		size_t generation;
+		size_t num_tasks;
+		std::atomic<size_t> next_task;
+		size_t active;
+		bool stop;
+	};
+
+	/*
+	The increasing cost tree, explored breadth first. A node is stored as the
+	vector of its cost increments over the root, one uint16_t per agent, in a
+	flat FIFO queue. All children of a node have one more unit of total cost,
+	so duplicates can only be found in the level being generated; the closed
+	set is an open-addressing table over that level only. When the last node
+	of a level has been expanded, the level is dropped from the queue and the
+	table is cleared, so memory is bounded by two levels of the tree.
+	*/
+	class increasing_cost_tree{
+	public:
+		increasing_cost_tree(const std::vector<int> &root_costs):
+			root(root_costs),
+			width(root_costs.size()),
+			head(0),
+			level_end(1),
+			num_next(0),
+			level(0),
+			nodes_generated(1),
+			slots(1024, empty_slot),
+			costs(root_costs),
+			deltas(root_costs.size(), 0)	{}
+
+		bool empty() const {	return head == level_end;	}
+
+		// costs of the node at the front of the queue
+		const std::vector<int>& front(){
+			const uint16_t *d = &deltas[head*width];
+			for(size_t i=0; i<width; i++){
+				costs[i] = root[i] + d[i];
+			}
+			return costs;
 		}
-		std::vector<pair_1> roots;
-		std::vector<int> depths;
-		int max_depth;
 
-		for(int i=0; i<mdds_list.size(); i++){
-			roots.push_back(mdds_list[i].get_start());
-			depths.push_back(mdds_list[i].get_depth());
-			max_depth = std::max(max_depth, mdds_list[i].get_depth());
+		// total cost increment of the front node over the root
+		int front_level() const {	return level;	}
+
+		// removes the front node; its children are queued if expand is set
+		void pop(bool expand){
+			if(expand){
+				for(size_t i=0; i<width; i++){
+					child.assign(deltas.begin() + head*width, deltas.begin() + (head+1)*width);
+					child[i]++;
+					size_t slot = find_slot(child.data());
+					if(slots[slot] != empty_slot)	continue;
+					deltas.insert(deltas.end(), child.begin(), child.end());
+					slots[slot] = num_next++;
+					nodes_generated++;
+					if(2*num_next > slots.size())	grow();
+				}
+			}
+			if(++head == level_end){
+				// the next level becomes the current one
+				deltas.erase(deltas.begin(), deltas.begin() + level_end*width);
+				head = 0;
+				level_end = num_next;
+				num_next = 0;
+				level++;
+				std::fill(slots.begin(), slots.end(), empty_slot);
+			}
 		}
-		std::pair<std::vector<std::pair<std::vector<pair_1>, int> >, std::set<std::pair<std::vector<pair_1>, int> > > sol = joint_mdd_dfs_return_solution(mdds_list, max_depth, {roots, 0}, std::set<std::pair<std::vector<pair_1>, int> >());
-		return sol.first;
-	}
 
-	std::vector<std::vector<pair_1> > joint_mdd_nodes_to_list_of_paths(std::vector<std::pair<std::vector<pair_1>, int> > mdd_nodes){
-		if(!mdd_nodes.size() or !mdd_nodes[0].first.size())	return std::vector<std::vector<pair_1> >();
+		// distinct nodes queued so far, including the root
+		size_t get_nodes_generated() const {	return nodes_generated;	}
+
+	private:
+		static constexpr uint32_t empty_slot = UINT32_MAX;
 
-		int num_agents = mdd_nodes[0].first.size();
+		const uint16_t* next_level_node(uint32_t n) const {	return &deltas[(level_end + n)*width];	}
 
-		std::vector<std::vector<pair_1> > paths(num_agents, std::vector<pair_1>());
-		for(auto i:mdd_nodes){
-			for(int j=0; j<i.first.size(); j++){
-				paths[j].push_back(i.first[j]);
+		size_t hash_key(const uint16_t *k) const {
+			uint64_t hash = 0x9E3779B97F4A7C15ULL;
+			for(size_t i=0; i<width; i++){
+				hash = (hash ^ k[i])*0xFF51AFD7ED558CCDULL;
+				hash ^= hash >> 32;
 			}
+			return hash;
 		}
-		return paths;
-	}
 
-	std::vector<std::vector<pair_1> > find_solution_in_joint_mdd(std::vector<MDD> mdds_list){
-		std::vector<std::pair<std::vector<pair_1>, int> > sol = is_solution_in_joint_mdd(mdds_list);
-		return joint_mdd_nodes_to_list_of_paths(sol);
-	}
+		// slot holding the node of the next level, or the empty slot where it belongs
+		size_t find_slot(const uint16_t *k) const {
+			size_t mask = slots.size() - 1;
+			size_t i = hash_key(k) & mask;
+			while(slots[i] != empty_slot && !std::equal(k, k + width, next_level_node(slots[i]))){
+				i = (i + 1) & mask;
+			}
+			return i;
+		}
 
-	bool node_has_exceeded_upper_bound(TreeNode* node, long long upper_bound){
-		int node_cost = node->get_costs_sum();
-		return node_cost > upper_bound;
-	}
+		void grow(){
+			slots.assign(2*slots.size(), empty_slot);
+			for(uint32_t n=0; n<num_next; n++){
+				slots[find_slot(next_level_node(n))] = n;
+			}
+		}
+
+		std::vector<int> root;
+		size_t width;
+		// the current level is deltas[0 .. level_end*width), of which the first head nodes are done; the next level follows
+		size_t head, level_end;
+		uint32_t num_next;
+		int level;
+		size_t nodes_generated;
+		std::vector<uint32_t> slots;
+		std::vector<int> costs;
+		std::vector<uint16_t> deltas, child;
+	};
 
 	template<typename Mapf>
 	class ICTS{
 	public:
-		ICTS()	{}
+		ICTS(size_t num_threads = 1):
+			nodes_generated(0),
+			nodes_pruned(0),
+			nodes_expanded(0),
+			pool(num_threads),
+			pair_searches(pool.size()),
+			pair_mdds(pool.size(), std::vector<mdd_at_depth>(2))	{}
+
+		// distances of all cells to each goal, e.g. tables shared with other solvers; search() computes them otherwise
+		void set_goal_distances(const std::vector<const uint16_t*> &tables){	goal_tables = tables;	}
+
+		/*
+		Called before every ICT node with the nodes expanded so far and the
+		cost of the node, a lower bound on the optimal cost, and during long
+		joint searches. The search gives up and returns false as soon as it
+		returns true.
+		*/
+		void set_interrupt(std::function<bool(size_t, int)> f){	interrupt = f;	}
+
 		bool search(Mapf mapf, std::vector<pair_1 > starts_vec, std::pair<int, std::vector<std::vector<pair_1 > > > *solution){
-			obstacles = mapf.get_obstacles();
 			goals = mapf.get_goals();
 			starts = starts_vec;
-			x = mapf.get_x();
-			y = mapf.get_y();
-			long long upper_bound = (goals.size() * goals.size()) * generate_map();
-			compute_heuristics();
-			std::vector<int> optimal_cost = find_shortest_path(starts);
+			map = grid(mapf.get_x(), mapf.get_y(), mapf.get_obstacles());
+			long long upper_bound = (goals.size() * goals.size()) * map.num_free();
 
-			IncreasingCostTree ict(temp_map, goals, starts, optimal_cost);
+			nodes_generated = 0;
+			nodes_pruned = 0;
+			nodes_expanded = 0;
 
-			std::deque<TreeNode*> open_list = ict.get_open_list();
-			std::map<pair_1, MDD> mdd_cache;
-			int nodes_expanded = 0;
+			std::vector<int> optimal_cost;
+			if(!build_mdds(optimal_cost)){
+				return false;
+			}
 
-			auto icts_start = std::chrono::system_clock::now();
+			increasing_cost_tree ict(optimal_cost);
+			int root_cost = std::accumulate(optimal_cost.begin(), optimal_cost.end(), 0);
 
-			while(!open_list.empty()){
-				TreeNode* current_node = ict.get_next_node_to_expand();
-				std::vector<int> node_cost = current_node->get_costs();
+			int lower_bound = root_cost;
+			if(interrupt){
+				joint_search.set_interrupt([&](){	return interrupt(nodes_expanded, lower_bound);	});
+			}else{
+				joint_search.set_interrupt(nullptr);
+			}
 
-				if(std::chrono::duration<double>(std::chrono::system_clock::now() - icts_start).count() > 300){
-					return false;
+			while(!ict.empty()){
+				lower_bound = root_cost + ict.front_level();
+				if(interrupt && interrupt(nodes_expanded, lower_bound)){
+					break;
+				}
+				// levels come in increasing order, so no later node is within the bound either
+				if(lower_bound > upper_bound){
+					break;
 				}
 
-				if(!node_has_exceeded_upper_bound(current_node, upper_bound)){
-					std::vector<std::vector<pair_1> > solution_paths = find_paths_for_agents_for_given_cost(node_cost, mdd_cache);
-					if(solution_paths.size()){
-						solution->first = 0;
-						for(int i=0; i<solution_paths.size(); i++){
-							solution->first += solution_paths[i].size();
-						}
-						solution->second = solution_paths;
-						return true;
-					} else {
-						ict.expand_next_node();
-						nodes_expanded++;
-					}
+				const std::vector<int> &node_cost = ict.front();
+				extend_mdds(node_cost);
+				if(!pairs_have_solutions(node_cost)){
+					nodes_pruned++;
+				}else if(find_paths_for_agents_for_given_cost(node_cost, &solution->second)){
+					solution->first = lower_bound;
+					nodes_generated = ict.get_nodes_generated();
+					return true;
+				}else if(joint_search.was_interrupted()){
+					break;
 				}
-				ict.pop_next_node_to_expand();
+				ict.pop(true);
+				nodes_expanded++;
 			}
 
+			nodes_generated = ict.get_nodes_generated();
 			return false;
 		}
 
-		std::vector<std::vector<pair_1> > find_paths_for_agents_for_given_cost(std::vector<int> agent_path_costs, std::map<pair_1, MDD> &mdd_cache){
-			std::vector<MDD> mdds;
-			for(int i=0; i<agent_path_costs.size(); i++){
-				pair_1 agent_depth_key = {i, agent_path_costs[i]};
-				if(mdd_cache.find(agent_depth_key) == mdd_cache.end()){
-					pair_1 agent_prev_depth_key = {i, agent_path_costs[i]-1};
-					if(mdd_cache.find(agent_prev_depth_key) != mdd_cache.end()){
-						MDD new_mdd(i, starts[i], goals[i], temp_map, agent_path_costs[i], mdd_cache[agent_prev_depth_key]);
-						mdds.push_back(new_mdd);
-						mdd_cache[agent_depth_key] = new_mdd;
-					} else {
-						MDD new_mdd(i, starts[i], goals[i], temp_map, agent_path_costs[i]);
-						mdds.push_back(new_mdd);
-						mdd_cache[agent_depth_key] = new_mdd;
-					}
-				} else {
-					mdds.push_back(mdd_cache[agent_depth_key]);
-				}
-			}
+		// ICT nodes queued by the last search, including the root
+		size_t get_nodes_generated() const {	return nodes_generated;	}
+		// ICT nodes of the last search rejected by the pairwise checks, without a full joint search
+		size_t get_nodes_pruned() const {	return nodes_pruned;	}
+		size_t get_nodes_expanded() const {	return nodes_expanded;	}
 
-			return find_solution_in_joint_mdd(mdds);
+		void extend_mdds(const std::vector<int> &agent_path_costs){
+			for(size_t i=0; i<agent_path_costs.size(); i++){
+				mdds_by_agent[i].extend_to(agent_path_costs[i]);
+			}
 		}
 
-		int generate_map(){
-			int num_of_open_spaces = x * y;
-			temp_map.resize(x);
-			for(int i=0; i<x; i++){
-				temp_map[i] = std::vector<bool>(y, false);
-			}
-			for(int i=0; i<obstacles.size(); i++){
-				temp_map[obstacles[i].first][obstacles[i].second] = true;
-				num_of_open_spaces--;
+		bool find_paths_for_agents_for_given_cost(const std::vector<int> &agent_path_costs, std::vector<std::vector<pair_1> > *paths){
+			mdds.clear();
+			for(size_t i=0; i<agent_path_costs.size(); i++){
+				mdds.push_back({&mdds_by_agent[i], agent_path_costs[i]});
 			}
-			return num_of_open_spaces;
+
+			return joint_search.find(mdds, paths);
 		}
 
-		void compute_heuristics(){
-			heuristics.resize(goals.size());
-			for(int i=0; i<x; i++){
-				for(int j=0; j<y; j++){
-					if(temp_map[i][j] == false){
-						//not an obstacle
-						for(int k=0; k<goals.size(); k++){
-							heuristics[k][{i, j}] = manhattan_distance({i, j}, goals[i]);
-						}
+		/*
+		Pairwise pruning: false if some two agents have no conflict-free paths
+		at their costs in this node, in which case all agents have none either.
+		Results are cached by (i, cost_i, j, cost_j); the pairs not in the cache
+		are checked in parallel and the remaining checks are skipped once one
+		of them fails. The MDDs must already be extended to the costs.
+		*/
+		bool pairs_have_solutions(const std::vector<int> &costs){
+			pending.clear();
+			for(size_t i=0; i<costs.size(); i++){
+				for(size_t j=i+1; j<costs.size(); j++){
+					auto it = pair_cache.find(pair_key(i, costs[i], j, costs[j]));
+					if(it == pair_cache.end()){
+						pending.push_back({int(i), int(j)});
+					}else if(!it->second){
+						return false;
 					}
 				}
 			}
-		}
-
-		int manhattan_distance(pair_1 a, pair_1 b){
-			return abs(a.first - b.first) + abs(a.second - b.second);
-		}
 
-		struct compare_node{
-			bool operator()(const pair_3 & n1, const pair_3 & n2) const{
-				return n1.first > n2.first;
+			std::atomic<bool> failed(false);
+			pending_results.assign(pending.size(), -1);
+			pool.parallel_for(pending.size(), [&](size_t k, size_t worker){
+				if(failed)	return;
+				int i = pending[k].first, j = pending[k].second;
+				std::vector<mdd_at_depth> &pair = pair_mdds[worker];
+				pair[0] = {&mdds_by_agent[i], costs[i]};
+				pair[1] = {&mdds_by_agent[j], costs[j]};
+				pending_results[k] = pair_searches[worker].find(pair, NULL);
+				if(!pending_results[k])	failed = true;
+			});
+			for(size_t k=0; k<pending.size(); k++){
+				if(pending_results[k] != -1){
+					int i = pending[k].first, j = pending[k].second;
+					pair_cache[pair_key(i, costs[i], j, costs[j])] = pending_results[k];
+				}
 			}
-		};
-
-		std::vector<int> find_shortest_path(std::vector<pair_1 > starts){
-			std::vector<int> path_lengths(starts.size());
-
-			for(int i=0; i<starts.size(); i++){
-				std::vector< std::vector<int> > visited(x, std::vector<int> (y, -1));
-				pair_1 goal= goals[i];
-
-				std::priority_queue<pair_3, std::vector<pair_3>, std::greater<pair_3> > pq;
-				//boost::heap::fibonacci_heap<pair_3, boost::heap::compare<compare_node> > heap;	//Use anything in the future
-				pq.push(std::make_pair(manhattan_distance(starts[i], goals[i]), std::make_pair(0, starts[i]))); 
-
-				while(!pq.empty()){
-					pair_3 node = pq.top();
-					pq.pop();
-
-					int g = node.second.first;
-					int node_x = node.second.second.first;
-					int node_y = node.second.second.second;
-
-					if(visited[node_x][node_y] != -1)	continue;
-
-					if(node.second.second == goal){
-						path_lengths[i] = g;
-						break;
-					}
+			return !failed;
+		}
 
-					visited[node_x][node_y] = g;
+		static uint64_t pair_key(int i, int cost_i, int j, int cost_j){
+			return (uint64_t(i) << 48) | (uint64_t(uint16_t(cost_i)) << 32) | (uint64_t(j) << 16) | uint16_t(cost_j);
+		}
 
-					for(int i=0; i<op.size(); i++){
-						int neigh_x = node_x + op[i].first;
-						int neigh_y = node_y + op[i].second;
-						if(neigh_x >= 0 && neigh_x < x && neigh_y >= 0 && neigh_y < y && temp_map[neigh_x][neigh_y] == false && visited[neigh_x][neigh_y] == -1){
-							pair_1 neigh = std::make_pair(neigh_x, neigh_y);
-							int f = manhattan_distance(neigh, goal) + g + 1;
-							pq.push(std::make_pair(f, std::make_pair(g+1, neigh)));
-						}
-					}
+		// distance tables and one MDD per agent at its shortest path length, written to optimal_cost
+		bool build_mdds(std::vector<int> &optimal_cost){
+			int cells = map.size();
+			from_start.resize(starts.size()*cells);
+			if(goal_tables.size() != goals.size()){
+				to_goal.resize(goals.size()*cells);
+				goal_tables.clear();
+				for(size_t i=0; i<goals.size(); i++){
+					map.bfs(map.index(goals[i]), &to_goal[i*cells]);
+					goal_tables.push_back(&to_goal[i*cells]);
 				}
 			}
 
-			return path_lengths;
+			mdds_by_agent.clear();
+			for(size_t i=0; i<starts.size(); i++){
+				int start = map.index(starts[i]);
+				if(map.is_blocked(start) || goal_tables[i][start] == unreachable)	return false;
+				map.bfs(start, &from_start[i*cells]);
+				optimal_cost.push_back(goal_tables[i][start]);
+				mdds_by_agent.emplace_back(map, start, map.index(goals[i]), &from_start[i*cells], goal_tables[i], optimal_cost.back());
+			}
+			return true;
 		}
+
 	private:
-		int x, y;
-		std::vector<pair_1> obstacles;
+		size_t nodes_generated, nodes_pruned, nodes_expanded;
+		grid map;
 		std::vector<pair_1> goals;
 		std::vector<pair_1> starts;
-		std::vector<std::map<pair_1, int> > heuristics;
-		std::vector<std::vector<bool> > temp_map;
-		std::vector<pair_1> op = {{0,0}, {-1,0}, {0,1}, {1,0}, {0,-1}};
+		// from_start of agent i is [i*cells, (i+1)*cells), to_goal likewise when computed here
+		std::vector<uint16_t> from_start, to_goal;
+		std::vector<const uint16_t*> goal_tables;
+		// extended in place to the largest cost of each agent seen so far
+		std::vector<MDD> mdds_by_agent;
+		std::vector<mdd_at_depth> mdds;
+		joint_mdd_search joint_search;
+		worker_pool pool;
+		// one search and one pair of MDDs per worker of the pool
+		std::vector<joint_mdd_search> pair_searches;
+		std::vector<std::vector<mdd_at_depth> > pair_mdds;
+		std::unordered_map<uint64_t, bool> pair_cache;
+		std::vector<pair_1> pending;
+		std::vector<signed char> pending_results;
+		std::function<bool(size_t, int)> interrupt;
 	};
 }
 
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <unordered_set>
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
@@ -83,6 +84,9 @@ class Environment {
 
   bool isSolution(const State& s) { return s == m_goal; }
 
+  // dense id of a cell; lets AStar use flat arrays
+  size_t denseIndex(const State& s) { return s.x * m_dimy + s.y; }
+
   void getNeighbors(const State& s,
                     std::vector<Neighbor<State, Action, int> >& neighbors) {
     neighbors.clear();
@@ -1,5 +1,7 @@
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <unordered_set>
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
@@ -12,6 +14,7 @@
 using libMultiRobotPlanning::CBS;
 using libMultiRobotPlanning::Neighbor;
 using libMultiRobotPlanning::PlanResult;
+using libMultiRobotPlanning::SharedSolution;
 
 struct State {
   State(int time, int x, int y) : time(time), x(x), y(y) {}
@@ -188,18 +191,19 @@ struct Constraints {
                            other.edgeConstraints.end());
   }
 
-  bool overlap(const Constraints& other) {
-    std::vector<VertexConstraint> vertexIntersection;
-    std::vector<EdgeConstraint> edgeIntersection;
-    std::set_intersection(vertexConstraints.begin(), vertexConstraints.end(),
-                          other.vertexConstraints.begin(),
-                          other.vertexConstraints.end(),
-                          std::back_inserter(vertexIntersection));
-    std::set_intersection(edgeConstraints.begin(), edgeConstraints.end(),
-                          other.edgeConstraints.begin(),
-                          other.edgeConstraints.end(),
-                          std::back_inserter(edgeIntersection));
-    return !vertexIntersection.empty() || !edgeIntersection.empty();
+  bool overlap(const Constraints& other) const {
+    // std::set_intersection requires sorted ranges, so probe the hash sets
+    for (const auto& vc : other.vertexConstraints) {
+      if (vertexConstraints.count(vc)) {
+        return true;
+      }
+    }
+    for (const auto& ec : other.edgeConstraints) {
+      if (edgeConstraints.count(ec)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   friend std::ostream& operator<<(std::ostream& os, const Constraints& c) {
@@ -283,6 +287,11 @@ class Environment {
            std::abs(s.y - m_goals[m_agentIdx].y);
   }
 
+  // dense id of a (time, x, y) state; lets AStar use flat arrays
+  size_t denseIndex(const State& s) {
+    return (size_t(s.time) * m_dimx + s.x) * m_dimy + s.y;
+  }
+
   bool isSolution(const State& s) {
     return s.x == m_goals[m_agentIdx].x && s.y == m_goals[m_agentIdx].y &&
            s.time > m_lastGoalConstraint;
@@ -333,7 +342,7 @@ class Environment {
   }
 
   bool getFirstConflict(
-      const std::vector<PlanResult<State, Action, int> >& solution,
+      const SharedSolution<State, Action, int>& solution,
       Conflict& result) {
     int max_t = 0;
     for (const auto& sol : solution) {
@@ -385,6 +394,33 @@ class Environment {
     return false;
   }
 
+  int countConflicts(const SharedSolution<State, Action, int>& solution) {
+    int max_t = 0;
+    for (const auto& sol : solution) {
+      max_t = std::max<int>(max_t, sol.states.size() - 1);
+    }
+
+    int numConflicts = 0;
+    for (int t = 0; t < max_t; ++t) {
+      for (size_t i = 0; i < solution.size(); ++i) {
+        State state1a = getState(i, solution, t);
+        State state1b = getState(i, solution, t + 1);
+        for (size_t j = i + 1; j < solution.size(); ++j) {
+          State state2a = getState(j, solution, t);
+          State state2b = getState(j, solution, t + 1);
+          if (state1a.equalExceptTime(state2a)) {
+            ++numConflicts;
+          }
+          if (state1a.equalExceptTime(state2b) &&
+              state1b.equalExceptTime(state2a)) {
+            ++numConflicts;
+          }
+        }
+      }
+    }
+    return numConflicts;
+  }
+
   void createConstraintsFromConflict(
       const Conflict& conflict, std::map<size_t, Constraints>& constraints) {
     if (conflict.type == Conflict::Vertex) {
@@ -418,7 +454,7 @@ class Environment {
 
  private:
   State getState(size_t agentIdx,
-                 const std::vector<PlanResult<State, Action, int> >& solution,
+                 const SharedSolution<State, Action, int>& solution,
                  size_t t) {
     assert(agentIdx < solution.size());
     if (t < solution[agentIdx].states.size()) {
@@ -574,11 +610,20 @@ int main(int argc, char* argv[]) {
   po::options_description desc("Allowed options");
   std::string inputFile;
   std::string outputFile;
+  size_t numThreads;
+  size_t speculativeExpansions;
+  bool bypass;
   desc.add_options()("help", "produce help message")(
       "input,i", po::value<std::string>(&inputFile)->required(),
       "input file (YAML)")("output,o",
                            po::value<std::string>(&outputFile)->required(),
-                           "output file (YAML)");
+                           "output file (YAML)")(
+      "threads,t", po::value<size_t>(&numThreads)->default_value(1),
+      "number of threads for low-level searches")(
+      "speculative,k",
+      po::value<size_t>(&speculativeExpansions)->default_value(1),
+      "number of high-level nodes expanded per round")(
+      "bypass,b", po::bool_switch(&bypass), "adopt cheaper children's paths");
 
   try {
     po::variables_map vm;
@@ -618,7 +663,16 @@ int main(int argc, char* argv[]) {
   }
 
   Environment mapf(dimx, dimy, obstacles, goals);
-  CBS<State, Action, int, Conflict, Constraints, Environment> cbs(mapf);
+  // one environment per thread, since the low-level context is not shared
+  std::vector<std::unique_ptr<Environment> > workers;
+  std::vector<Environment*> lowLevelEnvs(1, &mapf);
+  for (size_t k = 1; k < numThreads; ++k) {
+    workers.emplace_back(new Environment(dimx, dimy, obstacles, goals));
+    lowLevelEnvs.push_back(workers.back().get());
+  }
+  CBS<State, Action, int, Conflict, Constraints, Environment> cbs(
+      mapf, lowLevelEnvs, speculativeExpansions);
+  cbs.setBypass(bypass);
   std::vector<PlanResult<State, Action, int> > solution;
 
   Timer timer;
@@ -640,7 +694,11 @@ int main(int argc, char* argv[]) {
     out << "  makespan: " << makespan << std::endl;
     out << "  runtime: " << timer.elapsedSeconds() << std::endl;
     out << "  highLevelExpanded: " << mapf.highLevelExpanded() << std::endl;
-    out << "  lowLevelExpanded: " << mapf.lowLevelExpanded() << std::endl;
+    int lowLevelExpanded = 0;
+    for (const Environment* env : lowLevelEnvs) {
+      lowLevelExpanded += env->lowLevelExpanded();
+    }
+    out << "  lowLevelExpanded: " << lowLevelExpanded << std::endl;
     out << "schedule:" << std::endl;
     for (size_t a = 0; a < solution.size(); ++a) {
       // std::cout << "Solution for: " << a << std::endl;
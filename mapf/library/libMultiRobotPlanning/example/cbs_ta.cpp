@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <unordered_set>
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
@@ -13,6 +14,7 @@
 using libMultiRobotPlanning::CBSTA;
 using libMultiRobotPlanning::Neighbor;
 using libMultiRobotPlanning::PlanResult;
+using libMultiRobotPlanning::SharedSolution;
 using libMultiRobotPlanning::NextBestAssignment;
 
 struct State {
@@ -190,18 +192,19 @@ struct Constraints {
                            other.edgeConstraints.end());
   }
 
-  bool overlap(const Constraints& other) {
-    std::vector<VertexConstraint> vertexIntersection;
-    std::vector<EdgeConstraint> edgeIntersection;
-    std::set_intersection(vertexConstraints.begin(), vertexConstraints.end(),
-                          other.vertexConstraints.begin(),
-                          other.vertexConstraints.end(),
-                          std::back_inserter(vertexIntersection));
-    std::set_intersection(edgeConstraints.begin(), edgeConstraints.end(),
-                          other.edgeConstraints.begin(),
-                          other.edgeConstraints.end(),
-                          std::back_inserter(edgeIntersection));
-    return !vertexIntersection.empty() || !edgeIntersection.empty();
+  bool overlap(const Constraints& other) const {
+    // std::set_intersection requires sorted ranges, so probe the hash sets
+    for (const auto& vc : other.vertexConstraints) {
+      if (vertexConstraints.count(vc)) {
+        return true;
+      }
+    }
+    for (const auto& ec : other.edgeConstraints) {
+      if (edgeConstraints.count(ec)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   friend std::ostream& operator<<(std::ostream& os, const Constraints& c) {
@@ -310,6 +313,11 @@ class Environment {
     }
   }
 
+  // dense id of a (time, x, y) state; lets AStar use flat arrays
+  size_t denseIndex(const State& s) {
+    return (size_t(s.time) * m_dimx + s.x) * m_dimy + s.y;
+  }
+
   bool isSolution(const State& s) {
     bool atGoal = true;
     if (m_goal != nullptr) {
@@ -367,7 +375,7 @@ class Environment {
   }
 
   bool getFirstConflict(
-      const std::vector<PlanResult<State, Action, int> >& solution,
+      const SharedSolution<State, Action, int>& solution,
       Conflict& result) {
     int max_t = 0;
     for (const auto& sol : solution) {
@@ -470,7 +478,7 @@ class Environment {
 
  private:
   State getState(size_t agentIdx,
-                 const std::vector<PlanResult<State, Action, int> >& solution,
+                 const SharedSolution<State, Action, int>& solution,
                  size_t t) {
     assert(agentIdx < solution.size());
     if (t < solution[agentIdx].states.size()) {
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <memory>
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
@@ -12,6 +13,7 @@
 using libMultiRobotPlanning::ECBS;
 using libMultiRobotPlanning::Neighbor;
 using libMultiRobotPlanning::PlanResult;
+using libMultiRobotPlanning::SharedSolution;
 
 struct State {
   State(int time, int x, int y) : time(time), x(x), y(y) {}
@@ -188,18 +190,19 @@ struct Constraints {
                            other.edgeConstraints.end());
   }
 
-  bool overlap(const Constraints& other) {
-    std::vector<VertexConstraint> vertexIntersection;
-    std::vector<EdgeConstraint> edgeIntersection;
-    std::set_intersection(vertexConstraints.begin(), vertexConstraints.end(),
-                          other.vertexConstraints.begin(),
-                          other.vertexConstraints.end(),
-                          std::back_inserter(vertexIntersection));
-    std::set_intersection(edgeConstraints.begin(), edgeConstraints.end(),
-                          other.edgeConstraints.begin(),
-                          other.edgeConstraints.end(),
-                          std::back_inserter(edgeIntersection));
-    return !vertexIntersection.empty() || !edgeIntersection.empty();
+  bool overlap(const Constraints& other) const {
+    // std::set_intersection requires sorted ranges, so probe the hash sets
+    for (const auto& vc : other.vertexConstraints) {
+      if (vertexConstraints.count(vc)) {
+        return true;
+      }
+    }
+    for (const auto& ec : other.edgeConstraints) {
+      if (edgeConstraints.count(ec)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   friend std::ostream& operator<<(std::ostream& os, const Constraints& c) {
@@ -281,7 +284,7 @@ class Environment {
   // low-level
   int focalStateHeuristic(
       const State& s, int /*gScore*/,
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
     int numConflicts = 0;
     for (size_t i = 0; i < solution.size(); ++i) {
       if (i != m_agentIdx && !solution[i].states.empty()) {
@@ -297,7 +300,7 @@ class Environment {
   // low-level
   int focalTransitionHeuristic(
       const State& s1a, const State& s1b, int /*gScoreS1a*/, int /*gScoreS1b*/,
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
     int numConflicts = 0;
     for (size_t i = 0; i < solution.size(); ++i) {
       if (i != m_agentIdx && !solution[i].states.empty()) {
@@ -313,7 +316,7 @@ class Environment {
 
   // Count all conflicts
   int focalHeuristic(
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
     int numConflicts = 0;
 
     int max_t = 0;
@@ -399,7 +402,7 @@ class Environment {
   }
 
   bool getFirstConflict(
-      const std::vector<PlanResult<State, Action, int> >& solution,
+      const SharedSolution<State, Action, int>& solution,
       Conflict& result) {
     int max_t = 0;
     for (const auto& sol : solution) {
@@ -484,7 +487,7 @@ class Environment {
 
  private:
   State getState(size_t agentIdx,
-                 const std::vector<PlanResult<State, Action, int> >& solution,
+                 const SharedSolution<State, Action, int>& solution,
                  size_t t) {
     assert(agentIdx < solution.size());
     if (t < solution[agentIdx].states.size()) {
@@ -528,13 +531,18 @@ int main(int argc, char* argv[]) {
   std::string inputFile;
   std::string outputFile;
   float w;
+  size_t numThreads;
+  bool bypass;
   desc.add_options()("help", "produce help message")(
       "input,i", po::value<std::string>(&inputFile)->required(),
       "input file (YAML)")("output,o",
                            po::value<std::string>(&outputFile)->required(),
                            "output file (YAML)")(
       "suboptimality,w", po::value<float>(&w)->default_value(1.0),
-      "suboptimality bound");
+      "suboptimality bound")(
+      "threads,t", po::value<size_t>(&numThreads)->default_value(1),
+      "number of threads for low-level searches")(
+      "bypass,b", po::bool_switch(&bypass), "adopt cheaper children's paths");
 
   try {
     po::variables_map vm;
@@ -574,7 +582,16 @@ int main(int argc, char* argv[]) {
   }
 
   Environment mapf(dimx, dimy, obstacles, goals);
-  ECBS<State, Action, int, Conflict, Constraints, Environment> cbs(mapf, w);
+  // one environment per thread, since the low-level context is not shared
+  std::vector<std::unique_ptr<Environment> > workers;
+  std::vector<Environment*> lowLevelEnvs(1, &mapf);
+  for (size_t k = 1; k < numThreads; ++k) {
+    workers.emplace_back(new Environment(dimx, dimy, obstacles, goals));
+    lowLevelEnvs.push_back(workers.back().get());
+  }
+  ECBS<State, Action, int, Conflict, Constraints, Environment> cbs(
+      mapf, w, lowLevelEnvs);
+  cbs.setBypass(bypass);
   std::vector<PlanResult<State, Action, int> > solution;
 
   Timer timer;
@@ -596,7 +613,11 @@ int main(int argc, char* argv[]) {
     out << "  makespan: " << makespan << std::endl;
     out << "  runtime: " << timer.elapsedSeconds() << std::endl;
     out << "  highLevelExpanded: " << mapf.highLevelExpanded() << std::endl;
-    out << "  lowLevelExpanded: " << mapf.lowLevelExpanded() << std::endl;
+    int lowLevelExpanded = 0;
+    for (const Environment* env : lowLevelEnvs) {
+      lowLevelExpanded += env->lowLevelExpanded();
+    }
+    out << "  lowLevelExpanded: " << lowLevelExpanded << std::endl;
     out << "schedule:" << std::endl;
     for (size_t a = 0; a < solution.size(); ++a) {
       // std::cout << "Solution for: " << a << std::endl;
@@ -13,6 +13,7 @@
 using libMultiRobotPlanning::ECBSTA;
 using libMultiRobotPlanning::Neighbor;
 using libMultiRobotPlanning::PlanResult;
+using libMultiRobotPlanning::SharedSolution;
 using libMultiRobotPlanning::NextBestAssignment;
 
 struct State {
@@ -190,18 +191,19 @@ struct Constraints {
                            other.edgeConstraints.end());
   }
 
-  bool overlap(const Constraints& other) {
-    std::vector<VertexConstraint> vertexIntersection;
-    std::vector<EdgeConstraint> edgeIntersection;
-    std::set_intersection(vertexConstraints.begin(), vertexConstraints.end(),
-                          other.vertexConstraints.begin(),
-                          other.vertexConstraints.end(),
-                          std::back_inserter(vertexIntersection));
-    std::set_intersection(edgeConstraints.begin(), edgeConstraints.end(),
-                          other.edgeConstraints.begin(),
-                          other.edgeConstraints.end(),
-                          std::back_inserter(edgeIntersection));
-    return !vertexIntersection.empty() || !edgeIntersection.empty();
+  bool overlap(const Constraints& other) const {
+    // std::set_intersection requires sorted ranges, so probe the hash sets
+    for (const auto& vc : other.vertexConstraints) {
+      if (vertexConstraints.count(vc)) {
+        return true;
+      }
+    }
+    for (const auto& ec : other.edgeConstraints) {
+      if (edgeConstraints.count(ec)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   friend std::ostream& operator<<(std::ostream& os, const Constraints& c) {
@@ -313,7 +315,7 @@ class Environment {
   // low-level
   int focalStateHeuristic(
       const State& s, int /*gScore*/,
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
     int numConflicts = 0;
     for (size_t i = 0; i < solution.size(); ++i) {
       if (i != m_agentIdx && solution[i].states.size() > 0) {
@@ -329,7 +331,7 @@ class Environment {
   // low-level
   int focalTransitionHeuristic(
       const State& s1a, const State& s1b, int /*gScoreS1a*/, int /*gScoreS1b*/,
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
     int numConflicts = 0;
     for (size_t i = 0; i < solution.size(); ++i) {
       if (i != m_agentIdx && solution[i].states.size() > 0) {
@@ -345,7 +347,7 @@ class Environment {
 
   // Count all conflicts
   int focalHeuristic(
-      const std::vector<PlanResult<State, Action, int> >& solution) {
+      const SharedSolution<State, Action, int>& solution) {
     int numConflicts = 0;
 
     int max_t = 0;
@@ -438,7 +440,7 @@ class Environment {
   }
 
   bool getFirstConflict(
-      const std::vector<PlanResult<State, Action, int> >& solution,
+      const SharedSolution<State, Action, int>& solution,
       Conflict& result) {
     int max_t = 0;
     for (const auto& sol : solution) {
@@ -541,7 +543,7 @@ class Environment {
 
  private:
   State getState(size_t agentIdx,
-                 const std::vector<PlanResult<State, Action, int> >& solution,
+                 const SharedSolution<State, Action, int>& solution,
                  size_t t) {
     assert(agentIdx < solution.size());
     if (t < solution[agentIdx].states.size()) {
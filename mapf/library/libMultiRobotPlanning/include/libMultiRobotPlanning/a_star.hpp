@@ -5,8 +5,13 @@
 #endif
 
 #include <boost/heap/d_ary_heap.hpp>
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "neighbor.hpp"
 #include "planresult.hpp"
@@ -19,6 +24,388 @@ namespace libMultiRobotPlanning {
   actions
 */
 
+template <typename State, typename Action, typename Cost, typename Environment,
+          typename StateHasher>
+class AStar;
+
+/*! \brief Reusable search state of AStar
+
+This class keeps the memory of an A* search alive between calls, such that
+repeated searches (e.g. the low-level searches of a conflict-based search)
+do not allocate once the buffers are large enough. It consists of
+  - an arena of search nodes; a node refers to its predecessor by index,
+  - an open-addressing hash table from states to node indices. Its slots are
+    stamped with a generation counter, so starting a new search invalidates
+    all entries without touching the table,
+  - the open list, which stores node indices only.
+
+A context is not thread-safe; use one context per thread.
+
+\tparam State Custom state for the search. Needs to be copy'able
+\tparam Action Custom action for the search. Needs to be copy'able
+\tparam Cost Custom Cost type (integer or floating point types)
+\tparam StateHasher A class to convert a state to a hash value. Default:
+   std::hash<State>
+*/
+template <typename State, typename Action, typename Cost,
+          typename StateHasher = std::hash<State> >
+class AStarContext {
+ public:
+  AStarContext() : m_generation(0), m_mask(0) {}
+
+  AStarContext(const AStarContext&) = delete;
+  AStarContext& operator=(const AStarContext&) = delete;
+
+ private:
+  template <typename, typename, typename, typename, typename>
+  friend class AStar;
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+  static constexpr size_t initialSlots = 1024;
+
+  struct HeapEntry {
+    HeapEntry(Cost fScore, Cost gScore, size_t node)
+        : fScore(fScore), gScore(gScore), node(node) {}
+
+    bool operator<(const HeapEntry& other) const {
+      // Sort order
+      // 1. lowest fScore
+      // 2. highest gScore
+
+      // Our heap is a maximum heap, so we invert the comperator function here
+      if (fScore != other.fScore) {
+        return fScore > other.fScore;
+      } else {
+        return gScore < other.gScore;
+      }
+    }
+
+    Cost fScore;
+    Cost gScore;
+    size_t node;
+  };
+
+#ifdef USE_FIBONACCI_HEAP
+  typedef typename boost::heap::fibonacci_heap<HeapEntry> openSet_t;
+#else
+  typedef typename boost::heap::d_ary_heap<HeapEntry, boost::heap::arity<2>,
+                                           boost::heap::mutable_<true> >
+      openSet_t;
+#endif
+  typedef typename openSet_t::handle_type heapHandle_t;
+
+  struct Node {
+    Node(const State& state, size_t hash, Cost fScore, Cost gScore,
+         size_t parent)
+        : state(state),
+          hash(hash),
+          fScore(fScore),
+          gScore(gScore),
+          parent(parent),
+          closed(false) {}
+
+    State state;
+    size_t hash;
+    Cost fScore;
+    Cost gScore;
+    size_t parent;
+    bool closed;
+    heapHandle_t handle;
+  };
+
+  struct Slot {
+    Slot() : generation(0), node(0) {}
+
+    unsigned int generation;
+    size_t node;
+  };
+
+  // forgets the previous search, but keeps all allocations
+  void reset() {
+    m_nodes.clear();
+    m_actions.clear();
+    m_open.clear();
+    if (m_slots.empty()) {
+      m_slots.resize(initialSlots);
+      m_mask = initialSlots - 1;
+    }
+    if (++m_generation == 0) {
+      for (Slot& slot : m_slots) {
+        slot.generation = 0;
+      }
+      m_generation = 1;
+    }
+  }
+
+  template <typename Environment>
+  size_t key(Environment& /*env*/, const State& s) const {
+    return m_hasher(s);
+  }
+
+  size_t find(size_t hash, const State& s) const {
+    for (size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+      const Slot& slot = m_slots[i];
+      if (slot.generation != m_generation) {
+        return npos;
+      }
+      if (m_nodes[slot.node].state == s) {
+        return slot.node;
+      }
+    }
+  }
+
+  // adds an open node for a state that is not part of the table yet
+  size_t insert(size_t hash, const State& s, Cost fScore, Cost gScore,
+                size_t parent) {
+    if (2 * (m_nodes.size() + 1) > m_slots.size()) {
+      grow();
+    }
+    size_t idx = m_nodes.size();
+    m_nodes.emplace_back(Node(s, hash, fScore, gScore, parent));
+    place(idx);
+    m_nodes[idx].handle = m_open.push(HeapEntry(fScore, gScore, idx));
+    return idx;
+  }
+
+  // lowers the cost of an open node
+  void decrease(size_t idx, Cost fScore, Cost gScore) {
+    Node& node = m_nodes[idx];
+    node.fScore = fScore;
+    node.gScore = gScore;
+    (*node.handle).fScore = fScore;
+    (*node.handle).gScore = gScore;
+    m_open.increase(node.handle);
+  }
+
+  // closes and returns the best open node, or npos if there is none
+  size_t pop() {
+    if (m_open.empty()) {
+      return npos;
+    }
+    size_t idx = m_open.top().node;
+    m_open.pop();
+    m_nodes[idx].closed = true;
+    return idx;
+  }
+
+  void place(size_t idx) {
+    size_t i = m_nodes[idx].hash & m_mask;
+    while (m_slots[i].generation == m_generation) {
+      i = (i + 1) & m_mask;
+    }
+    m_slots[i].generation = m_generation;
+    m_slots[i].node = idx;
+  }
+
+  void grow() {
+    m_slots.assign(2 * m_slots.size(), Slot());
+    m_mask = m_slots.size() - 1;
+    m_generation = 1;
+    for (size_t idx = 0; idx < m_nodes.size(); ++idx) {
+      place(idx);
+    }
+  }
+
+  std::vector<Node> m_nodes;
+  // action and its cost leading to node i + 1 (node 0 is the start)
+  std::vector<std::pair<Action, Cost> > m_actions;
+  std::vector<Slot> m_slots;
+  unsigned int m_generation;
+  size_t m_mask;
+  openSet_t m_open;
+  std::vector<Neighbor<State, Action, Cost> > m_neighbors;
+  StateHasher m_hasher;
+};
+
+/*! \brief Reusable search state of AStar for dense state spaces
+
+Used instead of AStarContext if the environment maps states to dense integer
+ids (see AStar) and costs are integral, e.g. for (time, x, y) states on a
+grid. The node of a state is found by indexing a paged array with the id of
+the state; pages are only allocated for the id ranges a search actually
+touches. The open list is a bucket queue over fScore; each bucket is a binary
+heap ordered by highest gScore. Outdated entries are skipped when they are
+popped, which replaces the decrease-key operation.
+
+\tparam State Custom state for the search. Needs to be copy'able
+\tparam Action Custom action for the search. Needs to be copy'able
+\tparam Cost Integral cost type
+*/
+template <typename State, typename Action, typename Cost>
+class DenseAStarContext {
+  static_assert(std::is_integral<Cost>::value,
+                "DenseAStarContext requires an integral Cost type");
+
+ public:
+  DenseAStarContext()
+      : m_generation(0), m_base(0), m_firstBucket(0), m_usedBuckets(0) {}
+
+  DenseAStarContext(const DenseAStarContext&) = delete;
+  DenseAStarContext& operator=(const DenseAStarContext&) = delete;
+
+ private:
+  template <typename, typename, typename, typename, typename>
+  friend class AStar;
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+  static constexpr size_t pageBits = 12;
+  static constexpr size_t pageSize = size_t(1) << pageBits;
+
+  struct Node {
+    Node(const State& state, Cost fScore, Cost gScore, size_t parent)
+        : state(state),
+          fScore(fScore),
+          gScore(gScore),
+          parent(parent),
+          closed(false) {}
+
+    State state;
+    Cost fScore;
+    Cost gScore;
+    size_t parent;
+    bool closed;
+  };
+
+  struct BucketEntry {
+    BucketEntry(Cost gScore, size_t node) : gScore(gScore), node(node) {}
+
+    // highest gScore first
+    bool operator<(const BucketEntry& other) const {
+      return gScore < other.gScore;
+    }
+
+    Cost gScore;
+    size_t node;
+  };
+
+  struct Slot {
+    uint32_t generation;
+    uint32_t node;
+  };
+
+  // forgets the previous search, but keeps all allocations
+  void reset() {
+    m_nodes.clear();
+    m_actions.clear();
+    for (size_t b = m_firstBucket; b < m_usedBuckets; ++b) {
+      m_buckets[b].clear();
+    }
+    m_firstBucket = 0;
+    m_usedBuckets = 0;
+    if (++m_generation == 0) {
+      for (auto& page : m_pages) {
+        if (page) {
+          std::fill(page.get(), page.get() + pageSize, Slot{0, 0});
+        }
+      }
+      m_generation = 1;
+    }
+  }
+
+  template <typename Environment>
+  size_t key(Environment& env, const State& s) const {
+    return env.denseIndex(s);
+  }
+
+  size_t find(size_t id, const State& /*s*/) const {
+    size_t page = id >> pageBits;
+    if (page >= m_pages.size() || !m_pages[page]) {
+      return npos;
+    }
+    const Slot& slot = m_pages[page][id & (pageSize - 1)];
+    return slot.generation == m_generation ? slot.node : npos;
+  }
+
+  // adds an open node for a state that is not part of the table yet
+  size_t insert(size_t id, const State& s, Cost fScore, Cost gScore,
+                size_t parent) {
+    size_t page = id >> pageBits;
+    if (page >= m_pages.size()) {
+      m_pages.resize(page + 1);
+    }
+    if (!m_pages[page]) {
+      m_pages[page].reset(new Slot[pageSize]());
+    }
+    size_t idx = m_nodes.size();
+    m_pages[page][id & (pageSize - 1)] = Slot{m_generation, uint32_t(idx)};
+    if (m_nodes.empty()) {
+      m_base = fScore;
+    }
+    m_nodes.emplace_back(Node(s, fScore, gScore, parent));
+    push(idx);
+    return idx;
+  }
+
+  // lowers the cost of an open node; the old bucket entry becomes outdated
+  void decrease(size_t idx, Cost fScore, Cost gScore) {
+    m_nodes[idx].fScore = fScore;
+    m_nodes[idx].gScore = gScore;
+    push(idx);
+  }
+
+  // closes and returns the best open node, or npos if there is none
+  size_t pop() {
+    for (; m_firstBucket < m_usedBuckets; ++m_firstBucket) {
+      std::vector<BucketEntry>& bucket = m_buckets[m_firstBucket];
+      while (!bucket.empty()) {
+        std::pop_heap(bucket.begin(), bucket.end());
+        BucketEntry entry = bucket.back();
+        bucket.pop_back();
+        Node& node = m_nodes[entry.node];
+        if (!node.closed && node.gScore == entry.gScore) {
+          node.closed = true;
+          return entry.node;
+        }
+      }
+    }
+    return npos;
+  }
+
+  void push(size_t idx) {
+    const Node& node = m_nodes[idx];
+    if (node.fScore < m_base) {
+      // only happens for inconsistent heuristics
+      size_t shift = m_base - node.fScore;
+      m_buckets.insert(m_buckets.begin(), shift, std::vector<BucketEntry>());
+      m_usedBuckets += shift;
+      m_firstBucket += shift;
+      m_base = node.fScore;
+    }
+    size_t b = node.fScore - m_base;
+    if (b >= m_buckets.size()) {
+      m_buckets.resize(b + 1);
+    }
+    m_usedBuckets = std::max(m_usedBuckets, b + 1);
+    m_firstBucket = std::min(m_firstBucket, b);
+    m_buckets[b].emplace_back(BucketEntry(node.gScore, idx));
+    std::push_heap(m_buckets[b].begin(), m_buckets[b].end());
+  }
+
+  std::vector<Node> m_nodes;
+  // action and its cost leading to node i + 1 (node 0 is the start)
+  std::vector<std::pair<Action, Cost> > m_actions;
+  std::vector<std::unique_ptr<Slot[]> > m_pages;
+  uint32_t m_generation;
+  // bucket b holds the open nodes with fScore m_base + b
+  std::vector<std::vector<BucketEntry> > m_buckets;
+  Cost m_base;
+  size_t m_firstBucket;
+  size_t m_usedBuckets;
+  std::vector<Neighbor<State, Action, Cost> > m_neighbors;
+};
+
+namespace detail {
+
+template <typename Environment, typename State, typename = void>
+struct hasDenseIndex : std::false_type {};
+
+template <typename Environment, typename State>
+struct hasDenseIndex<Environment, State,
+                     decltype(void(size_t(std::declval<Environment&>().denseIndex(
+                         std::declval<const State&>()))))> : std::true_type {};
+
+}  // namespace detail
+
 /*! \brief A* Algorithm to find the shortest path
 
 This class implements the A* algorithm. A* is an informed search algorithm
@@ -28,6 +415,14 @@ needsto be admissible.
 This class can either use a fibonacci heap, or a d-ary heap. The latter is the
 default. Define "USE_FIBONACCI_HEAP" to use the fibonacci heap instead.
 
+All memory used during a search lives in a Context. By default, every AStar
+object owns one, so consecutive calls of search() reuse it. Callers that
+create short-lived AStar objects can pass a long-lived context instead.
+
+If the environment provides `size_t denseIndex(const State& s)` and Cost is
+integral, the search uses a DenseAStarContext instead of an AStarContext. The
+ids should be small and dense, e.g. `time * numCells + cell` for grid states.
+
 \tparam State Custom state for the search. Needs to be copy'able
 \tparam Action Custom action for the search. Needs to be copy'able
 \tparam Cost Custom Cost type (integer or floating point types)
@@ -58,7 +453,18 @@ template <typename State, typename Action, typename Cost, typename Environment,
           typename StateHasher = std::hash<State> >
 class AStar {
  public:
-  AStar(Environment& environment) : m_env(environment) {}
+  typedef typename std::conditional<
+      detail::hasDenseIndex<Environment, State>::value &&
+          std::is_integral<Cost>::value,
+      DenseAStarContext<State, Action, Cost>,
+      AStarContext<State, Action, Cost, StateHasher> >::type Context;
+
+  /*! \param context search state to reuse; if nullptr, the search uses a
+     context owned by this object. An external context must outlive this
+     object and must not be used by two searches at the same time.
+  */
+  AStar(Environment& environment, Context* context = nullptr)
+      : m_env(environment), m_context(context ? *context : m_ownContext) {}
 
   bool search(const State& startState,
               PlanResult<State, Action, Cost>& solution, Cost initialCost = 0) {
@@ -67,92 +473,73 @@ class AStar {
     solution.actions.clear();
     solution.cost = 0;
 
-    openSet_t openSet;
-    std::unordered_map<State, fibHeapHandle_t, StateHasher> stateToHeap;
-    std::unordered_set<State, StateHasher> closedSet;
-    std::unordered_map<State, std::tuple<State, Action, Cost, Cost>,
-                       StateHasher>
-        cameFrom;
+    Context& ctx = m_context;
+    ctx.reset();
+    auto& nodes = ctx.m_nodes;
 
-    auto handle = openSet.push(
-        Node(startState, m_env.admissibleHeuristic(startState), initialCost));
-    stateToHeap.insert(std::make_pair<>(startState, handle));
-    (*handle).handle = handle;
+    size_t start = ctx.insert(ctx.key(m_env, startState), startState,
+                              m_env.admissibleHeuristic(startState),
+                              initialCost, Context::npos);
 
-    std::vector<Neighbor<State, Action, Cost> > neighbors;
+    std::vector<Neighbor<State, Action, Cost> >& neighbors = ctx.m_neighbors;
     neighbors.reserve(10);
 
-    while (!openSet.empty()) {
-      Node current = openSet.top();
-      m_env.onExpandNode(current.state, current.fScore, current.gScore);
+    for (size_t current = ctx.pop(); current != Context::npos;
+         current = ctx.pop()) {
+      Cost fScore = nodes[current].fScore;
+      Cost gScore = nodes[current].gScore;
+      m_env.onExpandNode(nodes[current].state, fScore, gScore);
 
-      if (m_env.isSolution(current.state)) {
+      if (m_env.isSolution(nodes[current].state)) {
         solution.states.clear();
         solution.actions.clear();
-        auto iter = cameFrom.find(current.state);
-        while (iter != cameFrom.end()) {
+        for (size_t idx = current; idx != start; idx = nodes[idx].parent) {
           solution.states.push_back(
-              std::make_pair<>(iter->first, std::get<3>(iter->second)));
-          solution.actions.push_back(std::make_pair<>(
-              std::get<1>(iter->second), std::get<2>(iter->second)));
-          iter = cameFrom.find(std::get<0>(iter->second));
+              std::make_pair<>(nodes[idx].state, nodes[idx].gScore));
+          solution.actions.push_back(ctx.m_actions[idx - 1]);
         }
         solution.states.push_back(std::make_pair<>(startState, initialCost));
         std::reverse(solution.states.begin(), solution.states.end());
         std::reverse(solution.actions.begin(), solution.actions.end());
-        solution.cost = current.gScore;
-        solution.fmin = current.fScore;
+        solution.cost = gScore;
+        solution.fmin = fScore;
 
         return true;
       }
 
-      openSet.pop();
-      stateToHeap.erase(current.state);
-      closedSet.insert(current.state);
-
       // traverse neighbors
       neighbors.clear();
-      m_env.getNeighbors(current.state, neighbors);
+      m_env.getNeighbors(nodes[current].state, neighbors);
       for (const Neighbor<State, Action, Cost>& neighbor : neighbors) {
-        if (closedSet.find(neighbor.state) == closedSet.end()) {
-          Cost tentative_gScore = current.gScore + neighbor.cost;
-          auto iter = stateToHeap.find(neighbor.state);
-          if (iter == stateToHeap.end()) {  // Discover a new node
-            Cost fScore =
-                tentative_gScore + m_env.admissibleHeuristic(neighbor.state);
-            auto handle =
-                openSet.push(Node(neighbor.state, fScore, tentative_gScore));
-            (*handle).handle = handle;
-            stateToHeap.insert(std::make_pair<>(neighbor.state, handle));
-            m_env.onDiscover(neighbor.state, fScore, tentative_gScore);
-            // std::cout << "  this is a new node " << fScore << "," <<
-            // tentative_gScore << std::endl;
-          } else {
-            auto handle = iter->second;
-            // std::cout << "  this is an old node: " << tentative_gScore << ","
-            // << (*handle).gScore << std::endl;
-            // We found this node before with a better path
-            if (tentative_gScore >= (*handle).gScore) {
-              continue;
-            }
-
-            // update f and gScore
-            Cost delta = (*handle).gScore - tentative_gScore;
-            (*handle).gScore = tentative_gScore;
-            (*handle).fScore -= delta;
-            openSet.increase(handle);
-            m_env.onDiscover(neighbor.state, (*handle).fScore,
-                             (*handle).gScore);
+        size_t key = ctx.key(m_env, neighbor.state);
+        size_t idx = ctx.find(key, neighbor.state);
+        if (idx != Context::npos && nodes[idx].closed) {
+          continue;
+        }
+        Cost tentative_gScore = gScore + neighbor.cost;
+        if (idx == Context::npos) {  // Discover a new node
+          Cost fScore =
+              tentative_gScore + m_env.admissibleHeuristic(neighbor.state);
+          ctx.insert(key, neighbor.state, fScore, tentative_gScore, current);
+          ctx.m_actions.push_back(
+              std::make_pair<>(neighbor.action, neighbor.cost));
+          m_env.onDiscover(neighbor.state, fScore, tentative_gScore);
+        } else {
+          // We found this node before with a better path
+          if (tentative_gScore >= nodes[idx].gScore) {
+            continue;
           }
 
+          // update f and gScore
+          Cost delta = nodes[idx].gScore - tentative_gScore;
+          ctx.decrease(idx, nodes[idx].fScore - delta, tentative_gScore);
+          m_env.onDiscover(neighbor.state, nodes[idx].fScore,
+                           nodes[idx].gScore);
+
           // Best path for this node so far
-          // TODO: this is not the best way to update "cameFrom", but otherwise
-          // default c'tors of State and Action are required
-          cameFrom.erase(neighbor.state);
-          cameFrom.insert(std::make_pair<>(
-              neighbor.state,
-              std::make_tuple<>(current.state, neighbor.action, neighbor.cost,
-                                tentative_gScore)));
+          nodes[idx].parent = current;
+          ctx.m_actions[idx - 1] =
+              std::make_pair<>(neighbor.action, neighbor.cost);
         }
       }
     }
@@ -160,56 +547,10 @@ class AStar {
     return false;
   }
 
- private:
-  struct Node {
-    Node(const State& state, Cost fScore, Cost gScore)
-        : state(state), fScore(fScore), gScore(gScore) {}
-
-    bool operator<(const Node& other) const {
-      // Sort order
-      // 1. lowest fScore
-      // 2. highest gScore
-
-      // Our heap is a maximum heap, so we invert the comperator function here
-      if (fScore != other.fScore) {
-        return fScore > other.fScore;
-      } else {
-        return gScore < other.gScore;
-      }
-    }
-
-    friend std::ostream& operator<<(std::ostream& os, const Node& node) {
-      os << "state: " << node.state << " fScore: " << node.fScore
-         << " gScore: " << node.gScore;
-      return os;
-    }
-
-    State state;
-
-    Cost fScore;
-    Cost gScore;
-
-#ifdef USE_FIBONACCI_HEAP
-    typename boost::heap::fibonacci_heap<Node>::handle_type handle;
-#else
-    typename boost::heap::d_ary_heap<Node, boost::heap::arity<2>,
-                                     boost::heap::mutable_<true> >::handle_type
-        handle;
-#endif
-  };
-
-#ifdef USE_FIBONACCI_HEAP
-  typedef typename boost::heap::fibonacci_heap<Node> openSet_t;
-  typedef typename openSet_t::handle_type fibHeapHandle_t;
-#else
-  typedef typename boost::heap::d_ary_heap<Node, boost::heap::arity<2>,
-                                           boost::heap::mutable_<true> >
-      openSet_t;
-  typedef typename openSet_t::handle_type fibHeapHandle_t;
-#endif
-
  private:
   Environment& m_env;
+  Context m_ownContext;
+  Context& m_context;
 };
 
 }  // namespace libMultiRobotPlanning
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <functional>
 #include <map>
+#include <memory>
 
 #include "a_star.hpp"
+#include "conflict_selection.hpp"
+#include "shared_constraints.hpp"
+#include "shared_solution.hpp"
+#include "thread_pool.hpp"
 
 namespace libMultiRobotPlanning {
 
@@ -59,11 +65,21 @@ constraints
     Fill the list of neighboring state for the given state s and the current
 agent.
 
-  - `bool getFirstConflict(const std::vector<PlanResult<State, Action, int> >&
-solution, Conflict& result)`\n
+  - `bool getFirstConflict(const SharedSolution<State, Action, int>& solution,
+Conflict& result)`\n
     Finds the first conflict for the given solution for each agent. Return true
 if a conflict was found and false otherwise.
 
+  - `bool getBestConflict(const SharedSolution<State, Action, int>& solution,
+const SharedConstraints<Constraints>& constraints, Conflict& result)`\n
+    Optional. If provided, it is used instead of getFirstConflict to choose the
+conflict to branch on, e.g. a cardinal one. Return true if a conflict was found
+and false otherwise.
+
+  - `int countConflicts(const SharedSolution<State, Action, int>& solution)`\n
+    Optional. Number of conflicts in the given solution; required for bypassing
+(see setBypass()).
+
   - `void createConstraintsFromConflict(const Conflict& conflict,
 std::map<size_t, Constraints>& constraints)`\n
     Create a list of constraints for the given conflict.
@@ -80,30 +96,88 @@ template <typename State, typename Action, typename Cost, typename Conflict,
           typename Constraints, typename Environment>
 class CBS {
  public:
-  CBS(Environment& environment) : m_env(environment) {}
+  CBS(Environment& environment)
+      : m_env(environment),
+        m_lowLevelEnvs(1, &environment),
+        m_pool(1),
+        m_speculativeExpansions(1),
+        m_bypass(false) {}
+
+  /*! Parallel high-level search
+
+    The low-level searches of all children generated in one round run
+    concurrently on a pool with one thread per entry of lowLevelEnvironments.
+    Worker k only calls the low-level functions of lowLevelEnvironments[k], so
+    every worker needs its own environment (setLowLevelContext mutates it);
+    the high-level functions are only called on environment.
+
+    If speculativeExpansions > 1, up to that many of the best nodes in open are
+    expanded per round. The returned solution is still optimal.
+  */
+  CBS(Environment& environment,
+      const std::vector<Environment*>& lowLevelEnvironments,
+      size_t speculativeExpansions = 1)
+      : m_env(environment),
+        m_lowLevelEnvs(lowLevelEnvironments),
+        m_pool(lowLevelEnvironments.size()),
+        m_speculativeExpansions(std::max<size_t>(speculativeExpansions, 1)),
+        m_bypass(false) {
+    if (m_lowLevelEnvs.empty()) {
+      m_lowLevelEnvs.push_back(&environment);
+    }
+  }
+
+  /*! Enables bypassing: if a child has the same cost as its parent but fewer
+     conflicts (see countConflicts), the parent adopts the child's path and is
+     put back into the open list instead of being split.
+  */
+  void setBypass(bool enabled) { m_bypass = enabled; }
+
+  /*! Called before every round of high-level expansions with the number of
+     high-level nodes expanded so far and the cost of the best node in open,
+     which is a lower bound on the optimal cost. The search gives up and
+     returns false as soon as it returns true.
+  */
+  void setInterrupt(std::function<bool(size_t, Cost)> interrupt) {
+    m_interrupt = interrupt;
+  }
 
   bool search(const std::vector<State>& initialStates,
               std::vector<PlanResult<State, Action, Cost> >& solution) {
     HighLevelNode start;
-    start.solution.resize(initialStates.size());
-    start.constraints.resize(initialStates.size());
+    start.solution = SharedSolution<State, Action, Cost>(initialStates.size());
+    start.constraints = SharedConstraints<Constraints>(initialStates.size());
     start.cost = 0;
     start.id = 0;
 
+    // low-level searches reuse the memory of earlier ones, one context per
+    // worker
+    while (m_searchContexts.size() < m_lowLevelEnvs.size()) {
+      m_searchContexts.emplace_back(new typename LowLevelSearch_t::Context());
+    }
+
+    // the agents of the root node are independent of each other
+    Constraints noConstraints;
+    std::vector<PlanResult<State, Action, Cost> > paths(initialStates.size());
+    std::vector<char> successes(initialStates.size());
+    m_pool.parallelFor(initialStates.size(), [&](size_t i, size_t worker) {
+      LowLevelEnvironment llenv(*m_lowLevelEnvs[worker], i, noConstraints);
+      LowLevelSearch_t lowLevel(llenv, m_searchContexts[worker].get());
+      successes[i] = lowLevel.search(initialStates[i], paths[i]);
+    });
     for (size_t i = 0; i < initialStates.size(); ++i) {
-      // if (   i < solution.size()
-      //     && solution[i].states.size() > 1) {
-      //   start.solution[i] = solution[i];
-      //   std::cout << "use existing solution for agent: " << i << std::endl;
-      // } else {
-      LowLevelEnvironment llenv(m_env, i, start.constraints[i]);
-      LowLevelSearch_t lowLevel(llenv);
-      bool success = lowLevel.search(initialStates[i], start.solution[i]);
-      if (!success) {
+      if (!successes[i]) {
         return false;
       }
-      // }
-      start.cost += start.solution[i].cost;
+      start.cost += paths[i].cost;
+      start.solution.set(i, std::move(paths[i]));
+    }
+    findConflicts(start);
+    if (!start.hasConflict) {
+      m_env.onExpandHighLevelNode(start.cost);
+      std::cout << "done; cost: " << start.cost << std::endl;
+      solution = start.solution.toVector();
+      return true;
     }
 
     // std::priority_queue<HighLevelNode> open;
@@ -116,55 +190,133 @@ class CBS {
 
     solution.clear();
     int id = 1;
+    std::vector<HighLevelNode> expanded;
+    std::vector<Child> children;
+    std::vector<char> bypassed;
+    size_t numExpanded = 0;
     while (!open.empty()) {
+      if (m_interrupt && m_interrupt(numExpanded, open.top().cost)) {
+        return false;
+      }
       HighLevelNode P = open.top();
       m_env.onExpandHighLevelNode(P.cost);
       // std::cout << "expand: " << P << std::endl;
 
       open.pop();
 
-      Conflict conflict;
-      if (!m_env.getFirstConflict(P.solution, conflict)) {
+      // conflicts are detected when a node is generated
+      if (!P.hasConflict) {
         std::cout << "done; cost: " << P.cost << std::endl;
-        solution = P.solution;
+        solution = P.solution.toVector();
         return true;
       }
 
+      expanded.clear();
+      expanded.emplace_back(P);
+      ++numExpanded;
+
+      // expand further nodes speculatively; no child can be cheaper than P,
+      // so a conflict-free node with the same cost as P is optimal as well
+      while (expanded.size() < m_speculativeExpansions && !open.empty()) {
+        const HighLevelNode& Q = open.top();
+        if (!Q.hasConflict) {
+          if (Q.cost == P.cost) {
+            m_env.onExpandHighLevelNode(Q.cost);
+            std::cout << "done; cost: " << Q.cost << std::endl;
+            solution = Q.solution.toVector();
+            return true;
+          }
+          break;
+        }
+        m_env.onExpandHighLevelNode(Q.cost);
+        expanded.emplace_back(Q);
+        ++numExpanded;
+        open.pop();
+      }
+
       // create additional nodes to resolve conflict
       // std::cout << "Found conflict: " << conflict << std::endl;
       // std::cout << "Found conflict at t=" << conflict.time << " type: " <<
       // conflict.type << std::endl;
 
-      std::map<size_t, Constraints> constraints;
-      m_env.createConstraintsFromConflict(conflict, constraints);
-      for (const auto& c : constraints) {
-        // std::cout << "Add HL node for " << c.first << std::endl;
-        size_t i = c.first;
-        // std::cout << "create child with id " << id << std::endl;
-        HighLevelNode newNode = P;
-        newNode.id = id;
-        // (optional) check that this constraint was not included already
-        // std::cout << newNode.constraints[i] << std::endl;
-        // std::cout << c.second << std::endl;
-        assert(!newNode.constraints[i].overlap(c.second));
-
-        newNode.constraints[i].add(c.second);
-
-        newNode.cost -= newNode.solution[i].cost;
-
-        LowLevelEnvironment llenv(m_env, i, newNode.constraints[i]);
-        LowLevelSearch_t lowLevel(llenv);
-        bool success = lowLevel.search(initialStates[i], newNode.solution[i]);
+      children.clear();
+      for (size_t e = 0; e < expanded.size(); ++e) {
+        std::map<size_t, Constraints> constraints;
+        m_env.createConstraintsFromConflict(expanded[e].conflict, constraints);
+        for (const auto& c : constraints) {
+          // std::cout << "Add HL node for " << c.first << std::endl;
+          size_t i = c.first;
+          // std::cout << "create child with id " << id << std::endl;
+          // the child shares all paths and constraints with its parent; only
+          // the path of agent i and the new constraint are allocated
+          children.emplace_back(expanded[e], e, i);
+          Child& child = children.back();
+          child.node.id = id;
+          child.node.constraints.collect(i, child.constraints);
+          // (optional) check that this constraint was not included already
+          // std::cout << child.constraints << std::endl;
+          // std::cout << c.second << std::endl;
+          assert(!child.constraints.overlap(c.second));
+
+          child.constraints.add(c.second);
+          child.node.constraints.add(i, c.second);
+
+          child.node.cost -= child.node.solution[i].cost;
+
+          ++id;
+        }
+      }
 
-        newNode.cost += newNode.solution[i].cost;
+      m_pool.parallelFor(children.size(), [&](size_t k, size_t worker) {
+        Child& child = children[k];
+        LowLevelEnvironment llenv(*m_lowLevelEnvs[worker], child.agentIdx,
+                                  child.constraints);
+        LowLevelSearch_t lowLevel(llenv, m_searchContexts[worker].get());
+        child.success =
+            lowLevel.search(initialStates[child.agentIdx], child.path);
+      });
+
+      bypassed.assign(expanded.size(), false);
+      for (auto& child : children) {
+        if (!child.success) {
+          continue;
+        }
+        HighLevelNode& node = child.node;
+        node.cost += child.path.cost;
+        node.solution.set(child.agentIdx, std::move(child.path));
+        // std::cout << "  success. cost: " << node.cost << std::endl;
+        findConflicts(node);
+        // early goal test: no node in open is cheaper than P
+        if (!node.hasConflict && node.cost == P.cost) {
+          m_env.onExpandHighLevelNode(node.cost);
+          std::cout << "done; cost: " << node.cost << std::endl;
+          solution = node.solution.toVector();
+          return true;
+        }
+        // bypass: the new path also satisfies the parent's constraints
+        HighLevelNode& parent = expanded[child.parentIdx];
+        if (m_bypass && !bypassed[child.parentIdx] &&
+            node.cost == parent.cost &&
+            node.numConflicts < parent.numConflicts) {
+          parent.solution = node.solution;
+          parent.hasConflict = node.hasConflict;
+          parent.conflict = node.conflict;
+          parent.numConflicts = node.numConflicts;
+          bypassed[child.parentIdx] = true;
+        }
+      }
 
-        if (success) {
-          // std::cout << "  success. cost: " << newNode.cost << std::endl;
-          auto handle = open.push(newNode);
+      for (size_t e = 0; e < expanded.size(); ++e) {
+        if (bypassed[e]) {
+          auto handle = open.push(expanded[e]);
+          (*handle).handle = handle;
+        }
+      }
+      for (const auto& child : children) {
+        if (child.success && !bypassed[child.parentIdx]) {
+          auto handle = open.push(child.node);
           (*handle).handle = handle;
         }
-
-        ++id;
       }
     }
 
@@ -173,13 +325,19 @@ class CBS {
 
  private:
   struct HighLevelNode {
-    std::vector<PlanResult<State, Action, Cost> > solution;
-    std::vector<Constraints> constraints;
+    SharedSolution<State, Action, Cost> solution;
+    SharedConstraints<Constraints> constraints;
 
     Cost cost;
 
     int id;
 
+    // conflict to branch on, valid if hasConflict
+    bool hasConflict;
+    Conflict conflict;
+    // only computed if bypassing is enabled
+    int numConflicts;
+
     typename boost::heap::d_ary_heap<HighLevelNode, boost::heap::arity<2>,
                                      boost::heap::mutable_<true> >::handle_type
         handle;
@@ -199,13 +357,36 @@ class CBS {
           os << "  " << c.solution[i].states[t].first << std::endl;
         }
         os << " Constraints:" << std::endl;
-        os << c.constraints[i];
+        c.constraints.print(os, i);
         os << " cost: " << c.solution[i].cost << std::endl;
       }
       return os;
     }
   };
 
+  // a child node whose agent agentIdx still needs to be replanned
+  struct Child {
+    Child(const HighLevelNode& parent, size_t parentIdx, size_t agentIdx)
+        : node(parent),
+          parentIdx(parentIdx),
+          agentIdx(agentIdx),
+          success(false) {}
+
+    HighLevelNode node;
+    size_t parentIdx;
+    size_t agentIdx;
+    Constraints constraints;
+    PlanResult<State, Action, Cost> path;
+    bool success;
+  };
+
+  void findConflicts(HighLevelNode& node) {
+    node.hasConflict =
+        selectConflict(m_env, node.solution, node.constraints, node.conflict);
+    node.numConflicts =
+        m_bypass && node.hasConflict ? countConflicts(m_env, node.solution) : 0;
+  }
+
   struct LowLevelEnvironment {
     LowLevelEnvironment(Environment& env, size_t agentIdx,
                         const Constraints& constraints)
@@ -222,6 +403,13 @@ class CBS {
 
     bool isSolution(const State& s) { return m_env.isSolution(s); }
 
+    // only exists if Environment provides it; selects the dense A* backend
+    template <typename Env = Environment>
+    auto denseIndex(const State& s)
+        -> decltype(std::declval<Env&>().denseIndex(s)) {
+      return m_env.denseIndex(s);
+    }
+
     void getNeighbors(const State& s,
                       std::vector<Neighbor<State, Action, Cost> >& neighbors) {
       m_env.getNeighbors(s, neighbors);
@@ -245,7 +433,14 @@ class CBS {
 
  private:
   Environment& m_env;
+  std::vector<Environment*> m_lowLevelEnvs;
+  ThreadPool m_pool;
+  size_t m_speculativeExpansions;
+  bool m_bypass;
+  std::function<bool(size_t, Cost)> m_interrupt;
   typedef AStar<State, Action, Cost, LowLevelEnvironment> LowLevelSearch_t;
+  std::vector<std::unique_ptr<typename LowLevelSearch_t::Context> >
+      m_searchContexts;
 };
 
 }  // namespace libMultiRobotPlanning
@@ -3,6 +3,8 @@
 #include <map>
 
 #include "a_star.hpp"
+#include "shared_constraints.hpp"
+#include "shared_solution.hpp"
 
 namespace libMultiRobotPlanning {
 
@@ -61,8 +63,8 @@ constraints
     Fill the list of neighboring state for the given state s and the current
 agent.
 
-  - `bool getFirstConflict(const std::vector<PlanResult<State, Action, int> >&
-solution, Conflict& result)`\n
+  - `bool getFirstConflict(const SharedSolution<State, Action, int>& solution,
+Conflict& result)`\n
     Finds the first conflict for the given solution for each agent. Return true
 if a conflict was found and false otherwise.
 
@@ -88,8 +90,8 @@ class CBSTA {
               std::vector<PlanResult<State, Action, Cost> >& solution) {
     HighLevelNode start;
     size_t numAgents = initialStates.size();
-    start.solution.resize(numAgents);
-    start.constraints.resize(numAgents);
+    start.solution = SharedSolution<State, Action, Cost>(numAgents);
+    start.constraints = SharedConstraints<Constraints>(numAgents);
     start.cost = 0;
     start.id = 0;
     start.isRoot = true;
@@ -102,17 +104,19 @@ class CBSTA {
       //   std::cout << "use existing solution for agent: " << i << std::endl;
       // } else {
       bool success = false;
+      Constraints noConstraints;
+      PlanResult<State, Action, Cost> path;
       if (!start.tasks.empty()) {
-        LowLevelEnvironment llenv(m_env, i, start.constraints[i],
-                                  start.task(i));
+        LowLevelEnvironment llenv(m_env, i, noConstraints, start.task(i));
         LowLevelSearch_t lowLevel(llenv);
-        success = lowLevel.search(initialStates[i], start.solution[i]);
+        success = lowLevel.search(initialStates[i], path);
       }
       if (!success) {
         return false;
       }
       // }
-      start.cost += start.solution[i].cost;
+      start.cost += path.cost;
+      start.solution.set(i, std::move(path));
     }
 
     // std::priority_queue<HighLevelNode> open;
@@ -135,7 +139,7 @@ class CBSTA {
       Conflict conflict;
       if (!m_env.getFirstConflict(P.solution, conflict)) {
         std::cout << "done; cost: " << P.cost << std::endl;
-        solution = P.solution;
+        solution = P.solution.toVector();
         return true;
       }
 
@@ -145,22 +149,25 @@ class CBSTA {
         m_env.nextTaskAssignment(n.tasks);
 
         if (n.tasks.size() > 0) {
-          n.solution.resize(numAgents);
-          n.constraints.resize(numAgents);
+          n.solution = SharedSolution<State, Action, Cost>(numAgents);
+          n.constraints = SharedConstraints<Constraints>(numAgents);
           n.cost = 0;
           n.id = id;
           n.isRoot = true;
 
           bool allSuccessful = true;
           for (size_t i = 0; i < numAgents; ++i) {
-            LowLevelEnvironment llenv(m_env, i, n.constraints[i], n.task(i));
+            Constraints noConstraints;
+            PlanResult<State, Action, Cost> path;
+            LowLevelEnvironment llenv(m_env, i, noConstraints, n.task(i));
             LowLevelSearch_t lowLevel(llenv);
-            bool success = lowLevel.search(initialStates[i], n.solution[i]);
+            bool success = lowLevel.search(initialStates[i], path);
             if (!success) {
               allSuccessful = false;
               break;
             }
-            n.cost += n.solution[i].cost;
+            n.cost += path.cost;
+            n.solution.set(i, std::move(path));
           }
           if (allSuccessful) {
             auto handle = open.push(n);
@@ -182,25 +189,30 @@ class CBSTA {
         // std::cout << "Add HL node for " << c.first << std::endl;
         size_t i = c.first;
         // std::cout << "create child with id " << id << std::endl;
+        // the child shares all paths and constraints with P; only the path
+        // of agent i and the new constraint are allocated
         HighLevelNode newNode = P;
         newNode.id = id;
+        Constraints agentConstraints;
+        newNode.constraints.collect(i, agentConstraints);
         // (optional) check that this constraint was not included already
-        // std::cout << newNode.constraints[i] << std::endl;
+        // std::cout << agentConstraints << std::endl;
         // std::cout << c.second << std::endl;
-        assert(!newNode.constraints[i].overlap(c.second));
+        assert(!agentConstraints.overlap(c.second));
 
-        newNode.constraints[i].add(c.second);
+        agentConstraints.add(c.second);
+        newNode.constraints.add(i, c.second);
 
         newNode.cost -= newNode.solution[i].cost;
 
-        LowLevelEnvironment llenv(m_env, i, newNode.constraints[i],
-                                  newNode.task(i));
+        PlanResult<State, Action, Cost> path;
+        LowLevelEnvironment llenv(m_env, i, agentConstraints, newNode.task(i));
         LowLevelSearch_t lowLevel(llenv);
-        bool success = lowLevel.search(initialStates[i], newNode.solution[i]);
-
-        newNode.cost += newNode.solution[i].cost;
+        bool success = lowLevel.search(initialStates[i], path);
 
         if (success) {
+          newNode.cost += path.cost;
+          newNode.solution.set(i, std::move(path));
           // std::cout << "  success. cost: " << newNode.cost << std::endl;
           auto handle = open.push(newNode);
           (*handle).handle = handle;
@@ -215,8 +227,8 @@ class CBSTA {
 
  private:
   struct HighLevelNode {
-    std::vector<PlanResult<State, Action, Cost> > solution;
-    std::vector<Constraints> constraints;
+    SharedSolution<State, Action, Cost> solution;
+    SharedConstraints<Constraints> constraints;
     std::map<size_t, Task> tasks; // maps from index to task (and does not contain an entry if no task was assigned)
 
     Cost cost;
@@ -253,7 +265,7 @@ class CBSTA {
           os << "  " << c.solution[i].states[t].first << std::endl;
         }
         os << " Constraints:" << std::endl;
-        os << c.constraints[i];
+        c.constraints.print(os, i);
         os << " cost: " << c.solution[i].cost << std::endl;
       }
       return os;
@@ -276,6 +288,13 @@ class CBSTA {
 
     bool isSolution(const State& s) { return m_env.isSolution(s); }
 
+    // only exists if Environment provides it; selects the dense A* backend
+    template <typename Env = Environment>
+    auto denseIndex(const State& s)
+        -> decltype(std::declval<Env&>().denseIndex(s)) {
+      return m_env.denseIndex(s);
+    }
+
     void getNeighbors(const State& s,
                       std::vector<Neighbor<State, Action, Cost> >& neighbors) {
       m_env.getNeighbors(s, neighbors);
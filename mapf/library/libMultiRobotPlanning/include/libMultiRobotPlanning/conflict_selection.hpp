@@ -0,0 +1,60 @@
+#pragma once
+
+namespace libMultiRobotPlanning {
+
+namespace detail {
+
+template <typename Environment, typename Solution, typename Constraints,
+          typename Conflict>
+auto selectConflict(Environment& env, const Solution& solution,
+                    const Constraints& constraints, Conflict& result, int)
+    -> decltype(env.getBestConflict(solution, constraints, result)) {
+  return env.getBestConflict(solution, constraints, result);
+}
+
+template <typename Environment, typename Solution, typename Constraints,
+          typename Conflict>
+bool selectConflict(Environment& env, const Solution& solution,
+                    const Constraints& /*constraints*/, Conflict& result,
+                    long) {
+  return env.getFirstConflict(solution, result);
+}
+
+template <typename Environment, typename Solution>
+auto countConflicts(Environment& env, const Solution& solution, int)
+    -> decltype(int(env.countConflicts(solution))) {
+  return env.countConflicts(solution);
+}
+
+template <typename Environment, typename Solution>
+int countConflicts(Environment& /*env*/, const Solution& /*solution*/, long) {
+  return 0;
+}
+
+}  // namespace detail
+
+/*! Picks the conflict a high-level node branches on.
+
+    Calls `bool getBestConflict(const SharedSolution<State, Action, Cost>&
+   solution, const SharedConstraints<Constraints>& constraints, Conflict&
+   result)` if the environment provides it (e.g. to prefer cardinal
+   conflicts) and `getFirstConflict(solution, result)` otherwise. Both return
+   false iff the solution is conflict-free.
+*/
+template <typename Environment, typename Solution, typename Constraints,
+          typename Conflict>
+bool selectConflict(Environment& env, const Solution& solution,
+                    const Constraints& constraints, Conflict& result) {
+  return detail::selectConflict(env, solution, constraints, result, 0);
+}
+
+/*! Number of conflicts of a solution according to `int countConflicts(const
+   SharedSolution<State, Action, Cost>& solution)` of the environment, or 0 if
+   the environment does not provide it.
+*/
+template <typename Environment, typename Solution>
+int countConflicts(Environment& env, const Solution& solution) {
+  return detail::countConflicts(env, solution, 0);
+}
+
+}  // namespace libMultiRobotPlanning
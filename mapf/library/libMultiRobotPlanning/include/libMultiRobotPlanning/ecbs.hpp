@@ -1,8 +1,13 @@
 #pragma once
 
+#include <functional>
 #include <map>
 
 #include "a_star_epsilon.hpp"
+#include "conflict_selection.hpp"
+#include "shared_constraints.hpp"
+#include "shared_solution.hpp"
+#include "thread_pool.hpp"
 
 namespace libMultiRobotPlanning {
 
@@ -55,20 +60,19 @@ constraints
     Admissible heuristic. Needs to take current context into account.
 
   - `Cost focalStateHeuristic(const State& s, int gScore, const
-std::vector<PlanResult<State, Action, int> >& solution)`\n
+SharedSolution<State, Action, int>& solution)`\n
     Potentially inadmissible focal heuristic for a state, e.g. count all
 conflicts between the agents if the agent of the current context moves is at
 state s
 
   - `Cost focalTransitionHeuristic(const State& s1a, const State& s1b, Cost
-gScoreS1a, Cost gScoreS1b, const std::vector<PlanResult<State, Action, Cost> >&
+gScoreS1a, Cost gScoreS1b, const SharedSolution<State, Action, Cost>&
 solution)`\n
     Potentially inadmissible focal heuristic for a state transition, e.g. count
 all conflicts between the agents if the agent of the current context moves from
 s1a to s1b
 
-  - `Cost focalHeuristic(const std::vector<PlanResult<State, Action, int> >&
-solution)`\n
+  - `Cost focalHeuristic(const SharedSolution<State, Action, int>& solution)`\n
     Potentially inadmissible focal heuristic, e.g. count all conflicts between
 the agents for a given solution
 
@@ -80,11 +84,17 @@ the agents for a given solution
     Fill the list of neighboring state for the given state s and the current
 agent.
 
-  - `bool getFirstConflict(const std::vector<PlanResult<State, Action, int> >&
-solution, Conflict& result)`\n
+  - `bool getFirstConflict(const SharedSolution<State, Action, int>& solution,
+Conflict& result)`\n
     Finds the first conflict for the given solution for each agent. Return true
 if a conflict was found and false otherwise.
 
+  - `bool getBestConflict(const SharedSolution<State, Action, int>& solution,
+const SharedConstraints<Constraints>& constraints, Conflict& result)`\n
+    Optional. If provided, it is used instead of getFirstConflict to choose the
+conflict to branch on, e.g. a cardinal one. Return true if a conflict was found
+and false otherwise.
+
   - `void createConstraintsFromConflict(const Conflict& conflict,
 std::map<size_t, Constraints>& constraints)`\n
     Create a list of constraints for the given conflict.
@@ -104,13 +114,53 @@ template <typename State, typename Action, typename Cost, typename Conflict,
           typename Constraints, typename Environment>
 class ECBS {
  public:
-  ECBS(Environment& environment, float w) : m_env(environment), m_w(w) {}
+  ECBS(Environment& environment, float w)
+      : m_env(environment),
+        m_w(w),
+        m_lowLevelEnvs(1, &environment),
+        m_pool(1),
+        m_bypass(false) {}
+
+  /*! Parallel high-level search
+
+    The low-level searches of the children of an expanded node run
+    concurrently on a pool with one thread per entry of lowLevelEnvironments.
+    Worker k only calls lowLevelEnvironments[k] (low-level functions and
+    focalHeuristic), so every worker needs its own environment;
+    the remaining high-level functions are only called on environment.
+  */
+  ECBS(Environment& environment, float w,
+       const std::vector<Environment*>& lowLevelEnvironments)
+      : m_env(environment),
+        m_w(w),
+        m_lowLevelEnvs(lowLevelEnvironments),
+        m_pool(lowLevelEnvironments.size()),
+        m_bypass(false) {
+    if (m_lowLevelEnvs.empty()) {
+      m_lowLevelEnvs.push_back(&environment);
+    }
+  }
+
+  /*! Enables bypassing: if a child is not more expensive than its parent but
+     has a smaller focal heuristic (i.e. fewer conflicts), the parent adopts
+     the child's path and is put back into the open list instead of being
+     split.
+  */
+  void setBypass(bool enabled) { m_bypass = enabled; }
+
+  /*! Called before every high-level expansion with the number of high-level
+     nodes expanded so far and the cost of the cheapest node in open. The
+     search gives up and returns false as soon as it returns true.
+  */
+  void setInterrupt(std::function<bool(size_t, Cost)> interrupt) {
+    m_interrupt = interrupt;
+  }
 
   bool search(const std::vector<State>& initialStates,
               std::vector<PlanResult<State, Action, Cost> >& solution) {
     HighLevelNode start;
-    start.solution.resize(initialStates.size());
-    start.constraints.resize(initialStates.size());
+    start.solution = SharedSolution<State, Action, Cost>(initialStates.size());
+    start.constraints = SharedConstraints<Constraints>(initialStates.size());
     start.cost = 0;
     start.LB = 0;
     start.id = 0;
@@ -120,21 +170,31 @@ class ECBS {
         std::cout << initialStates[i] << " " << solution[i].states.front().first
                   << std::endl;
         assert(initialStates[i] == solution[i].states.front().first);
-        start.solution[i] = solution[i];
+        start.solution.set(i, solution[i]);
         std::cout << "use existing solution for agent: " << i << std::endl;
       } else {
-        LowLevelEnvironment llenv(m_env, i, start.constraints[i],
-                                  start.solution);
+        Constraints noConstraints;
+        PlanResult<State, Action, Cost> path;
+        LowLevelEnvironment llenv(m_env, i, noConstraints, start.solution);
         LowLevelSearch_t lowLevel(llenv, m_w);
-        bool success = lowLevel.search(initialStates[i], start.solution[i]);
+        bool success = lowLevel.search(initialStates[i], path);
         if (!success) {
           return false;
         }
+        start.solution.set(i, std::move(path));
       }
       start.cost += start.solution[i].cost;
       start.LB += start.solution[i].fmin;
     }
     start.focalHeuristic = m_env.focalHeuristic(start.solution);
+    start.hasConflict = selectConflict(m_env, start.solution, start.constraints,
+                                       start.conflict);
+    if (!start.hasConflict) {
+      m_env.onExpandHighLevelNode(start.cost);
+      std::cout << "done; cost: " << start.cost << std::endl;
+      solution = start.solution.toVector();
+      return true;
+    }
 
     // std::priority_queue<HighLevelNode> open;
     openSet_t open;
@@ -148,7 +208,12 @@ class ECBS {
 
     solution.clear();
     int id = 1;
+    std::vector<Child> children;
+    size_t numExpanded = 0;
     while (!open.empty()) {
+      if (m_interrupt && m_interrupt(numExpanded, open.top().cost)) {
+        return false;
+      }
 // update focal list
 #ifdef REBUILT_FOCAL_LIST
       focal.clear();
@@ -231,13 +296,15 @@ class ECBS {
 
       focal.pop();
       open.erase(h);
+      ++numExpanded;
 
-      Conflict conflict;
-      if (!m_env.getFirstConflict(P.solution, conflict)) {
+      // conflicts are detected when a node is generated
+      if (!P.hasConflict) {
         std::cout << "done; cost: " << P.cost << std::endl;
-        solution = P.solution;
+        solution = P.solution.toVector();
         return true;
       }
+      const Conflict& conflict = P.conflict;
 
       // create additional nodes to resolve conflict
       std::cout << "Found conflict: " << conflict << std::endl;
@@ -246,41 +313,101 @@ class ECBS {
 
       std::map<size_t, Constraints> constraints;
       m_env.createConstraintsFromConflict(conflict, constraints);
+      children.clear();
       for (const auto& c : constraints) {
         // std::cout << "Add HL node for " << c.first << std::endl;
         size_t i = c.first;
         std::cout << "create child with id " << id << std::endl;
-        HighLevelNode newNode = P;
-        newNode.id = id;
+        // the child shares all paths and constraints with P; only the path
+        // of agent i and the new constraint are allocated
+        children.emplace_back(P, i);
+        Child& child = children.back();
+        child.node.id = id;
+        child.node.constraints.collect(i, child.constraints);
         // (optional) check that this constraint was not included already
-        // std::cout << newNode.constraints[i] << std::endl;
+        // std::cout << child.constraints << std::endl;
         // std::cout << c.second << std::endl;
-        assert(!newNode.constraints[i].overlap(c.second));
+        assert(!child.constraints.overlap(c.second));
+
+        child.constraints.add(c.second);
+        child.node.constraints.add(i, c.second);
 
-        newNode.constraints[i].add(c.second);
+        child.node.cost -= child.node.solution[i].cost;
+        child.node.LB -= child.node.solution[i].fmin;
 
-        newNode.cost -= newNode.solution[i].cost;
-        newNode.LB -= newNode.solution[i].fmin;
+        ++id;
+      }
 
-        LowLevelEnvironment llenv(m_env, i, newNode.constraints[i],
+      m_pool.parallelFor(children.size(), [&](size_t k, size_t worker) {
+        Child& child = children[k];
+        HighLevelNode& newNode = child.node;
+        Environment& env = *m_lowLevelEnvs[worker];
+        PlanResult<State, Action, Cost> path;
+        LowLevelEnvironment llenv(env, child.agentIdx, child.constraints,
                                   newNode.solution);
         LowLevelSearch_t lowLevel(llenv, m_w);
-        bool success = lowLevel.search(initialStates[i], newNode.solution[i]);
+        child.success = lowLevel.search(initialStates[child.agentIdx], path);
+
+        if (child.success) {
+          newNode.cost += path.cost;
+          newNode.LB += path.fmin;
+          newNode.solution.set(child.agentIdx, std::move(path));
+          newNode.focalHeuristic = env.focalHeuristic(newNode.solution);
+        }
+      });
+
+      // lower bound on the cost of all nodes in open after this expansion
+      Cost minCost = bestCost;
+      for (const auto& child : children) {
+        if (child.success) {
+          minCost = std::min(minCost, child.node.cost);
+        }
+      }
 
-        newNode.cost += newNode.solution[i].cost;
-        newNode.LB += newNode.solution[i].fmin;
-        newNode.focalHeuristic = m_env.focalHeuristic(newNode.solution);
+      bool bypassed = false;
+      for (auto& child : children) {
+        if (!child.success) {
+          continue;
+        }
+        HighLevelNode& node = child.node;
+        std::cout << "  success. cost: " << node.cost << std::endl;
+        node.hasConflict =
+            selectConflict(m_env, node.solution, node.constraints, node.conflict);
+        // early goal test: the node would be in focal
+        if (!node.hasConflict && node.cost <= minCost * m_w) {
+          m_env.onExpandHighLevelNode(node.cost);
+          std::cout << "done; cost: " << node.cost << std::endl;
+          solution = node.solution.toVector();
+          return true;
+        }
+        // bypass: the new path also satisfies the constraints of P
+        if (m_bypass && !bypassed && node.cost <= P.cost &&
+            node.focalHeuristic < P.focalHeuristic) {
+          P.solution = node.solution;
+          P.cost = node.cost;
+          P.focalHeuristic = node.focalHeuristic;
+          P.hasConflict = node.hasConflict;
+          P.conflict = node.conflict;
+          bypassed = true;
+        }
+      }
 
-        if (success) {
-          std::cout << "  success. cost: " << newNode.cost << std::endl;
-          auto handle = open.push(newNode);
+      if (bypassed) {
+        auto handle = open.push(P);
+        (*handle).handle = handle;
+        if (P.cost <= bestCost * m_w) {
+          focal.push(handle);
+        }
+        continue;
+      }
+      for (const auto& child : children) {
+        if (child.success) {
+          auto handle = open.push(child.node);
           (*handle).handle = handle;
-          if (newNode.cost <= bestCost * m_w) {
+          if (child.node.cost <= bestCost * m_w) {
             focal.push(handle);
           }
         }
-
-        ++id;
       }
     }
 
@@ -306,8 +433,8 @@ class ECBS {
 #endif
 
   struct HighLevelNode {
-    std::vector<PlanResult<State, Action, Cost> > solution;
-    std::vector<Constraints> constraints;
+    SharedSolution<State, Action, Cost> solution;
+    SharedConstraints<Constraints> constraints;
 
     Cost cost;
     Cost LB;  // sum of fmin of solution
@@ -316,6 +443,10 @@ class ECBS {
 
     int id;
 
+    // conflict to branch on, valid if hasConflict
+    bool hasConflict;
+    Conflict conflict;
+
     handle_t handle;
 
     bool operator<(const HighLevelNode& n) const {
@@ -334,7 +465,7 @@ class ECBS {
           os << "  " << c.solution[i].states[t].first << std::endl;
         }
         os << " Constraints:" << std::endl;
-        os << c.constraints[i];
+        c.constraints.print(os, i);
         os << " cost: " << c.solution[i].cost << std::endl;
       }
       return os;
@@ -362,10 +493,21 @@ class ECBS {
       focalSet_t;
 #endif
 
+  // a child node whose agent agentIdx still needs to be replanned
+  struct Child {
+    Child(const HighLevelNode& parent, size_t agentIdx)
+        : node(parent), agentIdx(agentIdx), success(false) {}
+
+    HighLevelNode node;
+    size_t agentIdx;
+    Constraints constraints;
+    bool success;
+  };
+
   struct LowLevelEnvironment {
     LowLevelEnvironment(
         Environment& env, size_t agentIdx, const Constraints& constraints,
-        const std::vector<PlanResult<State, Action, Cost> >& solution)
+        const SharedSolution<State, Action, Cost>& solution)
         : m_env(env)
           // , m_agentIdx(agentIdx)
           // , m_constraints(constraints)
@@ -412,12 +554,16 @@ class ECBS {
     Environment& m_env;
     // size_t m_agentIdx;
     // const Constraints& m_constraints;
-    const std::vector<PlanResult<State, Action, Cost> >& m_solution;
+    const SharedSolution<State, Action, Cost>& m_solution;
   };
 
  private:
   Environment& m_env;
   float m_w;
+  std::vector<Environment*> m_lowLevelEnvs;
+  ThreadPool m_pool;
+  bool m_bypass;
+  std::function<bool(size_t, Cost)> m_interrupt;
   typedef AStarEpsilon<State, Action, Cost, LowLevelEnvironment>
       LowLevelSearch_t;
 };
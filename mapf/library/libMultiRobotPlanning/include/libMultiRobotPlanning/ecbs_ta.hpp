@@ -3,6 +3,8 @@
 #include <map>
 
 #include "a_star_epsilon.hpp"
+#include "shared_constraints.hpp"
+#include "shared_solution.hpp"
 
 // #define CHECK_FOCAL_LIST
 #define REBUILT_FOCAL_LIST
@@ -68,8 +70,8 @@ constraints
     Fill the list of neighboring state for the given state s and the current
 agent.
 
-  - `bool getFirstConflict(const std::vector<PlanResult<State, Action, int> >&
-solution, Conflict& result)`\n
+  - `bool getFirstConflict(const SharedSolution<State, Action, int>& solution,
+Conflict& result)`\n
     Finds the first conflict for the given solution for each agent. Return true
 if a conflict was found and false otherwise.
 
@@ -95,8 +97,8 @@ class ECBSTA {
               std::vector<PlanResult<State, Action, Cost> >& solution) {
     HighLevelNode start;
     size_t numAgents = initialStates.size();
-    start.solution.resize(numAgents);
-    start.constraints.resize(numAgents);
+    start.solution = SharedSolution<State, Action, Cost>(numAgents);
+    start.constraints = SharedConstraints<Constraints>(numAgents);
     start.cost = 0;
     start.LB = 0;
     start.id = 0;
@@ -119,16 +121,19 @@ class ECBSTA {
         std::cout << initialStates[i] << " " << solution[i].states.front().first
                   << std::endl;
         assert(initialStates[i] == solution[i].states.front().first);
-        start.solution[i] = solution[i];
+        start.solution.set(i, solution[i]);
         std::cout << "use existing solution for agent: " << i << std::endl;
       } else {
-        LowLevelEnvironment llenv(m_env, i, start.constraints[i],
-                                  start.task(i), start.solution);
+        Constraints noConstraints;
+        PlanResult<State, Action, Cost> path;
+        LowLevelEnvironment llenv(m_env, i, noConstraints, start.task(i),
+                                  start.solution);
         LowLevelSearch_t lowLevel(llenv, m_w);
-        bool success = lowLevel.search(initialStates[i], start.solution[i]);
+        bool success = lowLevel.search(initialStates[i], path);
         if (!success) {
           return false;
         }
+        start.solution.set(i, std::move(path));
       }
       // std::cout << "startcost for " << i << ": " << start.solution[i].cost <<
       // " " << start.solution[i].fmin << std::endl;
@@ -246,7 +251,7 @@ class ECBSTA {
       Conflict conflict;
       if (!m_env.getFirstConflict(P.solution, conflict)) {
         std::cout << "done; cost: " << P.cost << std::endl;
-        solution = P.solution;
+        solution = P.solution.toVector();
         return true;
       }
 
@@ -261,28 +266,34 @@ class ECBSTA {
         // std::cout << "Add HL node for " << c.first << std::endl;
         size_t i = c.first;
         std::cout << "create child with id " << id << std::endl;
+        // the child shares all paths and constraints with P; only the path
+        // of agent i and the new constraint are allocated
         HighLevelNode newNode = P;
         newNode.id = id;
+        Constraints agentConstraints;
+        newNode.constraints.collect(i, agentConstraints);
         // (optional) check that this constraint was not included already
-        // std::cout << newNode.constraints[i] << std::endl;
+        // std::cout << agentConstraints << std::endl;
         // std::cout << c.second << std::endl;
-        assert(!newNode.constraints[i].overlap(c.second));
+        assert(!agentConstraints.overlap(c.second));
 
-        newNode.constraints[i].add(c.second);
+        agentConstraints.add(c.second);
+        newNode.constraints.add(i, c.second);
 
         newNode.cost -= newNode.solution[i].cost;
         newNode.LB -= newNode.solution[i].fmin;
 
-        LowLevelEnvironment llenv(m_env, i, newNode.constraints[i],
-                                  newNode.task(i), newNode.solution);
+        PlanResult<State, Action, Cost> path;
+        LowLevelEnvironment llenv(m_env, i, agentConstraints, newNode.task(i),
+                                  newNode.solution);
         LowLevelSearch_t lowLevel(llenv, m_w);
-        bool success = lowLevel.search(initialStates[i], newNode.solution[i]);
-
-        newNode.cost += newNode.solution[i].cost;
-        newNode.LB += newNode.solution[i].fmin;
-        newNode.focalHeuristic = m_env.focalHeuristic(newNode.solution);
+        bool success = lowLevel.search(initialStates[i], path);
 
         if (success) {
+          newNode.cost += path.cost;
+          newNode.LB += path.fmin;
+          newNode.solution.set(i, std::move(path));
+          newNode.focalHeuristic = m_env.focalHeuristic(newNode.solution);
           std::cout << "  success. cost: " << newNode.cost << std::endl;
           auto handle = open.push(newNode);
           (*handle).handle = handle;
@@ -307,8 +318,8 @@ class ECBSTA {
         m_env.nextTaskAssignment(n.tasks);
 
         if (n.tasks.size() > 0) {
-          n.solution.resize(numAgents);
-          n.constraints.resize(numAgents);
+          n.solution = SharedSolution<State, Action, Cost>(numAgents);
+          n.constraints = SharedConstraints<Constraints>(numAgents);
           n.cost = 0;
           n.LB = 0;
           n.id = id;
@@ -316,16 +327,19 @@ class ECBSTA {
 
           bool allSuccessful = true;
           for (size_t i = 0; i < numAgents; ++i) {
-            LowLevelEnvironment llenv(m_env, i, n.constraints[i], n.task(i),
+            Constraints noConstraints;
+            PlanResult<State, Action, Cost> path;
+            LowLevelEnvironment llenv(m_env, i, noConstraints, n.task(i),
                                       n.solution);
             LowLevelSearch_t lowLevel(llenv, m_w);
-            bool success = lowLevel.search(initialStates[i], n.solution[i]);
+            bool success = lowLevel.search(initialStates[i], path);
             if (!success) {
               allSuccessful = false;
               break;
             }
-            n.cost += n.solution[i].cost;
-            n.LB += n.solution[i].fmin;
+            n.cost += path.cost;
+            n.LB += path.fmin;
+            n.solution.set(i, std::move(path));
           }
           if (allSuccessful) {
             n.focalHeuristic = m_env.focalHeuristic(n.solution);
@@ -370,8 +384,8 @@ class ECBSTA {
 #endif
 
   struct HighLevelNode {
-    std::vector<PlanResult<State, Action, Cost> > solution;
-    std::vector<Constraints> constraints;
+    SharedSolution<State, Action, Cost> solution;
+    SharedConstraints<Constraints> constraints;
     std::map<size_t, Task> tasks; // maps from index to task (and does not contain an entry if no task was assigned)
 
     Cost cost;
@@ -410,7 +424,7 @@ class ECBSTA {
           os << "  " << c.solution[i].states[t].first << std::endl;
         }
         os << " Constraints:" << std::endl;
-        os << c.constraints[i];
+        c.constraints.print(os, i);
         os << " cost: " << c.solution[i].cost << std::endl;
       }
       return os;
@@ -442,7 +456,7 @@ class ECBSTA {
     LowLevelEnvironment(
         Environment& env, size_t agentIdx, const Constraints& constraints,
         const Task* task,
-        const std::vector<PlanResult<State, Action, Cost> >& solution)
+        const SharedSolution<State, Action, Cost>& solution)
         : m_env(env)
           // , m_agentIdx(agentIdx)
           // , m_constraints(constraints)
@@ -489,7 +503,7 @@ class ECBSTA {
     Environment& m_env;
     // size_t m_agentIdx;
     // const Constraints& m_constraints;
-    const std::vector<PlanResult<State, Action, Cost> >& m_solution;
+    const SharedSolution<State, Action, Cost>& m_solution;
   };
 
  private:
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace libMultiRobotPlanning {
+
+/*! \brief Per-agent constraints of a high-level node as persistent chains
+
+    Each agent's constraints are stored as an immutable, reference-counted
+   linked list that points from the most recently added constraint towards the
+   root of the constraint tree. A child node shares the whole chain of its
+   parent and only allocates the link for the new constraint.
+
+    \tparam Constraints Custom constraint description. Needs to be
+   default-constructible and provide `void add(const Constraints& other)`
+*/
+template <typename Constraints>
+class SharedConstraints {
+ public:
+  SharedConstraints() = default;
+
+  explicit SharedConstraints(size_t numAgents) : m_heads(numAgents) {}
+
+  size_t size() const { return m_heads.size(); }
+
+  //! prepends the given constraints to the chain of the given agent
+  void add(size_t agentIdx, const Constraints& constraints) {
+    m_heads[agentIdx] =
+        std::make_shared<const Link>(constraints, m_heads[agentIdx]);
+  }
+
+  /*! identifies the constraint set of the given agent: two nodes share the
+     same id iff they share the same chain. The returned pointer keeps the
+     chain alive, so the id is not reused while it is held.
+  */
+  std::shared_ptr<const void> id(size_t agentIdx) const {
+    return m_heads[agentIdx];
+  }
+
+  //! adds all constraints of the given agent to result
+  void collect(size_t agentIdx, Constraints& result) const {
+    for (const Link* link = m_heads[agentIdx].get(); link;
+         link = link->parent.get()) {
+      result.add(link->constraints);
+    }
+  }
+
+  //! prints the constraints of the given agent
+  void print(std::ostream& os, size_t agentIdx) const {
+    for (const Link* link = m_heads[agentIdx].get(); link;
+         link = link->parent.get()) {
+      os << link->constraints;
+    }
+  }
+
+ private:
+  struct Link {
+    Link(const Constraints& constraints, std::shared_ptr<const Link> parent)
+        : constraints(constraints), parent(std::move(parent)) {}
+
+    Constraints constraints;
+    std::shared_ptr<const Link> parent;
+  };
+
+  std::vector<std::shared_ptr<const Link> > m_heads;
+};
+
+}  // namespace libMultiRobotPlanning
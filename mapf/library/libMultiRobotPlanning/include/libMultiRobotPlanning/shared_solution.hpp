@@ -0,0 +1,70 @@
+#pragma once
+
+#include <boost/iterator/indirect_iterator.hpp>
+#include <memory>
+#include <vector>
+
+#include "planresult.hpp"
+
+namespace libMultiRobotPlanning {
+
+/*! \brief Solution of a high-level node with structurally shared paths
+
+    Stores one immutable, reference-counted PlanResult per agent. Copying a
+   SharedSolution only copies the pointers, so a child node in a
+   conflict-based search shares all paths with its parent except for the one
+   of the agent that was replanned.
+
+    \tparam State Custom state for the search. Needs to be copy'able
+    \tparam Action Custom action for the search. Needs to be copy'able
+    \tparam Cost Custom Cost type (integer or floating point types)
+*/
+template <typename State, typename Action, typename Cost>
+class SharedSolution {
+ public:
+  typedef PlanResult<State, Action, Cost> value_type;
+  typedef boost::indirect_iterator<
+      typename std::vector<std::shared_ptr<const value_type> >::const_iterator>
+      const_iterator;
+
+  SharedSolution() = default;
+
+  //! creates a solution where every agent has an empty path
+  explicit SharedSolution(size_t numAgents)
+      : m_plans(numAgents, std::make_shared<const value_type>()) {}
+
+  size_t size() const { return m_plans.size(); }
+
+  bool empty() const { return m_plans.empty(); }
+
+  const value_type& operator[](size_t agentIdx) const {
+    return *m_plans[agentIdx];
+  }
+
+  /*! returns the shared path of an agent. Paths are immutable, hence the
+     pointer identifies the path, e.g. to detect which agents changed
+     between two solutions.
+  */
+  const std::shared_ptr<const value_type>& share(size_t agentIdx) const {
+    return m_plans[agentIdx];
+  }
+
+  //! replaces the path of a single agent; all other paths stay shared
+  void set(size_t agentIdx, value_type plan) {
+    m_plans[agentIdx] = std::make_shared<const value_type>(std::move(plan));
+  }
+
+  const_iterator begin() const { return const_iterator(m_plans.begin()); }
+
+  const_iterator end() const { return const_iterator(m_plans.end()); }
+
+  //! copies all paths into a plain vector (e.g. to return a final solution)
+  std::vector<value_type> toVector() const {
+    return std::vector<value_type>(begin(), end());
+  }
+
+ private:
+  std::vector<std::shared_ptr<const value_type> > m_plans;
+};
+
+}  // namespace libMultiRobotPlanning
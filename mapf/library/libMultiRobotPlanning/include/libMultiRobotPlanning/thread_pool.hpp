@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libMultiRobotPlanning {
+
+/*! \brief Fixed-size pool of worker threads for fork-join parallelism
+
+    The pool keeps its threads alive between calls, so it can be used for
+   many small batches (e.g. the children of a single high-level node) without
+   paying for thread creation every time. The calling thread participates in
+   the work as worker 0, hence a pool of size 1 runs everything inline and
+   starts no threads at all.
+
+    Only one thread at a time may call parallelFor().
+*/
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t numThreads)
+      : m_generation(0),
+        m_numTasks(0),
+        m_nextTask(0),
+        m_active(0),
+        m_stop(false) {
+    for (size_t i = 1; i < std::max<size_t>(numThreads, 1); ++i) {
+      m_threads.emplace_back([this, i] { workerLoop(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wakeup.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  //! number of workers, including the calling thread
+  size_t size() const { return m_threads.size() + 1; }
+
+  /*! Calls fn(taskIdx, workerIdx) for every taskIdx in [0, numTasks) and
+     blocks until all calls returned. workerIdx is in [0, size()) and unique
+     among concurrently running calls, so it can be used to index per-thread
+     data. fn must not throw.
+  */
+  template <typename Fn>
+  void parallelFor(size_t numTasks, Fn&& fn) {
+    if (m_threads.empty() || numTasks <= 1) {
+      for (size_t i = 0; i < numTasks; ++i) {
+        fn(i, 0);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_job = std::ref(fn);
+      m_numTasks = numTasks;
+      m_nextTask = 0;
+      m_active = m_threads.size();
+      ++m_generation;
+    }
+    m_wakeup.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_job = nullptr;
+  }
+
+ private:
+  void runTasks(size_t workerIdx) {
+    size_t task;
+    while ((task = m_nextTask.fetch_add(1)) < m_numTasks) {
+      m_job(task, workerIdx);
+    }
+  }
+
+  void workerLoop(size_t workerIdx) {
+    size_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wakeup.wait(lock, [&] {
+          return m_stop || m_generation != generation;
+        });
+        if (m_stop) {
+          return;
+        }
+        generation = m_generation;
+      }
+      runTasks(workerIdx);
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_active == 0) {
+          m_done.notify_one();
+        }
+      }
+    }
+  }
+
+ private:
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeup;
+  std::condition_variable m_done;
+  std::function<void(size_t, size_t)> m_job;
+  size_t m_generation;
+  size_t m_numTasks;
+  std::atomic<size_t> m_nextTask;
+  size_t m_active;
+  bool m_stop;
+};
+
+}  // namespace libMultiRobotPlanning
@@ -5,11 +5,14 @@ import os
 
 class TestCBS(unittest.TestCase):
 
-  def runCBS(self, inputFile, createVideo=False):
+  def runCBS(self, inputFile, createVideo=False, threads=1, speculative=1,
+             bypass=False):
     subprocess.run(
       ["./cbs",
        "-i", inputFile,
-       "-o", "output.yaml"],
+       "-o", "output.yaml",
+       "-t", str(threads),
+       "-k", str(speculative)] + (["-b"] if bypass else []),
        check=True)
     if createVideo:
       subprocess.run(
@@ -33,6 +36,16 @@ class TestCBS(unittest.TestCase):
     r = self.runCBS("../test/mapf_atGoal.yaml")
     self.assertTrue(r["statistics"]["cost"] == 0)
 
+  def test_mapfSwap4Parallel(self):
+    r = self.runCBS("../test/mapf_swap4.yaml")
+    rp = self.runCBS("../test/mapf_swap4.yaml", threads=4, speculative=4)
+    self.assertTrue(rp["statistics"]["cost"] == r["statistics"]["cost"])
+
+  def test_mapfSwap4Bypass(self):
+    r = self.runCBS("../test/mapf_swap4.yaml")
+    rb = self.runCBS("../test/mapf_swap4.yaml", bypass=True)
+    self.assertTrue(rb["statistics"]["cost"] == r["statistics"]["cost"])
+
 
 if __name__ == '__main__':
     unittest.main()
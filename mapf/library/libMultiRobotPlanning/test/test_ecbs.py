@@ -5,12 +5,13 @@ import os
 
 class TestECBS(unittest.TestCase):
 
-  def runECBS(self, inputFile, w, createVideo=False):
+  def runECBS(self, inputFile, w, createVideo=False, threads=1, bypass=False):
     subprocess.run(
       ["./ecbs",
        "-i", inputFile,
        "-o", "output.yaml",
-       "-w", str(w)],
+       "-w", str(w),
+       "-t", str(threads)] + (["-b"] if bypass else []),
        check=True)
     if createVideo:
       subprocess.run(
@@ -34,6 +35,14 @@ class TestECBS(unittest.TestCase):
     r = self.runECBS("../test/mapf_atGoal.yaml", 1.0)
     self.assertTrue(r["statistics"]["cost"] == 0)
 
+  def test_mapfSimple1Parallel(self):
+    r = self.runECBS("../test/mapf_simple1.yaml", 1.0, threads=4)
+    self.assertTrue(r["statistics"]["cost"] == 8)
+
+  def test_mapfSimple1Bypass(self):
+    r = self.runECBS("../test/mapf_simple1.yaml", 1.0, bypass=True)
+    self.assertTrue(r["statistics"]["cost"] == 8)
+
 
 if __name__ == '__main__':
     unittest.main()